@@ -33,6 +33,7 @@
 #include <deque>
 #include <iostream>
 #include <list>
+#include <memory_resource>
 #include <set>
 #include <string>
 #include <unordered_set>
@@ -43,18 +44,18 @@ using namespace cefal;
 template <typename T>
 struct ContainerSize;
 
-template <typename T>
-struct ContainerSize<std::vector<T>> {
+template <typename T, typename Allocator>
+struct ContainerSize<std::vector<T, Allocator>> {
     static constexpr size_t value = std::is_same_v<T, int> ? 10'000'000 : 25'000;
 };
 
-template <typename T>
-struct ContainerSize<std::list<T>> {
+template <typename T, typename Allocator>
+struct ContainerSize<std::list<T, Allocator>> {
     static constexpr size_t value = std::is_same_v<T, int> ? 1'000'000 : 25'000;
 };
 
-template <typename T>
-struct ContainerSize<std::deque<T>> {
+template <typename T, typename Allocator>
+struct ContainerSize<std::deque<T, Allocator>> {
     static constexpr size_t value = std::is_same_v<T, int> ? 10'000'000 : 25'000;
 };
 
@@ -249,3 +250,43 @@ TEMPLATE_PRODUCT_TEST_CASE("cefal::filter()", "", (std::map, std::unordered_map)
         };
     }
 }
+
+TEMPLATE_PRODUCT_TEST_CASE("cefal::filter() - pmr", "",
+                           (std::pmr::vector, std::pmr::list, std::pmr::deque, std::pmr::set, std::pmr::unordered_set),
+                           (int, Expensive<int>)) {
+    auto func = [](const InnerType_T<TestType>& x) -> bool { return x % 2; };
+    auto seed = std::chrono::system_clock::now();
+    TestType src;
+    for (int j = 0; j < ContainerSize_V<TestType>; ++j) {
+        src = std::move(src)
+              | ops::append(helpers::SingletonFrom<TestType>{cefal::InnerType_T<TestType>(seed.time_since_epoch().count() + j)});
+    }
+
+    BENCHMARK("cefal::filter() - 50% kept - immutable - default resource - x" + std::to_string(ContainerSize_V<TestType>)) {
+        TestType dest = src | ops::filter(func);
+        return *dest.begin();
+    };
+
+    BENCHMARK("cefal::filter() - 50% kept - immutable - ArenaScope - x" + std::to_string(ContainerSize_V<TestType>)) {
+        ArenaScope arena;
+        TestType dest = src | ops::filter(func);
+        return *dest.begin();
+    };
+}
+
+TEST_CASE("cefal::filterSimd() for floats") {
+    constexpr size_t size = ContainerSize_V<std::vector<int>>;
+    std::vector<float> src;
+    for (size_t j = 0; j < size; ++j)
+        src.push_back(static_cast<float>(j % 1000) / 7);
+
+    BENCHMARK("cefal::filter() - immutable - x" + std::to_string(size)) {
+        auto dest = src | ops::filter([](float x) { return x > 50; });
+        return dest.back();
+    };
+
+    BENCHMARK("cefal::filterSimd() - immutable - x" + std::to_string(size)) {
+        auto dest = src | ops::filterSimd([](const Simd<float>& x) { return x > 50; });
+        return dest.back();
+    };
+}
@@ -0,0 +1,69 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "cefal/everything.h"
+
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "catch2/catch.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <numeric>
+#include <string>
+#include <vector>
+
+using namespace cefal;
+
+template <typename T>
+struct ContainerSize {
+    static constexpr size_t value = 10'000'000;
+};
+
+template <typename T>
+constexpr inline size_t ContainerSize_V = ContainerSize<T>::value;
+
+TEMPLATE_PRODUCT_TEST_CASE("cefal::foldMap() for arithmetic monoids", "", (std::vector, std::deque), (int, double)) {
+    using T = InnerType_T<TestType>;
+    TestType src;
+    for (size_t j = 0; j < ContainerSize_V<TestType>; ++j)
+        src.push_back(static_cast<T>(j % 1000) / 7);
+    auto identity = [](T x) { return x; };
+
+    BENCHMARK("cefal::foldMap<Sum>() - x" + std::to_string(ContainerSize_V<TestType>)) {
+        return (src | ops::foldMap<Sum<T>>(identity)).value;
+    };
+
+    BENCHMARK("std::accumulate() - x" + std::to_string(ContainerSize_V<TestType>)) {
+        return std::accumulate(src.begin(), src.end(), T(0));
+    };
+
+    BENCHMARK("cefal::foldMap<Max>() - x" + std::to_string(ContainerSize_V<TestType>)) {
+        return (src | ops::foldMap<Max<T>>(identity)).value;
+    };
+
+    BENCHMARK("std::max_element() - x" + std::to_string(ContainerSize_V<TestType>)) {
+        return *std::max_element(src.begin(), src.end());
+    };
+}
@@ -30,9 +30,11 @@
 #define CATCH_CONFIG_ENABLE_BENCHMARKING
 #include "catch2/catch.hpp"
 
+#include <cmath>
 #include <deque>
 #include <iostream>
 #include <list>
+#include <memory_resource>
 #include <set>
 #include <string>
 #include <unordered_set>
@@ -43,18 +45,18 @@ using namespace cefal;
 template <typename T>
 struct ContainerSize;
 
-template <typename T>
-struct ContainerSize<std::vector<T>> {
+template <typename T, typename Allocator>
+struct ContainerSize<std::vector<T, Allocator>> {
     static constexpr size_t value = std::is_same_v<T, int> ? 10'000'000 : 25'000;
 };
 
-template <typename T>
-struct ContainerSize<std::list<T>> {
+template <typename T, typename Allocator>
+struct ContainerSize<std::list<T, Allocator>> {
     static constexpr size_t value = std::is_same_v<T, int> ? 1'000'000 : 25'000;
 };
 
-template <typename T>
-struct ContainerSize<std::deque<T>> {
+template <typename T, typename Allocator>
+struct ContainerSize<std::deque<T, Allocator>> {
     static constexpr size_t value = std::is_same_v<T, int> ? 10'000'000 : 25'000;
 };
 
@@ -362,3 +364,45 @@ TEMPLATE_PRODUCT_TEST_CASE("cefal::map() to different type", "", (std::map, std:
         });
     };
 }
+
+TEMPLATE_PRODUCT_TEST_CASE("cefal::map() to same type - pmr", "",
+                           (std::pmr::vector, std::pmr::list, std::pmr::deque, std::pmr::set, std::pmr::unordered_set),
+                           (int, Expensive<int>)) {
+    auto func = []<typename T>(T&& x) { return std::forward<T>(x) + 1; };
+    auto seed = std::chrono::system_clock::now();
+    TestType src;
+    for (int j = 0; j < ContainerSize_V<TestType>; ++j) {
+        src = std::move(src)
+              | ops::append(helpers::SingletonFrom<TestType>{cefal::InnerType_T<TestType>(seed.time_since_epoch().count() + j)});
+    }
+
+    BENCHMARK("cefal::map() - immutable - default resource - x" + std::to_string(ContainerSize_V<TestType>)) {
+        TestType dest = src | ops::map(func);
+        return *dest.begin();
+    };
+
+    BENCHMARK("cefal::map() - immutable - ArenaScope - x" + std::to_string(ContainerSize_V<TestType>)) {
+        ArenaScope arena;
+        TestType dest = src | ops::map(func);
+        return *dest.begin();
+    };
+}
+
+TEST_CASE("cefal::mapSimd() for floats") {
+    constexpr size_t size = ContainerSize_V<std::vector<int>>;
+    std::vector<float> src;
+    for (size_t j = 0; j < size; ++j)
+        src.push_back(static_cast<float>(j % 1000) / 7);
+
+    BENCHMARK("cefal::map() - immutable - x" + std::to_string(size)) {
+        auto dest = src | ops::map([](float x) { return std::sqrt(x) * 3 + 1; });
+        return dest.back();
+    };
+
+#if __has_include(<experimental/simd>)
+    BENCHMARK("cefal::mapSimd() - immutable - x" + std::to_string(size)) {
+        auto dest = src | ops::mapSimd([](const Simd<float>& x) { return std::experimental::sqrt(x) * 3 + 1; });
+        return dest.back();
+    };
+#endif
+}
@@ -0,0 +1,169 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "expensive.h"
+
+#include "cefal/everything.h"
+
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "catch2/catch.hpp"
+
+#include <deque>
+#include <list>
+#include <memory_resource>
+#include <set>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+using namespace cefal;
+
+template <typename T>
+struct ContainerSize;
+
+template <cefal::detail::VectorLikeContainer C>
+struct ContainerSize<C> {
+    static constexpr size_t value = std::is_same_v<cefal::InnerType_T<C>, int> ? 1'000'000 : 2'500;
+};
+
+template <cefal::detail::SetLikeContainer C>
+struct ContainerSize<C> {
+    static constexpr size_t value = std::is_same_v<cefal::InnerType_T<C>, int> ? 100'000 : 2'500;
+};
+
+template <typename T>
+struct ContainerSize<PersistentVector<T>> : ContainerSize<std::vector<T>> {};
+
+template <typename T>
+struct ContainerSize<PersistentSet<T>> : ContainerSize<std::unordered_set<T>> {};
+
+template <typename T>
+constexpr inline size_t ContainerSize_V = ContainerSize<T>::value;
+
+template <typename C>
+C createContainer(size_t size, int seed) {
+    C result;
+    for (size_t i = 0; i < size; ++i)
+        result = std::move(result) | ops::append(helpers::SingletonFrom<C>{cefal::InnerType_T<C>(seed + int(i))});
+    return result;
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("cefal::append()", "",
+                           (std::vector, Vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
+                            std::unordered_multiset),
+                           (int, Expensive<int>)) {
+    constexpr size_t size = ContainerSize_V<TestType>;
+
+    BENCHMARK_ADVANCED("cefal::append() - rvalue + rvalue - 2 x" + std::to_string(size))
+    (Catch::Benchmark::Chronometer meter) {
+        std::vector<TestType> lefts(meter.runs());
+        std::vector<TestType> rights(meter.runs());
+        for (int i = 0; i < meter.runs(); ++i) {
+            lefts[i] = createContainer<TestType>(size, 0);
+            rights[i] = createContainer<TestType>(size, int(size));
+        }
+        meter.measure([&lefts, &rights](int i) {
+            lefts[i] = std::move(lefts[i]) | ops::append(std::move(rights[i]));
+            return lefts[i].size();
+        });
+    };
+
+    BENCHMARK_ADVANCED("cefal::append() - rvalue + lvalue - 2 x" + std::to_string(size))
+    (Catch::Benchmark::Chronometer meter) {
+        std::vector<TestType> lefts(meter.runs());
+        const TestType right = createContainer<TestType>(size, int(size));
+        for (int i = 0; i < meter.runs(); ++i)
+            lefts[i] = createContainer<TestType>(size, 0);
+        meter.measure([&lefts, &right](int i) {
+            lefts[i] = std::move(lefts[i]) | ops::append(right);
+            return lefts[i].size();
+        });
+    };
+
+    BENCHMARK_ADVANCED("cefal::append() - accumulate chunks - 100 x" + std::to_string(size / 100))
+    (Catch::Benchmark::Chronometer meter) {
+        std::vector<std::vector<TestType>> chunks(meter.runs());
+        for (int i = 0; i < meter.runs(); ++i) {
+            for (int j = 0; j < 100; ++j)
+                chunks[i].push_back(createContainer<TestType>(size / 100, j * int(size / 100)));
+        }
+        meter.measure([&chunks](int i) {
+            TestType result;
+            for (auto&& chunk : chunks[i])
+                result = std::move(result) | ops::append(std::move(chunk));
+            return result.size();
+        });
+    };
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("cefal::append() - pmr", "",
+                           (std::pmr::vector, std::pmr::list, std::pmr::deque, std::pmr::set, std::pmr::unordered_set),
+                           (int, Expensive<int>)) {
+    constexpr size_t size = ContainerSize_V<TestType>;
+    const TestType left = createContainer<TestType>(size, 0);
+    const TestType right = createContainer<TestType>(size, int(size));
+    std::vector<TestType> chunks;
+    for (int j = 0; j < 100; ++j)
+        chunks.push_back(createContainer<TestType>(size / 100, j * int(size / 100)));
+
+    BENCHMARK("cefal::append() - lvalue + lvalue - default resource - 2 x" + std::to_string(size)) {
+        return (left | ops::append(right)).size();
+    };
+
+    BENCHMARK("cefal::append() - lvalue + lvalue - ArenaScope - 2 x" + std::to_string(size)) {
+        ArenaScope arena;
+        return (left | ops::append(right)).size();
+    };
+
+    BENCHMARK("cefal::append() - accumulate chunks - default resource - 100 x" + std::to_string(size / 100)) {
+        TestType result = ops::empty<TestType>();
+        for (auto&& chunk : chunks)
+            result = std::move(result) | ops::append(chunk);
+        return result.size();
+    };
+
+    BENCHMARK("cefal::append() - accumulate chunks - ArenaScope - 100 x" + std::to_string(size / 100)) {
+        ArenaScope arena;
+        TestType result = ops::empty<TestType>();
+        for (auto&& chunk : chunks)
+            result = std::move(result) | ops::append(chunk);
+        return result.size();
+    };
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("cefal::append() - immutable", "", (std::vector, PersistentVector, std::unordered_set, PersistentSet),
+                           (int, Expensive<int>)) {
+    constexpr size_t size = ContainerSize_V<TestType>;
+    const TestType left = createContainer<TestType>(size, 0);
+    const TestType right = createContainer<TestType>(size, int(size));
+
+    BENCHMARK("cefal::append() - lvalue + lvalue - 2 x" + std::to_string(size)) {
+        return (left | ops::append(right)).size();
+    };
+
+    BENCHMARK("cefal::append() - lvalue + singleton - " + std::to_string(size)) {
+        return (left | ops::append(helpers::SingletonFrom<TestType>{cefal::InnerType_T<TestType>(42)})).size();
+    };
+}
@@ -1,4 +1,5 @@
 include(CMakeFindDependencyMacro)
+find_dependency(Threads)
 
 if(NOT TARGET cefal::cefal)
     include("${CMAKE_CURRENT_LIST_DIR}/cefal-targets.cmake")
@@ -27,21 +27,27 @@
 
 #include "cefal/detail/common_concepts.h"
 
+#include "cefal/helpers/arena.h"
+#include "cefal/helpers/execution.h"
 #include "cefal/helpers/inner_type.h"
 #include "cefal/helpers/nums.h"
+#include "cefal/helpers/reduced.h"
 
 #include <utility>
 
 namespace cefal {
 namespace ops {
 namespace detail {
+template <typename Op>
+struct FusedStage;
+
 template <typename Left, typename Op>
-inline auto operator|(Left&& left, Op&& op) {
+inline decltype(auto) operator|(Left&& left, Op&& op) {
     return std::forward<Op>(op)(std::forward<Left>(left));
 }
 } // namespace detail
 template <typename Left, typename Op>
-inline auto operator|(Left&& left, Op&& op) {
+inline decltype(auto) operator|(Left&& left, Op&& op) {
     return std::forward<Op>(op)(std::forward<Left>(left));
 }
 } // namespace ops
@@ -0,0 +1,135 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include "cefal/detail/persistent_hash_trie.h"
+
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+namespace cefal {
+namespace instances {
+namespace detail {
+template <typename Src, typename T>
+struct PersistentHashFoldable;
+} // namespace detail
+} // namespace instances
+
+namespace detail {
+struct PersistentMapKey {
+    template <typename K, typename V>
+    const K& operator()(const std::pair<K, V>& entry) const {
+        return entry.first;
+    }
+};
+} // namespace detail
+
+// Hash map with structural sharing, based on hash array mapped trie with branching factor of 32.
+// Copies are O(1) and share the whole trie, insert and erase are O(log32 n) and duplicate only nodes on the path
+// to changed entry, so keeping history of snapshots costs memory only for differences between them.
+// Nodes owned by single map are changed in place. Iteration order is unspecified, but the same for equal maps.
+template <typename K, typename V, typename Hash = std::hash<K>, typename KeyEqual = std::equal_to<K>>
+class PersistentMap {
+    using Trie = detail::PersistentHashTrie<K, std::pair<K, V>, detail::PersistentMapKey, Hash, KeyEqual>;
+
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<K, V>;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = const value_type&;
+    using const_reference = const value_type&;
+    using const_iterator = typename Trie::const_iterator;
+    using iterator = const_iterator;
+
+    PersistentMap() = default;
+    PersistentMap(std::initializer_list<value_type> values) : PersistentMap(values.begin(), values.end()) {}
+    template <std::input_iterator It, std::sentinel_for<It> End>
+    PersistentMap(It first, End last) {
+        for (; first != last; ++first)
+            insert(*first);
+    }
+
+    size_t size() const { return _trie.size(); }
+    bool empty() const { return _trie.empty(); }
+
+    const_iterator begin() const { return _trie.begin(); }
+    const_iterator end() const { return _trie.end(); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    hasher hash_function() const { return _trie.hashFunction(); }
+    key_equal key_eq() const { return _trie.keyEqual(); }
+
+    const_iterator find(const K& key) const { return _trie.find(key); }
+    bool contains(const K& key) const { return _trie.lookup(key); }
+    size_t count(const K& key) const { return contains(key); }
+    const V& at(const K& key) const {
+        const value_type* entry = _trie.lookup(key);
+        if (!entry)
+            throw std::out_of_range("cefal::PersistentMap::at");
+        return entry->second;
+    }
+
+    // Existing entry is kept, as in std::unordered_map. Returns true if entry was added
+    bool insert(const value_type& value) { return _trie.insert(value, false); }
+    bool insert(value_type&& value) { return _trie.insert(std::move(value), false); }
+    bool insert_or_assign(K key, V value) { return _trie.insert(value_type(std::move(key), std::move(value)), true); }
+    size_t erase(const K& key) { return _trie.erase(key); }
+
+    // Returns map with key set to value, only path to its entry is copied
+    PersistentMap set(K key, V value) const& {
+        PersistentMap result = *this;
+        result.insert_or_assign(std::move(key), std::move(value));
+        return result;
+    }
+    PersistentMap set(K key, V value) && {
+        insert_or_assign(std::move(key), std::move(value));
+        return std::move(*this);
+    }
+
+    friend bool operator==(const PersistentMap& left, const PersistentMap& right) { return left._trie == right._trie; }
+
+private:
+    template <typename, typename>
+    friend struct instances::detail::PersistentHashFoldable;
+
+    // Func gets entries of each trie node, see PersistentHashTrie::forEachNode()
+    template <typename Func>
+    bool forEachNode(Func& func) const {
+        return _trie.forEachNode(func);
+    }
+
+    Trie _trie;
+};
+} // namespace cefal
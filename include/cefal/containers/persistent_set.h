@@ -0,0 +1,113 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include "cefal/detail/persistent_hash_trie.h"
+
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <utility>
+
+namespace cefal {
+namespace instances {
+namespace detail {
+template <typename Src, typename T>
+struct PersistentHashFoldable;
+} // namespace detail
+} // namespace instances
+
+namespace detail {
+struct PersistentSetKey {
+    template <typename T>
+    const T& operator()(const T& entry) const {
+        return entry;
+    }
+};
+} // namespace detail
+
+// Hash set with structural sharing, same hash array mapped trie as in PersistentMap.
+// Copies are O(1), insert and erase are O(log32 n) and duplicate only nodes on the path to changed element.
+template <typename T, typename Hash = std::hash<T>, typename KeyEqual = std::equal_to<T>>
+class PersistentSet {
+    using Trie = detail::PersistentHashTrie<T, T, detail::PersistentSetKey, Hash, KeyEqual>;
+
+public:
+    using key_type = T;
+    using value_type = T;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = const T&;
+    using const_reference = const T&;
+    using const_iterator = typename Trie::const_iterator;
+    using iterator = const_iterator;
+
+    PersistentSet() = default;
+    PersistentSet(std::initializer_list<T> values) : PersistentSet(values.begin(), values.end()) {}
+    template <std::input_iterator It, std::sentinel_for<It> End>
+    PersistentSet(It first, End last) {
+        for (; first != last; ++first)
+            insert(*first);
+    }
+
+    size_t size() const { return _trie.size(); }
+    bool empty() const { return _trie.empty(); }
+
+    const_iterator begin() const { return _trie.begin(); }
+    const_iterator end() const { return _trie.end(); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    hasher hash_function() const { return _trie.hashFunction(); }
+    key_equal key_eq() const { return _trie.keyEqual(); }
+
+    const_iterator find(const T& value) const { return _trie.find(value); }
+    bool contains(const T& value) const { return _trie.lookup(value); }
+    size_t count(const T& value) const { return contains(value); }
+
+    // Returns true if element was added
+    bool insert(const T& value) { return _trie.insert(value, false); }
+    bool insert(T&& value) { return _trie.insert(std::move(value), false); }
+    size_t erase(const T& value) { return _trie.erase(value); }
+
+    friend bool operator==(const PersistentSet& left, const PersistentSet& right) { return left._trie == right._trie; }
+
+private:
+    template <typename, typename>
+    friend struct instances::detail::PersistentHashFoldable;
+
+    // Func gets elements of each trie node, see PersistentHashTrie::forEachNode()
+    template <typename Func>
+    bool forEachNode(Func& func) const {
+        return _trie.forEachNode(func);
+    }
+
+    Trie _trie;
+};
+} // namespace cefal
@@ -0,0 +1,510 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <compare>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace cefal {
+namespace instances {
+template <typename T>
+struct Foldable;
+} // namespace instances
+
+namespace detail {
+inline constexpr size_t persistentVectorBits = 5;
+inline constexpr size_t persistentVectorBranching = size_t(1) << persistentVectorBits;
+} // namespace detail
+
+// Vector with structural sharing, based on RRB-tree (relaxed radix balanced tree) with branching factor of 32.
+// Copies are O(1) and share the whole tree, changing a copy duplicates only nodes on the path to changed leaf,
+// so keeping history of snapshots costs memory only for differences between them. Nodes owned by single vector
+// are changed in place. Concatenation is O(log n), it rebuilds only nodes along the seam and shares the rest.
+// Reference counters are atomic, so copies sharing nodes can be used from different threads.
+template <typename T>
+class PersistentVector {
+    static constexpr size_t bits = detail::persistentVectorBits;
+    static constexpr size_t branching = detail::persistentVectorBranching;
+
+    struct Node;
+    class NodePtr {
+    public:
+        NodePtr() = default;
+        explicit NodePtr(Node* node) : _node(node) {}
+        NodePtr(const NodePtr& other) : _node(other._node) {
+            if (_node)
+                _node->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+        NodePtr(NodePtr&& other) noexcept : _node(std::exchange(other._node, nullptr)) {}
+        NodePtr& operator=(NodePtr other) noexcept {
+            std::swap(_node, other._node);
+            return *this;
+        }
+        ~NodePtr() { release(_node); }
+
+        Node* get() const { return _node; }
+        Node* operator->() const { return _node; }
+        explicit operator bool() const { return _node; }
+
+    private:
+        Node* _node = nullptr;
+    };
+
+    struct Node {
+        std::atomic<size_t> refs = 1;
+        // Leaves have zero height, all of them are at the same depth
+        size_t height = 0;
+        // Elements of leaf or children of inner node
+        size_t count = 0;
+    };
+
+    struct Leaf : Node {
+        ~Leaf() { std::destroy_n(values(), this->count); }
+        T* values() { return std::launder(reinterpret_cast<T*>(storage)); }
+        const T* values() const { return std::launder(reinterpret_cast<const T*>(storage)); }
+
+        alignas(T) std::byte storage[sizeof(T) * branching];
+    };
+
+    // Sizes are cumulative, so children don't need to be full. Lookup starts from the slot it would have in a full
+    // tree and moves right, which is exact for nodes that never were concatenated
+    struct Inner : Node {
+        NodePtr children[branching];
+        size_t sizes[branching];
+    };
+
+    struct Merged {
+        NodePtr nodes[2];
+        size_t count = 0;
+    };
+
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = const T&;
+    using const_reference = const T&;
+
+    // Leaf of current element is cached, so sequential access doesn't go through the tree for each element
+    class const_iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using iterator_concept = std::random_access_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() = default;
+
+        reference operator*() const {
+            if (_index - _leafBegin >= _leafSize)
+                _leaf = _vector->leafAt(_index, _leafBegin, _leafSize);
+            return _leaf[_index - _leafBegin];
+        }
+        pointer operator->() const { return &**this; }
+        reference operator[](difference_type n) const { return *(*this + n); }
+
+        const_iterator& operator++() {
+            ++_index;
+            return *this;
+        }
+        const_iterator operator++(int) {
+            auto result = *this;
+            ++_index;
+            return result;
+        }
+        const_iterator& operator--() {
+            --_index;
+            return *this;
+        }
+        const_iterator operator--(int) {
+            auto result = *this;
+            --_index;
+            return result;
+        }
+        const_iterator& operator+=(difference_type n) {
+            _index += n;
+            return *this;
+        }
+        const_iterator& operator-=(difference_type n) {
+            _index -= n;
+            return *this;
+        }
+        friend const_iterator operator+(const_iterator it, difference_type n) { return it += n; }
+        friend const_iterator operator+(difference_type n, const_iterator it) { return it += n; }
+        friend const_iterator operator-(const_iterator it, difference_type n) { return it -= n; }
+        friend difference_type operator-(const const_iterator& left, const const_iterator& right) {
+            return static_cast<difference_type>(left._index) - static_cast<difference_type>(right._index);
+        }
+        friend bool operator==(const const_iterator& left, const const_iterator& right) { return left._index == right._index; }
+        friend auto operator<=>(const const_iterator& left, const const_iterator& right) { return left._index <=> right._index; }
+
+    private:
+        friend class PersistentVector;
+        const_iterator(const PersistentVector* vector, size_t index) : _vector(vector), _index(index) {}
+
+        const PersistentVector* _vector = nullptr;
+        size_t _index = 0;
+        mutable const T* _leaf = nullptr;
+        mutable size_t _leafBegin = 0;
+        mutable size_t _leafSize = 0;
+    };
+    using iterator = const_iterator;
+
+    PersistentVector() = default;
+    PersistentVector(const PersistentVector&) = default;
+    PersistentVector(PersistentVector&& other) noexcept : _root(std::move(other._root)), _size(std::exchange(other._size, 0)) {}
+    PersistentVector& operator=(const PersistentVector&) = default;
+    PersistentVector& operator=(PersistentVector&& other) noexcept {
+        if (this != &other) {
+            _root = std::move(other._root);
+            _size = std::exchange(other._size, 0);
+        }
+        return *this;
+    }
+    PersistentVector(std::initializer_list<T> values) : PersistentVector(values.begin(), values.end()) {}
+    template <std::input_iterator It, std::sentinel_for<It> End>
+    PersistentVector(It first, End last) {
+        for (; first != last; ++first)
+            emplace_back(*first);
+    }
+
+    size_t size() const { return _size; }
+    bool empty() const { return !_size; }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, _size); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    const T& operator[](size_t index) const {
+        size_t leafBegin;
+        size_t leafSize;
+        return leafAt(index, leafBegin, leafSize)[index - leafBegin];
+    }
+    const T& front() const { return (*this)[0]; }
+    const T& back() const { return (*this)[_size - 1]; }
+
+    template <typename... Args>
+    void emplace_back(Args&&... args) {
+        if (!_root) {
+            _root = NodePtr(new Leaf);
+        } else if (isFull(_root.get())) {
+            NodePtr root(newInner(_root->height + 1));
+            appendChild(asInner(root.get()), std::move(_root));
+            _root = std::move(root);
+        }
+        emplaceInto(_root, std::forward<Args>(args)...);
+        ++_size;
+    }
+    void push_back(const T& value) { emplace_back(value); }
+    void push_back(T&& value) { emplace_back(std::move(value)); }
+
+    // Returns vector with element at index replaced, only path to this element is copied
+    PersistentVector set(size_t index, T value) const& {
+        PersistentVector result = *this;
+        replaceInto(result._root, index, std::move(value));
+        return result;
+    }
+    PersistentVector set(size_t index, T value) && {
+        replaceInto(_root, index, std::move(value));
+        return std::move(*this);
+    }
+
+    // Only nodes along the seam are rebuilt (and rebalanced if they got too sparse), everything else is shared
+    static PersistentVector concat(const PersistentVector& left, const PersistentVector& right) {
+        if (!right._size)
+            return left;
+        if (!left._size)
+            return right;
+        PersistentVector result;
+        result._size = left._size + right._size;
+        if (result._size <= branching && !left._root->height && !right._root->height) {
+            result._root = NodePtr(new Leaf);
+            copyItems(result._root.get(), left._root.get(), 0, left._size);
+            copyItems(result._root.get(), right._root.get(), 0, right._size);
+            return result;
+        }
+        Merged merged = concatNodes(left._root, right._root);
+        if (merged.count == 1) {
+            result._root = std::move(merged.nodes[0]);
+        } else {
+            result._root = NodePtr(newInner(merged.nodes[0]->height + 1));
+            appendChild(asInner(result._root.get()), std::move(merged.nodes[0]));
+            appendChild(asInner(result._root.get()), std::move(merged.nodes[1]));
+        }
+        while (result._root->height && result._root->count == 1)
+            result._root = NodePtr(asInner(result._root.get())->children[0]);
+        return result;
+    }
+
+    friend bool operator==(const PersistentVector& left, const PersistentVector& right) {
+        if (left._size != right._size)
+            return false;
+        return left._root.get() == right._root.get() || std::equal(left.begin(), left.end(), right.begin());
+    }
+
+private:
+    template <typename>
+    friend struct instances::Foldable;
+
+    static void release(Node* node) {
+        if (!node || node->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+        if (node->height)
+            delete asInner(node);
+        else
+            delete asLeaf(node);
+    }
+
+    static Leaf* asLeaf(Node* node) { return static_cast<Leaf*>(node); }
+    static const Leaf* asLeaf(const Node* node) { return static_cast<const Leaf*>(node); }
+    static Inner* asInner(Node* node) { return static_cast<Inner*>(node); }
+    static const Inner* asInner(const Node* node) { return static_cast<const Inner*>(node); }
+
+    static Inner* newInner(size_t height) {
+        Inner* inner = new Inner;
+        inner->height = height;
+        return inner;
+    }
+
+    static size_t sizeOf(const Node* node) { return node->height ? asInner(node)->sizes[node->count - 1] : node->count; }
+
+    // Element can't be added only if all nodes on the right spine are full
+    static bool isFull(const Node* node) {
+        if (node->count < branching)
+            return false;
+        return !node->height || isFull(asInner(node)->children[branching - 1].get());
+    }
+
+    static void appendChild(Inner* inner, NodePtr child) {
+        inner->sizes[inner->count] = (inner->count ? inner->sizes[inner->count - 1] : 0) + sizeOf(child.get());
+        inner->children[inner->count++] = std::move(child);
+    }
+
+    // Copies count items (elements of leaf or children of inner node) starting from offset to the end of dest
+    static void copyItems(Node* dest, const Node* src, size_t offset, size_t count) {
+        if (!src->height) {
+            std::uninitialized_copy_n(asLeaf(src)->values() + offset, count, asLeaf(dest)->values() + dest->count);
+            dest->count += count;
+        } else {
+            for (size_t i = offset; i < offset + count; ++i)
+                appendChild(asInner(dest), asInner(src)->children[i]);
+        }
+    }
+
+    static NodePtr copyNode(const Node* node) {
+        NodePtr result(node->height ? static_cast<Node*>(newInner(node->height)) : new Leaf);
+        copyItems(result.get(), node, 0, node->count);
+        return result;
+    }
+
+    static void makeUnique(NodePtr& node) {
+        if (node->refs.load(std::memory_order_acquire) != 1)
+            node = copyNode(node.get());
+    }
+
+    const T* leafAt(size_t index, size_t& leafBegin, size_t& leafSize) const {
+        const Node* node = _root.get();
+        leafBegin = 0;
+        while (node->height) {
+            const Inner* inner = asInner(node);
+            size_t slot = (index - leafBegin) >> (bits * node->height);
+            while (inner->sizes[slot] <= index - leafBegin)
+                ++slot;
+            if (slot)
+                leafBegin += inner->sizes[slot - 1];
+            node = inner->children[slot].get();
+        }
+        leafSize = node->count;
+        return asLeaf(node)->values();
+    }
+
+    template <typename... Args>
+    static void emplaceInto(NodePtr& node, Args&&... args) {
+        makeUnique(node);
+        if (!node->height) {
+            Leaf* leaf = asLeaf(node.get());
+            new (leaf->values() + leaf->count) T(std::forward<Args>(args)...);
+            ++leaf->count;
+            return;
+        }
+        Inner* inner = asInner(node.get());
+        if (isFull(inner->children[inner->count - 1].get())) {
+            NodePtr path(new Leaf);
+            for (size_t height = 1; height < node->height; ++height) {
+                NodePtr parent(newInner(height));
+                appendChild(asInner(parent.get()), std::move(path));
+                path = std::move(parent);
+            }
+            appendChild(inner, std::move(path));
+        }
+        emplaceInto(inner->children[inner->count - 1], std::forward<Args>(args)...);
+        ++inner->sizes[inner->count - 1];
+    }
+
+    static void replaceInto(NodePtr& node, size_t index, T&& value) {
+        makeUnique(node);
+        if (!node->height) {
+            asLeaf(node.get())->values()[index] = std::move(value);
+            return;
+        }
+        Inner* inner = asInner(node.get());
+        size_t slot = index >> (bits * node->height);
+        while (inner->sizes[slot] <= index)
+            ++slot;
+        replaceInto(inner->children[slot], slot ? index - inner->sizes[slot - 1] : index, std::move(value));
+    }
+
+    // Returns one or two nodes with height of the taller argument
+    static Merged concatNodes(const NodePtr& left, const NodePtr& right) {
+        if (left->height > right->height) {
+            const Inner* inner = asInner(left.get());
+            return rebalance(inner, concatNodes(inner->children[inner->count - 1], right), nullptr, left->height);
+        }
+        if (left->height < right->height) {
+            const Inner* inner = asInner(right.get());
+            return rebalance(nullptr, concatNodes(left, inner->children[0]), inner, right->height);
+        }
+        if (!left->height) {
+            Merged result;
+            result.nodes[0] = left;
+            result.nodes[1] = right;
+            result.count = 2;
+            return result;
+        }
+        const Inner* leftInner = asInner(left.get());
+        const Inner* rightInner = asInner(right.get());
+        return rebalance(leftInner, concatNodes(leftInner->children[leftInner->count - 1], rightInner->children[0]), rightInner,
+                         left->height);
+    }
+
+    // Children of left (except the last one), middle and children of right (except the first one) are gathered
+    // under one or two new nodes of given height
+    static Merged rebalance(const Inner* left, Merged&& middle, const Inner* right, size_t height) {
+        NodePtr children[2 * branching];
+        size_t count = 0;
+        for (size_t i = 0; left && i + 1 < left->count; ++i)
+            children[count++] = left->children[i];
+        for (size_t i = 0; i < middle.count; ++i)
+            children[count++] = std::move(middle.nodes[i]);
+        for (size_t i = 1; right && i < right->count; ++i)
+            children[count++] = right->children[i];
+        count = redistribute(children, count, height - 1);
+
+        Merged result;
+        for (size_t begin = 0; begin < count; begin += branching) {
+            NodePtr node(newInner(height));
+            for (size_t i = begin; i < std::min(count, begin + branching); ++i)
+                appendChild(asInner(node.get()), std::move(children[i]));
+            result.nodes[result.count++] = std::move(node);
+        }
+        return result;
+    }
+
+    // Keeps RRB invariant: number of nodes exceeds the minimal one (all nodes full) by at most one.
+    // Short nodes are merged with following ones, full nodes before first short one are reused as is.
+    static size_t redistribute(NodePtr* nodes, size_t count, size_t height) {
+        size_t sizes[2 * branching + 1] = {};
+        size_t total = 0;
+        for (size_t i = 0; i < count; ++i) {
+            sizes[i] = nodes[i]->count;
+            total += sizes[i];
+        }
+        const size_t optimal = (total + branching - 1) / branching;
+        size_t planned = count;
+        for (size_t i = 0; planned > optimal + 1;) {
+            while (sizes[i] == branching)
+                ++i;
+            size_t remaining = sizes[i];
+            do {
+                const size_t filled = std::min(remaining + sizes[i + 1], branching);
+                remaining = remaining + sizes[i + 1] - filled;
+                sizes[i++] = filled;
+            } while (remaining);
+            std::move(sizes + i + 1, sizes + planned, sizes + i);
+            sizes[--planned] = 0;
+            --i;
+        }
+        if (planned == count)
+            return count;
+
+        NodePtr result[2 * branching];
+        size_t source = 0;
+        size_t offset = 0;
+        for (size_t i = 0; i < planned; ++i) {
+            if (!offset && nodes[source]->count == sizes[i]) {
+                result[i] = std::move(nodes[source++]);
+                continue;
+            }
+            result[i] = NodePtr(height ? static_cast<Node*>(newInner(height)) : new Leaf);
+            while (result[i]->count < sizes[i]) {
+                const size_t taken = std::min(sizes[i] - result[i]->count, nodes[source]->count - offset);
+                copyItems(result[i].get(), nodes[source].get(), offset, taken);
+                offset += taken;
+                if (offset == nodes[source]->count) {
+                    ++source;
+                    offset = 0;
+                }
+            }
+        }
+        for (size_t i = 0; i < count; ++i)
+            nodes[i] = i < planned ? std::move(result[i]) : NodePtr();
+        return planned;
+    }
+
+    // Func gets elements of each leaf in order and returns true to stop. Leaf is writable if it is reachable only
+    // through this vector, so its elements can be moved from by rvalue folds.
+    template <typename Func>
+    bool forEachLeaf(Func& func) const {
+        return _root && forEachLeaf(_root.get(), true, func);
+    }
+    template <typename Func>
+    static bool forEachLeaf(Node* node, bool unique, Func& func) {
+        unique = unique && node->refs.load(std::memory_order_acquire) == 1;
+        if (!node->height)
+            return func(asLeaf(node)->values(), node->count, unique);
+        Inner* inner = asInner(node);
+        for (size_t i = 0; i < inner->count; ++i) {
+            if (forEachLeaf(inner->children[i].get(), unique, func))
+                return true;
+        }
+        return false;
+    }
+
+    NodePtr _root;
+    size_t _size = 0;
+};
+} // namespace cefal
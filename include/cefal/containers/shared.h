@@ -0,0 +1,156 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace cefal {
+// Refcounted handle over a container with value semantics: copies are O(1) and share the same container, which gets
+// copied only when one of handles is changed. Operations on rvalue handle that is the only owner of its container
+// reuse it the same way as rvalue container would, shared handles fall back to immutable path.
+// Default constructed handle doesn't allocate anything and behaves as empty container.
+template <typename C>
+class Shared {
+public:
+    using container_type = C;
+    using value_type = typename C::value_type;
+    using size_type = typename C::size_type;
+    using difference_type = typename C::difference_type;
+    using reference = typename C::const_reference;
+    using const_reference = typename C::const_reference;
+    using const_iterator = typename C::const_iterator;
+    using iterator = const_iterator;
+
+    Shared() = default;
+    Shared(std::initializer_list<value_type> values) : _block(new Block{C(values)}) {}
+    explicit Shared(const C& container) : _block(new Block{container}) {}
+    explicit Shared(C&& container) : _block(new Block{std::move(container)}) {}
+
+    Shared(const Shared& other) noexcept : _block(other._block) {
+        if (_block)
+            _block->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    Shared(Shared&& other) noexcept : _block(std::exchange(other._block, nullptr)) {}
+    Shared& operator=(Shared other) noexcept {
+        std::swap(_block, other._block);
+        return *this;
+    }
+    ~Shared() { release(_block); }
+
+    const C& get() const {
+        static const C emptyContainer;
+        return _block ? _block->container : emptyContainer;
+    }
+    const C& operator*() const { return get(); }
+    const C* operator->() const { return &get(); }
+
+    // Counter is read with acquire, so reads of container by handles released on other threads happen before
+    // caller changes it in place. There are no weak references, so counter can't grow concurrently for the only owner
+    bool unique() const { return !_block || _block->refs.load(std::memory_order_acquire) == 1; }
+
+    // Container is copied first if it is shared with other handles
+    C& mutate() {
+        if (!_block)
+            _block = new Block{C()};
+        else if (!unique())
+            *this = Shared(std::as_const(_block->container));
+        return _block->container;
+    }
+
+    // Moves container out if handle is the only owner, copies it otherwise. Handle becomes empty
+    C take() && {
+        Shared handle = std::move(*this);
+        if (!handle._block)
+            return C();
+        if (handle.unique())
+            return std::move(handle._block->container);
+        return C(std::as_const(handle._block->container));
+    }
+
+    size_t size() const { return _block ? _block->container.size() : 0; }
+    bool empty() const { return !_block || _block->container.empty(); }
+
+    const_iterator begin() const { return get().begin(); }
+    const_iterator end() const { return get().end(); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    friend bool operator==(const Shared& left, const Shared& right) {
+        return left._block == right._block || left.get() == right.get();
+    }
+
+private:
+    struct Block {
+        C container;
+        std::atomic<size_t> refs = 1;
+    };
+
+    static void release(Block* block) {
+        if (block && block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete block;
+    }
+
+    Block* _block = nullptr;
+};
+
+namespace detail {
+// Calls func with container of the handle: as rvalue if handle is rvalue and the only owner, as const lvalue otherwise.
+// If func can't get lvalue (LvalueAccepted is false), shared container is copied and copy is passed as rvalue.
+template <bool LvalueAccepted, typename Input, typename Func>
+auto withSharedContainer(Input&& src, Func&& func) {
+    using C = typename std::remove_cvref_t<Input>::container_type;
+    if constexpr (!std::is_lvalue_reference_v<Input>) {
+        if (src.unique())
+            return func(std::move(src).take());
+    }
+    if constexpr (LvalueAccepted)
+        return func(src.get());
+    else
+        return func(C(src.get()));
+}
+
+// Same as withSharedContainer(), but result of func is wrapped to handle. If func returns the same container type
+// and handle is the only owner, result is assigned back to the same allocation and handle itself is returned
+template <bool LvalueAccepted, typename Input, typename Func>
+auto transformShared(Input&& src, Func&& func) {
+    using C = typename std::remove_cvref_t<Input>::container_type;
+    using Result = std::remove_cvref_t<decltype(func(std::declval<C>()))>;
+    if constexpr (std::is_same_v<Result, C> && !std::is_lvalue_reference_v<Input>) {
+        if (src.unique()) {
+            C& container = src.mutate();
+            container = func(std::move(container));
+            return std::move(src);
+        }
+    }
+    return Shared<Result>(withSharedContainer<LvalueAccepted>(std::forward<Input>(src), std::forward<Func>(func)));
+}
+} // namespace detail
+} // namespace cefal
@@ -0,0 +1,341 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <compare>
+#include <concepts>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace cefal {
+// Vector that keeps up to N elements inline and goes to heap only when it grows bigger, so short vectors
+// (i.e. results of unit() or of flatMap callbacks) cost no allocation at all. Has the same interface and iterator
+// invalidation rules as std::vector, except that moving an inline vector moves its elements one by one.
+template <typename T, size_t N = 4>
+class SmallVector {
+    static_assert(N > 0, "Inline capacity should be positive");
+
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+    using iterator = T*;
+    using const_iterator = const T*;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    static constexpr size_t inlineCapacity = N;
+
+    SmallVector() noexcept : _data(inlineData()) {}
+    explicit SmallVector(size_t count) : SmallVector() { resize(count); }
+    SmallVector(size_t count, const T& value) : SmallVector() { resize(count, value); }
+    SmallVector(std::initializer_list<T> values) : SmallVector(values.begin(), values.end()) {}
+    template <std::input_iterator It, std::sentinel_for<It> End>
+    SmallVector(It first, End last) : SmallVector() {
+        insert(end(), first, last);
+    }
+
+    SmallVector(const SmallVector& other) : SmallVector() {
+        reserve(other.size());
+        std::uninitialized_copy(other.begin(), other.end(), _data);
+        _size = other.size();
+    }
+    SmallVector(SmallVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>) : SmallVector() {
+        takeFrom(std::move(other));
+    }
+    ~SmallVector() {
+        clear();
+        deallocate();
+    }
+
+    SmallVector& operator=(const SmallVector& other) {
+        if (this != &other)
+            assign(other.begin(), other.end());
+        return *this;
+    }
+    SmallVector& operator=(SmallVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+        if (this != &other) {
+            clear();
+            if (!other.isInline())
+                deallocate();
+            takeFrom(std::move(other));
+        }
+        return *this;
+    }
+    SmallVector& operator=(std::initializer_list<T> values) {
+        assign(values.begin(), values.end());
+        return *this;
+    }
+
+    template <std::input_iterator It, std::sentinel_for<It> End>
+    void assign(It first, End last) {
+        clear();
+        insert(end(), first, last);
+    }
+
+    size_t size() const { return _size; }
+    size_t capacity() const { return _capacity; }
+    size_t max_size() const { return std::allocator_traits<std::allocator<T>>::max_size(std::allocator<T>()); }
+    bool empty() const { return !_size; }
+    // Elements are stored inside of vector itself, no heap allocation is owned
+    bool isInline() const { return _data == inlineData(); }
+
+    T* data() { return _data; }
+    const T* data() const { return _data; }
+
+    iterator begin() { return _data; }
+    iterator end() { return _data + _size; }
+    const_iterator begin() const { return _data; }
+    const_iterator end() const { return _data + _size; }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+    reverse_iterator rbegin() { return reverse_iterator(end()); }
+    reverse_iterator rend() { return reverse_iterator(begin()); }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+    T& operator[](size_t index) { return _data[index]; }
+    const T& operator[](size_t index) const { return _data[index]; }
+    T& at(size_t index) {
+        if (index >= _size)
+            throw std::out_of_range("SmallVector::at");
+        return _data[index];
+    }
+    const T& at(size_t index) const {
+        if (index >= _size)
+            throw std::out_of_range("SmallVector::at");
+        return _data[index];
+    }
+    T& front() { return _data[0]; }
+    const T& front() const { return _data[0]; }
+    T& back() { return _data[_size - 1]; }
+    const T& back() const { return _data[_size - 1]; }
+
+    void reserve(size_t newCapacity) {
+        if (newCapacity > _capacity)
+            reallocate(newCapacity);
+    }
+
+    // Goes back to inline storage if elements fit there
+    void shrink_to_fit() {
+        if (!isInline() && _size < _capacity)
+            reallocate(_size);
+    }
+
+    void clear() noexcept {
+        std::destroy_n(_data, _size);
+        _size = 0;
+    }
+
+    void resize(size_t newSize) { resizeImpl(newSize, [](T* place) { std::uninitialized_value_construct_n(place, 1); }); }
+    void resize(size_t newSize, const T& value) {
+        if (newSize > _capacity) {
+            // Value can refer to element of this vector, which is relocated on growth
+            T copy = value;
+            resizeImpl(newSize, [&copy](T* place) { std::uninitialized_fill_n(place, 1, copy); });
+        } else {
+            resizeImpl(newSize, [&value](T* place) { std::uninitialized_fill_n(place, 1, value); });
+        }
+    }
+
+    void push_back(const T& value) { emplace_back(value); }
+    void push_back(T&& value) { emplace_back(std::move(value)); }
+
+    // New element is constructed before old ones are relocated, so args can refer to elements of this vector
+    template <typename... Args>
+    T& emplace_back(Args&&... args) {
+        if (_size == _capacity) {
+            size_t newCapacity = grownCapacity(_size + 1);
+            T* newData = allocate(newCapacity);
+            try {
+                std::construct_at(newData + _size, std::forward<Args>(args)...);
+            } catch (...) {
+                std::allocator<T>().deallocate(newData, newCapacity);
+                throw;
+            }
+            try {
+                relocate(_data, _size, newData);
+            } catch (...) {
+                std::destroy_at(newData + _size);
+                std::allocator<T>().deallocate(newData, newCapacity);
+                throw;
+            }
+            deallocate();
+            _data = newData;
+            _capacity = newCapacity;
+        } else {
+            std::construct_at(_data + _size, std::forward<Args>(args)...);
+        }
+        return _data[_size++];
+    }
+
+    void pop_back() { std::destroy_at(_data + --_size); }
+
+    // Elements are appended and then rotated into their place
+    template <typename... Args>
+    iterator emplace(const_iterator pos, Args&&... args) {
+        size_t index = pos - begin();
+        emplace_back(std::forward<Args>(args)...);
+        std::rotate(begin() + index, end() - 1, end());
+        return begin() + index;
+    }
+    iterator insert(const_iterator pos, const T& value) { return emplace(pos, value); }
+    iterator insert(const_iterator pos, T&& value) { return emplace(pos, std::move(value)); }
+    iterator insert(const_iterator pos, size_t count, const T& value) {
+        size_t index = pos - begin();
+        size_t oldSize = _size;
+        resize(_size + count, value);
+        std::rotate(begin() + index, begin() + oldSize, end());
+        return begin() + index;
+    }
+    iterator insert(const_iterator pos, std::initializer_list<T> values) { return insert(pos, values.begin(), values.end()); }
+    template <std::input_iterator It, std::sentinel_for<It> End>
+    iterator insert(const_iterator pos, It first, End last) {
+        size_t index = pos - begin();
+        size_t oldSize = _size;
+        if constexpr (std::forward_iterator<It>) {
+            size_t newSize = _size + std::ranges::distance(first, last);
+            if (newSize > _capacity)
+                reallocate(grownCapacity(newSize));
+        }
+        for (; first != last; ++first)
+            emplace_back(*first);
+        std::rotate(begin() + index, begin() + oldSize, end());
+        return begin() + index;
+    }
+
+    iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+    iterator erase(const_iterator first, const_iterator last) {
+        iterator from = begin() + (first - begin());
+        iterator to = begin() + (last - begin());
+        if (from != to) {
+            iterator newEnd = std::move(to, end(), from);
+            std::destroy(newEnd, end());
+            _size = newEnd - begin();
+        }
+        return from;
+    }
+
+    void swap(SmallVector& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+        SmallVector tmp = std::move(other);
+        other = std::move(*this);
+        *this = std::move(tmp);
+    }
+    friend void swap(SmallVector& left, SmallVector& right) noexcept(noexcept(left.swap(right))) { left.swap(right); }
+
+    friend bool operator==(const SmallVector& left, const SmallVector& right) {
+        return std::equal(left.begin(), left.end(), right.begin(), right.end());
+    }
+    friend auto operator<=>(const SmallVector& left, const SmallVector& right) requires std::three_way_comparable<T> {
+        return std::lexicographical_compare_three_way(left.begin(), left.end(), right.begin(), right.end());
+    }
+
+private:
+    T* inlineData() { return std::launder(reinterpret_cast<T*>(_storage)); }
+    const T* inlineData() const { return std::launder(reinterpret_cast<const T*>(_storage)); }
+
+    static T* allocate(size_t count) { return std::allocator<T>().allocate(count); }
+    void deallocate() {
+        if (!isInline())
+            std::allocator<T>().deallocate(_data, _capacity);
+        _data = inlineData();
+        _capacity = N;
+    }
+
+    size_t grownCapacity(size_t required) const { return std::max(required, 2 * _capacity); }
+
+    // Elements are moved if it can't throw, copied otherwise, so failed relocation leaves source intact
+    static void relocate(T* from, size_t count, T* to) {
+        if constexpr (std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>)
+            std::uninitialized_move_n(from, count, to);
+        else
+            std::uninitialized_copy_n(from, count, to);
+        std::destroy_n(from, count);
+    }
+
+    void reallocate(size_t newCapacity) {
+        T* newData = newCapacity > N ? allocate(newCapacity) : inlineData();
+        if (newData == _data)
+            return;
+        try {
+            relocate(_data, _size, newData);
+        } catch (...) {
+            if (newCapacity > N)
+                std::allocator<T>().deallocate(newData, newCapacity);
+            throw;
+        }
+        T* oldData = _data;
+        size_t oldCapacity = _capacity;
+        _data = newData;
+        _capacity = std::max(newCapacity, N);
+        if (oldData != inlineData())
+            std::allocator<T>().deallocate(oldData, oldCapacity);
+    }
+
+    template <typename Construct>
+    void resizeImpl(size_t newSize, Construct&& construct) {
+        if (newSize < _size) {
+            std::destroy(begin() + newSize, end());
+            _size = newSize;
+            return;
+        }
+        if (newSize > _capacity)
+            reallocate(grownCapacity(newSize));
+        for (; _size < newSize; ++_size)
+            construct(_data + _size);
+    }
+
+    // Heap buffer is stolen, inline elements are moved one by one. Expects this vector to be empty and to be inline
+    // if other one is not
+    void takeFrom(SmallVector&& other) {
+        if (other.isInline()) {
+            std::uninitialized_move_n(other._data, other._size, _data);
+            _size = other._size;
+            other.clear();
+        } else {
+            _data = std::exchange(other._data, other.inlineData());
+            _size = std::exchange(other._size, 0);
+            _capacity = std::exchange(other._capacity, N);
+        }
+    }
+
+    T* _data;
+    size_t _size = 0;
+    size_t _capacity = N;
+    alignas(T) std::byte _storage[sizeof(T) * N];
+};
+} // namespace cefal
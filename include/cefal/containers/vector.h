@@ -0,0 +1,467 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include "cefal/helpers/trivially_relocatable.h"
+
+#include <algorithm>
+#include <compare>
+#include <concepts>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#if defined(__linux__)
+#    include <sys/mman.h>
+#    include <unistd.h>
+#endif
+
+namespace cefal {
+namespace detail {
+// Buffers of at least this size are mapped directly from the OS instead of going through allocator.
+// Smaller ones are left to malloc, which reuses already touched memory for them, while fresh mapping
+// faults on each page. Bigger ones are mapped by malloc anyway (its mmap threshold is capped at 32 MiB)
+inline constexpr size_t vectorMappingThreshold = size_t(1) << 25;
+inline constexpr size_t vectorMappingMaxAlignment = 4096;
+
+inline bool isMappedVectorStorage(size_t bytes, size_t alignment) {
+#if defined(__linux__)
+    return bytes >= vectorMappingThreshold && alignment <= vectorMappingMaxAlignment;
+#else
+    return false;
+#endif
+}
+
+#if defined(__linux__)
+inline size_t vectorMappingLength(size_t bytes) {
+    static const size_t pageSize = sysconf(_SC_PAGESIZE);
+    return (bytes + pageSize - 1) / pageSize * pageSize;
+}
+#endif
+
+inline void* allocateVectorStorage(size_t bytes, size_t alignment) {
+    if (!bytes)
+        return nullptr;
+#if defined(__linux__)
+    if (isMappedVectorStorage(bytes, alignment)) {
+        void* data = mmap(nullptr, vectorMappingLength(bytes), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (data == MAP_FAILED)
+            throw std::bad_alloc();
+        return data;
+    }
+#endif
+    if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+        return ::operator new(bytes, std::align_val_t(alignment));
+    return ::operator new(bytes);
+}
+
+inline void deallocateVectorStorage(void* data, size_t bytes, size_t alignment) noexcept {
+    if (!data)
+        return;
+#if defined(__linux__)
+    if (isMappedVectorStorage(bytes, alignment)) {
+        munmap(data, vectorMappingLength(bytes));
+        return;
+    }
+#endif
+    if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+        ::operator delete(data, bytes, std::align_val_t(alignment));
+    else
+        ::operator delete(data, bytes);
+}
+
+// Both sizes should be mapped ones. Pages are moved to a new address by kernel if mapping can't grow in place,
+// so nothing is copied and peak memory is the new size only. Returns nullptr if storage can't be remapped
+inline void* remapVectorStorage(void* data, size_t oldBytes, size_t newBytes) noexcept {
+#if defined(__linux__)
+    void* result = mremap(data, vectorMappingLength(oldBytes), vectorMappingLength(newBytes), MREMAP_MAYMOVE);
+    return result == MAP_FAILED ? nullptr : result;
+#else
+    return nullptr;
+#endif
+}
+} // namespace detail
+
+// Vector with the same interface and iterator invalidation rules as std::vector, which is tuned for big buffers.
+// Elements of IsTriviallyRelocatable types are relocated with memcpy on growth and shifted with memmove on insert
+// and erase. Buffers bigger than detail::vectorMappingThreshold are mapped directly and grow with mremap (on Linux),
+// so growing a multi-GB buffer doesn't copy it and doesn't need memory for old and new buffers at the same time.
+// Untouched tail of mapped capacity doesn't take physical memory.
+template <typename T>
+class Vector {
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+    using iterator = T*;
+    using const_iterator = const T*;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    Vector() noexcept = default;
+    // Constructors delegate to default one, so destructor cleans up if element constructor throws
+    explicit Vector(size_t count) : Vector() { resize(count); }
+    Vector(size_t count, const T& value) : Vector() { resize(count, value); }
+    Vector(std::initializer_list<T> values) : Vector(values.begin(), values.end()) {}
+    template <std::input_iterator It, std::sentinel_for<It> End>
+    Vector(It first, End last) : Vector() {
+        insert(end(), first, last);
+    }
+
+    Vector(const Vector& other) : Vector() {
+        reserve(other.size());
+        std::uninitialized_copy(other.begin(), other.end(), _data);
+        _size = other.size();
+    }
+    Vector(Vector&& other) noexcept
+        : _data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0)),
+          _capacity(std::exchange(other._capacity, 0)) {}
+    ~Vector() {
+        clear();
+        deallocate(_data, _capacity);
+    }
+
+    Vector& operator=(const Vector& other) {
+        if (this != &other)
+            assign(other.begin(), other.end());
+        return *this;
+    }
+    Vector& operator=(Vector&& other) noexcept {
+        Vector moved = std::move(other);
+        swap(moved);
+        return *this;
+    }
+    Vector& operator=(std::initializer_list<T> values) {
+        assign(values.begin(), values.end());
+        return *this;
+    }
+
+    template <std::input_iterator It, std::sentinel_for<It> End>
+    void assign(It first, End last) {
+        clear();
+        insert(end(), first, last);
+    }
+
+    size_t size() const { return _size; }
+    size_t capacity() const { return _capacity; }
+    size_t max_size() const { return std::allocator_traits<std::allocator<T>>::max_size(std::allocator<T>()); }
+    bool empty() const { return !_size; }
+    // Storage is mapped from the OS directly and is resized with mremap
+    bool isMapped() const { return isMappedCapacity(_capacity); }
+
+    T* data() { return _data; }
+    const T* data() const { return _data; }
+
+    iterator begin() { return _data; }
+    iterator end() { return _data + _size; }
+    const_iterator begin() const { return _data; }
+    const_iterator end() const { return _data + _size; }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+    reverse_iterator rbegin() { return reverse_iterator(end()); }
+    reverse_iterator rend() { return reverse_iterator(begin()); }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+    T& operator[](size_t index) { return _data[index]; }
+    const T& operator[](size_t index) const { return _data[index]; }
+    T& at(size_t index) {
+        if (index >= _size)
+            throw std::out_of_range("Vector::at");
+        return _data[index];
+    }
+    const T& at(size_t index) const {
+        if (index >= _size)
+            throw std::out_of_range("Vector::at");
+        return _data[index];
+    }
+    T& front() { return _data[0]; }
+    const T& front() const { return _data[0]; }
+    T& back() { return _data[_size - 1]; }
+    const T& back() const { return _data[_size - 1]; }
+
+    void reserve(size_t newCapacity) {
+        if (newCapacity > _capacity)
+            reallocate(newCapacity);
+    }
+
+    void shrink_to_fit() {
+        if (_size < _capacity)
+            reallocate(_size);
+    }
+
+    void clear() noexcept {
+        std::destroy_n(_data, _size);
+        _size = 0;
+    }
+
+    void resize(size_t newSize) {
+        resizeImpl(newSize, [](T* place, size_t count) { std::uninitialized_value_construct_n(place, count); });
+    }
+    void resize(size_t newSize, const T& value) {
+        if (newSize > _capacity) {
+            // Value can refer to element of this vector, which is relocated on growth
+            T copy = value;
+            resizeImpl(newSize, [&copy](T* place, size_t count) { std::uninitialized_fill_n(place, count, copy); });
+        } else {
+            resizeImpl(newSize, [&value](T* place, size_t count) { std::uninitialized_fill_n(place, count, value); });
+        }
+    }
+
+    void push_back(const T& value) { emplace_back(value); }
+    void push_back(T&& value) { emplace_back(std::move(value)); }
+
+    template <typename... Args>
+    T& emplace_back(Args&&... args) {
+        if (_size == _capacity)
+            return growAndEmplace(std::forward<Args>(args)...);
+        std::construct_at(_data + _size, std::forward<Args>(args)...);
+        return _data[_size++];
+    }
+
+    void pop_back() { std::destroy_at(_data + --_size); }
+
+    template <typename... Args>
+    iterator emplace(const_iterator pos, Args&&... args) {
+        size_t index = pos - begin();
+        if (index == _size) {
+            emplace_back(std::forward<Args>(args)...);
+            return begin() + index;
+        }
+        if constexpr (IsTriviallyRelocatable_V<T>) {
+            // Args can refer to elements that are shifted or relocated, so value is created upfront
+            T value(std::forward<Args>(args)...);
+            grow(_size + 1);
+            T* place = _data + index;
+            std::memmove(static_cast<void*>(place + 1), static_cast<const void*>(place), (_size - index) * sizeof(T));
+            std::construct_at(place, std::move(value));
+            ++_size;
+        } else {
+            emplace_back(std::forward<Args>(args)...);
+            std::rotate(begin() + index, end() - 1, end());
+        }
+        return begin() + index;
+    }
+    iterator insert(const_iterator pos, const T& value) { return emplace(pos, value); }
+    iterator insert(const_iterator pos, T&& value) { return emplace(pos, std::move(value)); }
+    iterator insert(const_iterator pos, size_t count, const T& value) {
+        size_t index = pos - begin();
+        size_t oldSize = _size;
+        resize(_size + count, value);
+        std::rotate(begin() + index, begin() + oldSize, end());
+        return begin() + index;
+    }
+    iterator insert(const_iterator pos, std::initializer_list<T> values) { return insert(pos, values.begin(), values.end()); }
+
+    // Trivially relocatable elements after pos are shifted with single memmove to make a gap for new ones
+    template <std::input_iterator It, std::sentinel_for<It> End>
+    iterator insert(const_iterator pos, It first, End last) {
+        size_t index = pos - begin();
+        size_t oldSize = _size;
+        // move_iterator is only an input iterator in C++20, but its distance is still known upfront
+        if constexpr (std::forward_iterator<It> || std::sized_sentinel_for<End, It>) {
+            size_t count = std::ranges::distance(first, last);
+            grow(_size + count);
+            if constexpr (IsTriviallyRelocatable_V<T>) {
+                if (index != _size)
+                    return insertIntoGap(index, count, first);
+            }
+            std::uninitialized_copy_n(first, count, end());
+            _size += count;
+        } else {
+            for (; first != last; ++first)
+                emplace_back(*first);
+        }
+        std::rotate(begin() + index, begin() + oldSize, end());
+        return begin() + index;
+    }
+
+    iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+    iterator erase(const_iterator first, const_iterator last) {
+        iterator from = begin() + (first - begin());
+        iterator to = begin() + (last - begin());
+        if (from == to)
+            return from;
+        if constexpr (IsTriviallyRelocatable_V<T>) {
+            std::destroy(from, to);
+            std::memmove(static_cast<void*>(from), static_cast<const void*>(to), (end() - to) * sizeof(T));
+            _size -= to - from;
+        } else {
+            iterator newEnd = std::move(to, end(), from);
+            std::destroy(newEnd, end());
+            _size = newEnd - begin();
+        }
+        return from;
+    }
+
+    void swap(Vector& other) noexcept {
+        std::swap(_data, other._data);
+        std::swap(_size, other._size);
+        std::swap(_capacity, other._capacity);
+    }
+    friend void swap(Vector& left, Vector& right) noexcept { left.swap(right); }
+
+    friend bool operator==(const Vector& left, const Vector& right) {
+        return std::equal(left.begin(), left.end(), right.begin(), right.end());
+    }
+    friend auto operator<=>(const Vector& left, const Vector& right) requires std::three_way_comparable<T> {
+        return std::lexicographical_compare_three_way(left.begin(), left.end(), right.begin(), right.end());
+    }
+
+private:
+    static bool isMappedCapacity(size_t capacity) {
+        return detail::isMappedVectorStorage(capacity * sizeof(T), alignof(T));
+    }
+    static T* allocate(size_t capacity) {
+        return static_cast<T*>(detail::allocateVectorStorage(capacity * sizeof(T), alignof(T)));
+    }
+    static void deallocate(T* data, size_t capacity) noexcept {
+        detail::deallocateVectorStorage(data, capacity * sizeof(T), alignof(T));
+    }
+
+    // Trivially relocatable elements are copied bytewise, others are moved if it can't throw and copied otherwise,
+    // so failed relocation leaves source intact
+    static void relocate(T* from, size_t count, T* to) {
+        if constexpr (IsTriviallyRelocatable_V<T>) {
+            if (count)
+                std::memcpy(static_cast<void*>(to), static_cast<const void*>(from), count * sizeof(T));
+        } else {
+            if constexpr (std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>)
+                std::uninitialized_move_n(from, count, to);
+            else
+                std::uninitialized_copy_n(from, count, to);
+            std::destroy_n(from, count);
+        }
+    }
+
+    void reallocate(size_t newCapacity) {
+        if constexpr (IsTriviallyRelocatable_V<T>) {
+            if (isMappedCapacity(_capacity) && isMappedCapacity(newCapacity)) {
+                if (void* data = detail::remapVectorStorage(_data, _capacity * sizeof(T), newCapacity * sizeof(T))) {
+                    _data = static_cast<T*>(data);
+                    _capacity = newCapacity;
+                    return;
+                }
+            }
+        }
+        T* newData = allocate(newCapacity);
+        try {
+            relocate(_data, _size, newData);
+        } catch (...) {
+            deallocate(newData, newCapacity);
+            throw;
+        }
+        deallocate(_data, _capacity);
+        _data = newData;
+        _capacity = newCapacity;
+    }
+
+    // Capacity grows geometrically, so appending elements one by one stays amortized linear
+    void grow(size_t required) {
+        if (required > _capacity)
+            reallocate(std::max(required, 2 * _capacity));
+    }
+
+    // New element is constructed before old ones are relocated, so args can refer to elements of this vector.
+    // Mapped storage is remapped in place, so value is created upfront for it instead
+    template <typename... Args>
+    T& growAndEmplace(Args&&... args) {
+        size_t newCapacity = std::max<size_t>(1, 2 * _capacity);
+        if constexpr (IsTriviallyRelocatable_V<T>) {
+            if (isMappedCapacity(_capacity)) {
+                T value(std::forward<Args>(args)...);
+                reallocate(newCapacity);
+                std::construct_at(_data + _size, std::move(value));
+                return _data[_size++];
+            }
+        }
+        T* newData = allocate(newCapacity);
+        try {
+            std::construct_at(newData + _size, std::forward<Args>(args)...);
+        } catch (...) {
+            deallocate(newData, newCapacity);
+            throw;
+        }
+        try {
+            relocate(_data, _size, newData);
+        } catch (...) {
+            std::destroy_at(newData + _size);
+            deallocate(newData, newCapacity);
+            throw;
+        }
+        deallocate(_data, _capacity);
+        _data = newData;
+        _capacity = newCapacity;
+        return _data[_size++];
+    }
+
+    // Expects capacity for count more elements. If constructing of new element throws, gap is closed back
+    template <typename It>
+    iterator insertIntoGap(size_t index, size_t count, It first) {
+        T* gap = _data + index;
+        size_t tailBytes = (_size - index) * sizeof(T);
+        std::memmove(static_cast<void*>(gap + count), static_cast<const void*>(gap), tailBytes);
+        try {
+            std::uninitialized_copy_n(first, count, gap);
+        } catch (...) {
+            std::memmove(static_cast<void*>(gap), static_cast<const void*>(gap + count), tailBytes);
+            throw;
+        }
+        _size += count;
+        return gap;
+    }
+
+    template <typename Construct>
+    void resizeImpl(size_t newSize, Construct&& construct) {
+        if (newSize < _size) {
+            std::destroy(begin() + newSize, end());
+            _size = newSize;
+            return;
+        }
+        grow(newSize);
+        construct(_data + _size, newSize - _size);
+        _size = newSize;
+    }
+
+    T* _data = nullptr;
+    size_t _size = 0;
+    size_t _capacity = 0;
+};
+
+// Vector owns its buffer through a pointer and has no pointers into itself
+template <typename T>
+struct IsTriviallyRelocatable<Vector<T>> : std::true_type {};
+} // namespace cefal
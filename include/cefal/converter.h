@@ -25,9 +25,11 @@
 
 #pragma once
 
+#include "cefal/detail/destination_sink.h"
 #include "cefal/detail/instantiator.h"
 
 #include "cefal/common.h"
+#include "cefal/foldable.h"
 
 #include <concepts>
 #include <functional>
@@ -51,33 +53,74 @@ concept CanConvert = requires(T x) {
 
 namespace ops {
 namespace detail {
-template <template <typename...> typename U>
+template <typename Src, typename Dest, typename Execution, typename T>
+Dest convertWith(T&& left) {
+    if constexpr (requires { instances::Converter<Src, Dest>::convert(std::forward<T>(left), Execution()); })
+        return instances::Converter<Src, Dest>::convert(std::forward<T>(left), Execution());
+    else
+        return instances::Converter<Src, Dest>::convert(std::forward<T>(left));
+}
+
+template <template <typename...> typename U, typename Execution = Sequential>
 struct as_templated {
     template <typename T, typename CleanT = std::remove_cvref_t<T>,
               typename FullU = WithInnerType_T<cefal::detail::Instantiator_T<U>, NakedInnerType_T<CleanT>>>
     requires concepts::CanConvert<CleanT, FullU> auto operator()(T&& left) const {
-        return instances::Converter<CleanT, FullU>::convert(std::forward<T>(left));
+        return convertWith<CleanT, FullU, Execution>(std::forward<T>(left));
     }
 };
-template <typename U>
+template <typename U, typename Execution = Sequential>
 struct as_full {
     template <typename T, typename CleanT = std::remove_cvref_t<T>, typename CleanU = std::remove_cvref_t<U>>
     requires concepts::CanConvert<CleanT, CleanU> auto operator()(T&& left) const {
         static_assert(std::is_same_v<NakedInnerType_T<CleanU>, NakedInnerType_T<CleanT>>,
                       "cefal::ops::as can be called only for destination with same inner type as source");
-        return instances::Converter<CleanT, CleanU>::convert(std::forward<T>(left));
+        return convertWith<CleanT, CleanU, Execution>(std::forward<T>(left));
     }
 };
+
+template <typename Dest>
+struct into {
+    template <typename T, typename CleanT = std::remove_cvref_t<T>>
+    requires concepts::Foldable<CleanT> Dest& operator()(T&& src) const {
+        static_assert(std::is_same_v<NakedInnerType_T<Dest>, NakedInnerType_T<CleanT>>,
+                      "cefal::ops::into can be called only for destination with same inner type as source");
+        cefal::detail::DestinationSink<Dest> sink(dest);
+        ops::foldLeft(true, [&sink]<typename U>(bool, U&& x) {
+            sink.add(std::forward<U>(x));
+            return true;
+        })(std::forward<T>(src));
+        return sink.finish();
+    }
+
+    Dest& dest;
+};
 } // namespace detail
 
+// With cefal::par associative destinations are built from vector-like sources in bulk
 template <template <typename...> typename U>
 inline auto as() {
     return detail::as_templated<U>();
 }
+template <template <typename...> typename U, typename Execution>
+inline auto as(Execution) {
+    return detail::as_templated<U, Execution>();
+}
 template <typename U>
 inline auto as() {
     return detail::as_full<U>();
 }
+template <typename U, typename Execution>
+inline auto as(Execution) {
+    return detail::as_full<U, Execution>();
+}
 
+// Refills existing container with elements of source and returns reference to it.
+// Storage of dest (capacity, nodes) is reused, so running same pipeline over and over doesn't allocate in steady state.
+// Use it as last op of fused chain (`src | (map(f) | filter(p) | into(buffer))`) to skip intermediate container
+template <cefal::detail::StdContainer Dest>
+inline auto into(Dest& dest) {
+    return detail::into<Dest>{dest};
+}
 } // namespace ops
 } // namespace cefal
@@ -0,0 +1,78 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include "cefal/common.h"
+#include "cefal/monoid.h"
+
+#include <algorithm>
+#include <cstddef>
+
+namespace cefal::detail {
+// Independent accumulators, enough to fill a cache line. Inner loop over them has no loop carried dependency,
+// so compiler is free to keep them in SIMD registers even for floating point types.
+template <typename T>
+inline constexpr size_t arithmeticFoldLanes = std::max<size_t>(8, 64 / sizeof(T));
+
+// Elements folded by the same set of accumulators before results are combined pairwise.
+// It keeps floating point error growing with log(n) instead of n.
+inline constexpr size_t arithmeticFoldBlockSize = 1024;
+
+template <ArithmeticMonoid M, typename T, typename Mapper>
+M arithmeticFoldBlock(T* data, size_t size, Mapper& mapper) {
+    using Value = decltype(M().value);
+    constexpr size_t lanes = arithmeticFoldLanes<Value>;
+    const Value identity = instances::Monoid<M>::empty().value;
+    Value acc[lanes];
+    for (size_t j = 0; j < lanes; ++j)
+        acc[j] = identity;
+
+    size_t i = 0;
+    for (; i + lanes <= size; i += lanes) {
+        for (size_t j = 0; j < lanes; ++j)
+            acc[j] = instances::Monoid<M>::append(M(acc[j]), mapper(data[i + j])).value;
+    }
+    for (size_t width = lanes / 2; width > 0; width /= 2) {
+        for (size_t j = 0; j < width; ++j)
+            acc[j] = instances::Monoid<M>::append(M(acc[j]), M(acc[j + width])).value;
+    }
+
+    M result = acc[0];
+    for (; i < size; ++i)
+        result = instances::Monoid<M>::append(std::move(result), mapper(data[i]));
+    return result;
+}
+
+// Folds contiguous storage of size elements, mapper converts each of them to M
+template <ArithmeticMonoid M, typename T, typename Mapper>
+M arithmeticFold(T* data, size_t size, Mapper& mapper) {
+    if (size <= arithmeticFoldBlockSize)
+        return arithmeticFoldBlock<M>(data, size, mapper);
+    const size_t half = std::max(size / 2 / arithmeticFoldBlockSize * arithmeticFoldBlockSize, arithmeticFoldBlockSize);
+    return instances::Monoid<M>::append(arithmeticFold<M>(data, half, mapper),
+                                        arithmeticFold<M>(data + half, size - half, mapper));
+}
+} // namespace cefal::detail
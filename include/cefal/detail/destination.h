@@ -0,0 +1,135 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#pragma once
+
+#include "cefal/helpers/arena.h"
+
+#include "cefal/monoid.h"
+
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+
+namespace cefal::detail {
+template <typename C>
+concept AllocatorAwareContainer = requires {
+    typename C::allocator_type;
+};
+
+template <typename To, typename From>
+To convertedOrDefault(const From& x) {
+    if constexpr (std::is_constructible_v<To, const From&>)
+        return To(x);
+    else
+        return To();
+}
+
+// Allocator of source is rebound to element type of destination, so it is carried over even if destination
+// has different inner type. Unrelated allocators are default constructed
+template <AllocatorAwareContainer Dest, typename Src>
+typename Dest::allocator_type sourceAllocator(const Src& src) {
+    using Allocator = typename Dest::allocator_type;
+    if constexpr (requires { src.get_allocator(); }) {
+        using SrcAllocator = std::remove_cvref_t<decltype(src.get_allocator())>;
+        using Rebound = typename std::allocator_traits<SrcAllocator>::template rebind_alloc<typename Dest::value_type>;
+        if constexpr (std::is_same_v<Rebound, Allocator>)
+            return Rebound(src.get_allocator());
+        else
+            return Allocator();
+    } else {
+        return Allocator();
+    }
+}
+
+// Comparator and hasher of source are carried over if destination ones can be constructed from them
+// (i.e. the same functor type), defaults are used otherwise
+template <AllocatorAwareContainer Dest, typename Src>
+Dest createWithAllocator(const Src& src, const typename Dest::allocator_type& allocator) {
+    if constexpr (requires { typename Dest::hasher; typename Dest::key_equal; }) {
+        using Hash = typename Dest::hasher;
+        using KeyEqual = typename Dest::key_equal;
+        Hash hash = [&src] {
+            if constexpr (requires { src.hash_function(); })
+                return convertedOrDefault<Hash>(src.hash_function());
+            else
+                return Hash();
+        }();
+        KeyEqual keyEqual = [&src] {
+            if constexpr (requires { src.key_eq(); })
+                return convertedOrDefault<KeyEqual>(src.key_eq());
+            else
+                return KeyEqual();
+        }();
+        return Dest(0, hash, keyEqual, allocator);
+    } else if constexpr (requires { typename Dest::key_compare; }) {
+        using Compare = typename Dest::key_compare;
+        Compare compare = [&src] {
+            if constexpr (requires { src.key_comp(); })
+                return convertedOrDefault<Compare>(src.key_comp());
+            else
+                return Compare();
+        }();
+        return Dest(compare, allocator);
+    } else {
+        return Dest(allocator);
+    }
+}
+
+// Destination of operation over src (i.e. result of map or filter) gets allocator, comparator and hasher of source,
+// so stateful ones (pool allocators, seeded hashers) are not lost. Allocator of current ArenaScope takes precedence.
+// Containers without allocator are created with ops::empty()
+template <typename Dest, typename Src>
+Dest createDestination(const Src& src) {
+    if constexpr (AllocatorAwareContainer<Dest>) {
+        if constexpr (ArenaAllocatable<Dest>) {
+            if (auto resource = currentArenaResource())
+                return createWithAllocator<Dest>(src, typename Dest::allocator_type(resource));
+        }
+        return createWithAllocator<Dest>(src, sourceAllocator<Dest>(src));
+    } else {
+        return ops::empty<Dest>();
+    }
+}
+
+// Destination for nodes extracted from src. Nodes can be relinked only between containers with equal allocators,
+// so it keeps allocator of source even inside of ArenaScope
+template <AllocatorAwareContainer Dest>
+Dest createNodeDestination(const Dest& src) {
+    return createWithAllocator<Dest>(src, src.get_allocator());
+}
+
+// Same as createDestination(), but for destinations filled by worker threads of parallel operations.
+// Memory resources (i.e. ArenaScope) are usually not thread safe, so containers with memory resource based
+// allocator use default resource instead. Other allocators of source are carried over and should be thread safe
+template <typename Dest, typename Src>
+Dest createParallelDestination(const Src& src) {
+    if constexpr (ArenaAllocatable<Dest>)
+        return createWithAllocator<Dest>(src, typename Dest::allocator_type(std::pmr::get_default_resource()));
+    else if constexpr (AllocatorAwareContainer<Dest>)
+        return createWithAllocator<Dest>(src, sourceAllocator<Dest>(src));
+    else
+        return ops::empty<Dest>();
+}
+} // namespace cefal::detail
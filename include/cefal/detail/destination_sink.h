@@ -0,0 +1,128 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include "cefal/detail/std_concepts.h"
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cefal::detail {
+// Refills existing container from scratch, reusing its storage instead of allocating new one
+template <typename Dest>
+class DestinationSink;
+
+// Elements are assigned in place, so capacity, deque blocks, list nodes and storage owned by elements themselves
+// are all reused. Elements that are not overwritten are erased in the end
+template <VectorLikeContainer Dest>
+class DestinationSink<Dest> {
+public:
+    explicit DestinationSink(Dest& dest) : _dest(dest), _next(dest.begin()) {}
+    DestinationSink(const DestinationSink&) = delete;
+    DestinationSink& operator=(const DestinationSink&) = delete;
+
+    template <typename T>
+    void add(T&& x) {
+        if (_next != _dest.end()) {
+            *_next = std::forward<T>(x);
+            ++_next;
+        } else {
+            _dest.push_back(std::forward<T>(x));
+            _next = _dest.end();
+        }
+    }
+
+    Dest& finish() {
+        _dest.erase(_next, _dest.end());
+        return _dest;
+    }
+
+private:
+    Dest& _dest;
+    typename Dest::iterator _next;
+};
+
+// Nodes are extracted and then reused for new values. They are kept in thread local storage, so its capacity is reused
+// too and steady state doesn't allocate at all. Each sink owns nodes above its base, nested sinks of same type stack up.
+template <typename Dest>
+requires StdContainer<Dest> && (!VectorLikeContainer<Dest>) && requires { typename Dest::node_type; }
+class DestinationSink<Dest> {
+    using Node = typename Dest::node_type;
+
+public:
+    explicit DestinationSink(Dest& dest) : _dest(dest), _base(spareNodes().size()) {
+        auto& nodes = spareNodes();
+        while (!_dest.empty())
+            nodes.push_back(_dest.extract(_dest.begin()));
+    }
+    DestinationSink(const DestinationSink&) = delete;
+    DestinationSink& operator=(const DestinationSink&) = delete;
+    ~DestinationSink() {
+        auto& nodes = spareNodes();
+        nodes.erase(nodes.begin() + _base, nodes.end());
+    }
+
+    template <typename T>
+    void add(T&& x) {
+        auto& nodes = spareNodes();
+        if (nodes.size() == _base) {
+            if constexpr (DoubleSocketedStdContainer<Dest>)
+                _dest.emplace(std::get<0>(std::forward<T>(x)), std::get<1>(std::forward<T>(x)));
+            else
+                _dest.insert(std::forward<T>(x));
+            return;
+        }
+        Node node = std::move(nodes.back());
+        nodes.pop_back();
+        if constexpr (DoubleSocketedStdContainer<Dest>) {
+            node.key() = std::get<0>(std::forward<T>(x));
+            node.mapped() = std::get<1>(std::forward<T>(x));
+        } else {
+            node.value() = std::forward<T>(x);
+        }
+        auto result = _dest.insert(std::move(node));
+        // Unique containers give node back if key is already there
+        if constexpr (requires { result.node; }) {
+            if (result.node)
+                nodes.push_back(std::move(result.node));
+        }
+    }
+
+    // Unused nodes are released when sink is destroyed
+    Dest& finish() { return _dest; }
+
+private:
+    static std::vector<Node>& spareNodes() {
+        thread_local std::vector<Node> nodes;
+        return nodes;
+    }
+
+    Dest& _dest;
+    size_t _base;
+};
+} // namespace cefal::detail
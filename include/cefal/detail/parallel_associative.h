@@ -0,0 +1,147 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include "cefal/detail/std_concepts.h"
+#include "cefal/detail/thread_pool.h"
+
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cefal::detail {
+template <typename Dest, typename T>
+decltype(auto) associativeKey(const T& x) {
+    if constexpr (DoubleSocketedStdContainer<Dest>)
+        return std::get<0>(x);
+    else
+        return x;
+}
+
+template <typename Dest, typename T>
+void emplaceIntoAssociative(Dest& dest, T&& x) {
+    if constexpr (DoubleSocketedStdContainer<Dest>)
+        dest.emplace(std::get<0>(std::forward<T>(x)), std::get<1>(std::forward<T>(x)));
+    else
+        dest.emplace(std::forward<T>(x));
+}
+
+template <typename Dest, typename T>
+void emplaceIntoAssociativeEnd(Dest& dest, T&& x) {
+    if constexpr (DoubleSocketedStdContainer<Dest>)
+        dest.emplace_hint(dest.end(), std::get<0>(std::forward<T>(x)), std::get<1>(std::forward<T>(x)));
+    else
+        dest.emplace_hint(dest.end(), std::forward<T>(x));
+}
+
+// Chunks are sorted in parallel and then merged pairwise, both steps are stable
+template <typename Buffer, typename Less>
+void parallelStableSort(Buffer& buffer, size_t chunksCount, const Less& less) {
+    const size_t size = buffer.size();
+    parallelForChunks(size, chunksCount, [&buffer, &less](size_t, size_t begin, size_t end) {
+        std::stable_sort(buffer.begin() + begin, buffer.begin() + end, less);
+    });
+    auto chunkBegin = [&buffer, size, chunksCount](size_t chunk) { return buffer.begin() + size * chunk / chunksCount; };
+    parallelTreeCombine(chunksCount, [&chunkBegin, &less](size_t first, size_t middle, size_t last) {
+        std::inplace_merge(chunkBegin(first), chunkBegin(middle), chunkBegin(last), less);
+    });
+}
+
+// Fills empty dest (which brings comparator or hasher and allocator) from random access buffer of its values,
+// buffer is consumed.
+// Sorted values are inserted with end hint, which is amortized constant instead of logarithmic.
+// Sorting is stable, so for duplicate keys the same value wins as with sequential insertion.
+template <OrderedAssociativeContainer Dest, typename Buffer>
+Dest buildAssociative(Dest dest, Buffer&& buffer, size_t chunksCount) {
+    auto comp = dest.key_comp();
+    parallelStableSort(buffer, chunksCount, [&comp](const auto& left, const auto& right) {
+        return comp(associativeKey<Dest>(left), associativeKey<Dest>(right));
+    });
+    for (auto&& x : buffer)
+        emplaceIntoAssociativeEnd(dest, std::move(x));
+    return dest;
+}
+
+// Fills empty dest (which brings comparator or hasher and allocator) from random access buffer of its values,
+// buffer is consumed.
+// Values are partitioned by hash (so equal keys always end up in the same partition, preserving their relative order),
+// each partition is built into a separate table in parallel and then nodes are spliced into destination on calling thread.
+template <UnorderedAssociativeContainer Dest, typename Buffer>
+Dest buildAssociative(Dest dest, Buffer&& buffer, size_t chunksCount) {
+    const size_t size = buffer.size();
+    const size_t partitionsCount = chunksCount;
+    auto hash = dest.hash_function();
+
+    // counts[chunk * partitionsCount + partition] is amount of chunk's elements in partition,
+    // offsets with same index is where they start when elements are ordered by partition and then by chunk
+    std::vector<size_t> partitions(size);
+    std::vector<size_t> counts(chunksCount * partitionsCount, 0);
+    parallelForChunks(size, chunksCount, [&](size_t chunk, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            partitions[i] = hash(associativeKey<Dest>(buffer[i])) % partitionsCount;
+            ++counts[chunk * partitionsCount + partitions[i]];
+        }
+    });
+    std::vector<size_t> offsets(counts.size(), 0);
+    for (size_t partition = 0, position = 0; partition < partitionsCount; ++partition) {
+        for (size_t chunk = 0; chunk < chunksCount; ++chunk) {
+            offsets[chunk * partitionsCount + partition] = position;
+            position += counts[chunk * partitionsCount + partition];
+        }
+    }
+    std::vector<size_t> partitionBounds(partitionsCount + 1, size);
+    for (size_t partition = 0; partition < partitionsCount; ++partition)
+        partitionBounds[partition] = offsets[partition];
+
+    std::vector<size_t> order(size);
+    parallelForChunks(size, chunksCount, [&](size_t chunk, size_t begin, size_t end) {
+        size_t* chunkOffsets = offsets.data() + chunk * partitionsCount;
+        for (size_t i = begin; i < end; ++i)
+            order[chunkOffsets[partitions[i]]++] = i;
+    });
+
+    // Tables share hasher, equality and allocator of destination, so their nodes can be spliced into it
+    std::vector<Dest> tables;
+    tables.reserve(partitionsCount);
+    for (size_t partition = 0; partition < partitionsCount; ++partition)
+        tables.emplace_back(0, dest.hash_function(), dest.key_eq(), dest.get_allocator());
+    ThreadPool::instance().run(partitionsCount, [&](size_t partition) {
+        Dest& table = tables[partition];
+        table.reserve(partitionBounds[partition + 1] - partitionBounds[partition]);
+        for (size_t i = partitionBounds[partition]; i < partitionBounds[partition + 1]; ++i)
+            emplaceIntoAssociative(table, std::move(buffer[order[i]]));
+    });
+
+    // Splicing is serial, but it only relinks nodes into preallocated buckets, no elements are copied or allocated
+    dest.reserve(size);
+    for (auto&& table : tables)
+        dest.merge(table);
+    return dest;
+}
+} // namespace cefal::detail
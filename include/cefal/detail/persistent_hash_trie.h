@@ -0,0 +1,506 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace cefal::detail {
+inline constexpr size_t persistentHashTrieBits = 5;
+inline constexpr size_t persistentHashTrieBranching = size_t(1) << persistentHashTrieBits;
+
+// Hash array mapped trie with CHAMP layout: each node has a bitmap of slots holding entries inline and a bitmap of
+// slots holding subnodes, both arrays are compacted. Slot on each level is taken from next 5 bits of hash, entries with
+// equal hashes end up in collision node below the last level. Subnode left with single entry after erase is inlined
+// into its parent, so the same entries always give the same shape.
+// Nodes are reference counted and shared between copies of trie. Changes copy only nodes on the path from root,
+// nodes owned by single trie are changed in place.
+template <typename Key, typename Entry, typename KeyOf, typename Hash, typename KeyEqual>
+class PersistentHashTrie {
+    static constexpr size_t bits = persistentHashTrieBits;
+    static constexpr size_t branching = persistentHashTrieBranching;
+    static constexpr size_t hashBits = std::numeric_limits<size_t>::digits;
+    // Levels indexed by hash and collision level below them
+    static constexpr size_t maxDepth = (hashBits + bits - 1) / bits + 1;
+
+    struct Node;
+    class NodePtr {
+    public:
+        NodePtr() = default;
+        explicit NodePtr(Node* node) : _node(node) {}
+        NodePtr(const NodePtr& other) : _node(other._node) {
+            if (_node)
+                _node->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+        NodePtr(NodePtr&& other) noexcept : _node(std::exchange(other._node, nullptr)) {}
+        NodePtr& operator=(NodePtr other) noexcept {
+            std::swap(_node, other._node);
+            return *this;
+        }
+        ~NodePtr() { release(_node); }
+
+        Node* get() const { return _node; }
+        Node* operator->() const { return _node; }
+        explicit operator bool() const { return _node; }
+
+    private:
+        Node* _node = nullptr;
+    };
+
+    static constexpr size_t alignUp(size_t size, size_t alignment) { return (size + alignment - 1) / alignment * alignment; }
+
+    // Children and entries are stored right after node in the same allocation. Counters hold number of constructed ones,
+    // collision nodes have empty bitmaps and any number of entries.
+    struct Node {
+        std::atomic<size_t> refs = 1;
+        uint32_t dataMap = 0;
+        uint32_t nodeMap = 0;
+        uint32_t dataCount = 0;
+        uint32_t childCount = 0;
+
+        NodePtr* children() { return std::launder(reinterpret_cast<NodePtr*>(bytes() + childrenOffset)); }
+        const NodePtr* children() const { return const_cast<Node*>(this)->children(); }
+        Entry* entries() { return std::launder(reinterpret_cast<Entry*>(bytes() + entriesOffset(std::popcount(nodeMap)))); }
+        const Entry* entries() const { return const_cast<Node*>(this)->entries(); }
+
+    private:
+        std::byte* bytes() { return reinterpret_cast<std::byte*>(this); }
+    };
+
+    static constexpr size_t alignment = std::max({alignof(Node), alignof(NodePtr), alignof(Entry)});
+    static constexpr size_t childrenOffset = alignUp(sizeof(Node), alignof(NodePtr));
+    static constexpr size_t entriesOffset(size_t childrenCount) {
+        return alignUp(childrenOffset + childrenCount * sizeof(NodePtr), alignof(Entry));
+    }
+
+public:
+    using value_type = Entry;
+    using difference_type = std::ptrdiff_t;
+
+    // Entries of each node are walked first and then its children, depth first
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using iterator_concept = std::forward_iterator_tag;
+        using value_type = Entry;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Entry*;
+        using reference = const Entry&;
+
+        const_iterator() = default;
+
+        reference operator*() const { return *_entry; }
+        pointer operator->() const { return _entry; }
+
+        const_iterator& operator++() {
+            if (++_entry == _entriesEnd)
+                advance();
+            return *this;
+        }
+        const_iterator operator++(int) {
+            auto result = *this;
+            ++*this;
+            return result;
+        }
+        friend bool operator==(const const_iterator& left, const const_iterator& right) { return left._entry == right._entry; }
+
+    private:
+        friend class PersistentHashTrie;
+        struct Frame {
+            const Node* node;
+            uint32_t nextChild;
+        };
+
+        void push(const Node* node) { _stack[_depth++] = {node, 0}; }
+
+        // Moves to the first entry of next node that has any
+        void advance() {
+            while (_depth) {
+                Frame& frame = _stack[_depth - 1];
+                if (frame.nextChild == frame.node->childCount) {
+                    --_depth;
+                    continue;
+                }
+                const Node* child = frame.node->children()[frame.nextChild++].get();
+                push(child);
+                if (child->dataCount) {
+                    _entry = child->entries();
+                    _entriesEnd = _entry + child->dataCount;
+                    return;
+                }
+            }
+            _entry = nullptr;
+            _entriesEnd = nullptr;
+        }
+
+        Frame _stack[maxDepth] = {};
+        size_t _depth = 0;
+        const Entry* _entry = nullptr;
+        const Entry* _entriesEnd = nullptr;
+    };
+
+    PersistentHashTrie() = default;
+    PersistentHashTrie(const PersistentHashTrie&) = default;
+    PersistentHashTrie(PersistentHashTrie&& other) noexcept
+        : _root(std::move(other._root)), _size(std::exchange(other._size, 0)), _hash(other._hash), _equal(other._equal) {}
+    PersistentHashTrie& operator=(const PersistentHashTrie&) = default;
+    PersistentHashTrie& operator=(PersistentHashTrie&& other) noexcept {
+        if (this != &other) {
+            _root = std::move(other._root);
+            _size = std::exchange(other._size, 0);
+            _hash = other._hash;
+            _equal = other._equal;
+        }
+        return *this;
+    }
+
+    size_t size() const { return _size; }
+    bool empty() const { return !_size; }
+
+    const Hash& hashFunction() const { return _hash; }
+    const KeyEqual& keyEqual() const { return _equal; }
+
+    const_iterator begin() const {
+        const_iterator result;
+        if (!_root)
+            return result;
+        result.push(_root.get());
+        if (_root->dataCount) {
+            result._entry = _root->entries();
+            result._entriesEnd = result._entry + _root->dataCount;
+        } else {
+            result.advance();
+        }
+        return result;
+    }
+    const_iterator end() const { return const_iterator(); }
+
+    const Entry* lookup(const Key& key) const {
+        return locate(key, [](const Node*, uint32_t) {});
+    }
+
+    const_iterator find(const Key& key) const {
+        const_iterator result;
+        const Entry* entry = locate(key, [&result](const Node* node, uint32_t childIndex) {
+            if (result._depth)
+                result._stack[result._depth - 1].nextChild = childIndex;
+            result.push(node);
+        });
+        if (!entry)
+            return const_iterator();
+        const Node* node = result._stack[result._depth - 1].node;
+        result._entry = entry;
+        result._entriesEnd = node->entries() + node->dataCount;
+        return result;
+    }
+
+    // Returns true if entry was added, existing one with the same key is either kept or replaced
+    template <typename E>
+    bool insert(E&& entry, bool replace) {
+        const Key& key = KeyOf()(entry);
+        if (!replace && lookup(key))
+            return false;
+        const size_t hash = _hash(key);
+        if (!_root)
+            _root = allocate(0, 0, 0);
+        const bool added = insertInto(_root, hash, 0, std::forward<E>(entry), replace);
+        _size += added;
+        return added;
+    }
+
+    size_t erase(const Key& key) {
+        if (!lookup(key))
+            return 0;
+        eraseFrom(_root, _hash(key), 0, key);
+        if (!_root->dataCount && !_root->childCount)
+            _root = NodePtr();
+        --_size;
+        return 1;
+    }
+
+    // Func gets entries of each node and returns true to stop. Entries are writable if node is reachable only
+    // through this trie, so they can be moved from by rvalue folds.
+    template <typename Func>
+    bool forEachNode(Func& func) const {
+        return _root && forEachNode(_root.get(), true, func);
+    }
+
+    friend bool operator==(const PersistentHashTrie& left, const PersistentHashTrie& right) {
+        if (left._size != right._size)
+            return false;
+        if (left._root.get() == right._root.get())
+            return true;
+        for (const Entry& x : left) {
+            const Entry* other = right.lookup(KeyOf()(x));
+            if (!other || !(*other == x))
+                return false;
+        }
+        return true;
+    }
+
+private:
+    static void release(Node* node) {
+        if (!node || node->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+        std::destroy_n(node->entries(), node->dataCount);
+        std::destroy_n(node->children(), node->childCount);
+        node->~Node();
+        ::operator delete(node, std::align_val_t(alignment));
+    }
+
+    static NodePtr allocate(uint32_t dataMap, uint32_t nodeMap, size_t entriesCapacity) {
+        const size_t size = entriesOffset(std::popcount(nodeMap)) + entriesCapacity * sizeof(Entry);
+        Node* node = new (::operator new(size, std::align_val_t(alignment))) Node;
+        node->dataMap = dataMap;
+        node->nodeMap = nodeMap;
+        return NodePtr(node);
+    }
+
+    template <typename E>
+    static void addEntry(Node* node, E&& entry) {
+        new (node->entries() + node->dataCount) Entry(std::forward<E>(entry));
+        ++node->dataCount;
+    }
+    static void addChild(Node* node, NodePtr child) {
+        new (node->children() + node->childCount) NodePtr(std::move(child));
+        ++node->childCount;
+    }
+
+    static bool isUnique(const NodePtr& node) { return node->refs.load(std::memory_order_acquire) == 1; }
+    static uint32_t slotBit(size_t hash, size_t shift) { return uint32_t(1) << ((hash >> shift) & (branching - 1)); }
+    static uint32_t slotIndex(uint32_t map, uint32_t bit) { return std::popcount(map & (bit - 1)); }
+
+    static void makeUnique(NodePtr& node) {
+        if (isUnique(node))
+            return;
+        const Node* src = node.get();
+        NodePtr copy = allocate(src->dataMap, src->nodeMap, src->dataCount);
+        for (uint32_t i = 0; i < src->dataCount; ++i)
+            addEntry(copy.get(), src->entries()[i]);
+        for (uint32_t i = 0; i < src->childCount; ++i)
+            addChild(copy.get(), src->children()[i]);
+        node = std::move(copy);
+    }
+
+    // Builds node with the same slots as given one except for slot of bit, which holds given entry, given child
+    // or nothing. Entries and children are moved from node owned only by this trie and copied from shared one.
+    static NodePtr reshape(const NodePtr& node, uint32_t bit, Entry* entry, NodePtr child) {
+        Node* src = node.get();
+        const bool unique = isUnique(node);
+        const uint32_t dataMap = (src->dataMap & ~bit) | (entry ? bit : 0);
+        const uint32_t nodeMap = (src->nodeMap & ~bit) | (child ? bit : 0);
+        NodePtr result = allocate(dataMap, nodeMap, std::popcount(dataMap));
+        for (uint32_t remaining = dataMap; remaining; remaining &= remaining - 1) {
+            const uint32_t current = remaining & (~remaining + 1);
+            if (current == bit) {
+                addEntry(result.get(), std::move(*entry));
+                continue;
+            }
+            Entry& x = src->entries()[slotIndex(src->dataMap, current)];
+            if (unique)
+                addEntry(result.get(), std::move(x));
+            else
+                addEntry(result.get(), std::as_const(x));
+        }
+        for (uint32_t remaining = nodeMap; remaining; remaining &= remaining - 1) {
+            const uint32_t current = remaining & (~remaining + 1);
+            if (current == bit) {
+                addChild(result.get(), std::move(child));
+                continue;
+            }
+            NodePtr& x = src->children()[slotIndex(src->nodeMap, current)];
+            if (unique)
+                addChild(result.get(), std::move(x));
+            else
+                addChild(result.get(), x);
+        }
+        return result;
+    }
+
+    // Node holding two entries with different keys at given level
+    static NodePtr pairNode(Entry&& first, size_t firstHash, Entry&& second, size_t secondHash, size_t shift) {
+        if (shift >= hashBits) {
+            NodePtr result = allocate(0, 0, 2);
+            addEntry(result.get(), std::move(first));
+            addEntry(result.get(), std::move(second));
+            return result;
+        }
+        const uint32_t firstBit = slotBit(firstHash, shift);
+        const uint32_t secondBit = slotBit(secondHash, shift);
+        if (firstBit == secondBit) {
+            NodePtr result = allocate(0, firstBit, 0);
+            addChild(result.get(), pairNode(std::move(first), firstHash, std::move(second), secondHash, shift + bits));
+            return result;
+        }
+        NodePtr result = allocate(firstBit | secondBit, 0, 2);
+        if (firstBit > secondBit)
+            std::swap(first, second);
+        addEntry(result.get(), std::move(first));
+        addEntry(result.get(), std::move(second));
+        return result;
+    }
+
+    template <typename Visit>
+    const Entry* locate(const Key& key, Visit&& visit) const {
+        if (!_root)
+            return nullptr;
+        const size_t hash = _hash(key);
+        const Node* node = _root.get();
+        visit(node, 0);
+        for (size_t shift = 0; shift < hashBits; shift += bits) {
+            const uint32_t bit = slotBit(hash, shift);
+            if (node->dataMap & bit) {
+                const Entry* entry = node->entries() + slotIndex(node->dataMap, bit);
+                return _equal(KeyOf()(*entry), key) ? entry : nullptr;
+            }
+            if (!(node->nodeMap & bit))
+                return nullptr;
+            const uint32_t index = slotIndex(node->nodeMap, bit);
+            node = node->children()[index].get();
+            visit(node, index + 1);
+        }
+        for (const Entry* entry = node->entries(); entry != node->entries() + node->dataCount; ++entry) {
+            if (_equal(KeyOf()(*entry), key))
+                return entry;
+        }
+        return nullptr;
+    }
+
+    template <typename E>
+    bool insertInto(NodePtr& node, size_t hash, size_t shift, E&& entry, bool replace) {
+        if (shift >= hashBits)
+            return insertIntoCollision(node, std::forward<E>(entry), replace);
+
+        const uint32_t bit = slotBit(hash, shift);
+        if (node->dataMap & bit) {
+            const uint32_t index = slotIndex(node->dataMap, bit);
+            Entry& existing = node->entries()[index];
+            if (_equal(KeyOf()(existing), KeyOf()(entry))) {
+                if (replace) {
+                    makeUnique(node);
+                    node->entries()[index] = std::forward<E>(entry);
+                }
+                return false;
+            }
+            const size_t existingHash = _hash(KeyOf()(existing));
+            Entry pushedDown = isUnique(node) ? Entry(std::move(existing)) : Entry(std::as_const(existing));
+            NodePtr child = pairNode(std::move(pushedDown), existingHash, Entry(std::forward<E>(entry)), hash, shift + bits);
+            node = reshape(node, bit, nullptr, std::move(child));
+            return true;
+        }
+        if (node->nodeMap & bit) {
+            makeUnique(node);
+            NodePtr& child = node->children()[slotIndex(node->nodeMap, bit)];
+            return insertInto(child, hash, shift + bits, std::forward<E>(entry), replace);
+        }
+        Entry added(std::forward<E>(entry));
+        node = reshape(node, bit, &added, NodePtr());
+        return true;
+    }
+
+    template <typename E>
+    bool insertIntoCollision(NodePtr& node, E&& entry, bool replace) {
+        for (uint32_t i = 0; i < node->dataCount; ++i) {
+            if (!_equal(KeyOf()(node->entries()[i]), KeyOf()(entry)))
+                continue;
+            if (replace) {
+                makeUnique(node);
+                node->entries()[i] = std::forward<E>(entry);
+            }
+            return false;
+        }
+        const bool unique = isUnique(node);
+        NodePtr result = allocate(0, 0, node->dataCount + 1);
+        for (uint32_t i = 0; i < node->dataCount; ++i) {
+            if (unique)
+                addEntry(result.get(), std::move(node->entries()[i]));
+            else
+                addEntry(result.get(), std::as_const(node->entries()[i]));
+        }
+        addEntry(result.get(), std::forward<E>(entry));
+        node = std::move(result);
+        return true;
+    }
+
+    // Key is known to be in the subtree
+    void eraseFrom(NodePtr& node, size_t hash, size_t shift, const Key& key) {
+        if (shift >= hashBits) {
+            const bool unique = isUnique(node);
+            NodePtr result = allocate(0, 0, node->dataCount - 1);
+            for (uint32_t i = 0; i < node->dataCount; ++i) {
+                Entry& x = node->entries()[i];
+                if (_equal(KeyOf()(x), key))
+                    continue;
+                if (unique)
+                    addEntry(result.get(), std::move(x));
+                else
+                    addEntry(result.get(), std::as_const(x));
+            }
+            node = std::move(result);
+            return;
+        }
+
+        const uint32_t bit = slotBit(hash, shift);
+        if (node->dataMap & bit) {
+            node = reshape(node, bit, nullptr, NodePtr());
+            return;
+        }
+        makeUnique(node);
+        NodePtr& child = node->children()[slotIndex(node->nodeMap, bit)];
+        eraseFrom(child, hash, shift + bits, key);
+        if (child->childCount || child->dataCount != 1)
+            return;
+        Entry inlined = isUnique(child) ? Entry(std::move(child->entries()[0])) : Entry(std::as_const(child->entries()[0]));
+        node = reshape(node, bit, &inlined, NodePtr());
+    }
+
+    template <typename Func>
+    static bool forEachNode(Node* node, bool unique, Func& func) {
+        unique = unique && node->refs.load(std::memory_order_acquire) == 1;
+        if (node->dataCount && func(node->entries(), size_t(node->dataCount), unique))
+            return true;
+        for (uint32_t i = 0; i < node->childCount; ++i) {
+            if (forEachNode(node->children()[i].get(), unique, func))
+                return true;
+        }
+        return false;
+    }
+
+    NodePtr _root;
+    size_t _size = 0;
+    [[no_unique_address]] Hash _hash;
+    [[no_unique_address]] KeyEqual _equal;
+};
+} // namespace cefal::detail
@@ -0,0 +1,187 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace cefal::detail {
+// Bounded lock-free ring for exactly one producer thread and one consumer thread
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity && !(Capacity & (Capacity - 1)), "Capacity should be a power of two");
+
+public:
+    bool tryPush(T& x) {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head.load(std::memory_order_acquire) == Capacity)
+            return false;
+        std::swap(_slots[tail & (Capacity - 1)], x);
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& x) {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire))
+            return false;
+        std::swap(_slots[head & (Capacity - 1)], x);
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    static constexpr size_t cacheLineSize = 64;
+    std::array<T, Capacity> _slots;
+    alignas(cacheLineSize) std::atomic_size_t _head{0};
+    alignas(cacheLineSize) std::atomic_size_t _tail{0};
+};
+
+// Thrown into pipeline threads to unwind them after another thread failed
+struct PipelineCancelled {};
+
+// Shared by all threads of one pipeline run, keeps first failure of each thread
+template <size_t ThreadsCount>
+class PipelineState {
+public:
+    template <typename Func>
+    void run(size_t thread, Func&& func) noexcept {
+        try {
+            func();
+        } catch (const PipelineCancelled&) {
+        } catch (...) {
+            _errors[thread] = std::current_exception();
+            _cancelled.store(true, std::memory_order_release);
+        }
+    }
+
+    void cancel() { _cancelled.store(true, std::memory_order_release); }
+
+    bool cancelled() const { return _cancelled.load(std::memory_order_acquire); }
+
+    void rethrow() const {
+        for (auto&& error : _errors) {
+            if (error)
+                std::rethrow_exception(error);
+        }
+    }
+
+private:
+    std::array<std::exception_ptr, ThreadsCount> _errors;
+    std::atomic_bool _cancelled{false};
+};
+
+// Spins first, then yields and finally sleeps, so side that waits for a slow stage doesn't keep its core busy
+class Backoff {
+public:
+    void wait() {
+        if (_step < spinsCount) {
+            ++_step;
+        } else if (_step < spinsCount + yieldsCount) {
+            ++_step;
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    void reset() { _step = 0; }
+
+private:
+    static constexpr size_t spinsCount = 64;
+    static constexpr size_t yieldsCount = 64;
+    size_t _step = 0;
+};
+
+// Batching channel on top of SpscRing: producer fills a batch and publishes it when it is full or on close().
+// Waiting sides back off, pipelines are expected to be busy most of the time.
+template <typename T, typename State, size_t BatchSize = 256, size_t BatchesCount = 16>
+class SpscChannel {
+public:
+    explicit SpscChannel(const State& state) : _state(state) { _batch.reserve(BatchSize); }
+
+    template <typename U>
+    void push(U&& x) {
+        _batch.push_back(std::forward<U>(x));
+        if (_batch.size() == BatchSize)
+            flush();
+    }
+
+    void close() {
+        if (!_batch.empty())
+            flush();
+        _closed.store(true, std::memory_order_release);
+    }
+
+    template <typename Func>
+    void consume(Func&& func) {
+        std::vector<T> batch;
+        Backoff backoff;
+        while (true) {
+            if (_state.cancelled())
+                throw PipelineCancelled();
+            if (_ring.tryPop(batch)) {
+                for (auto&& x : batch)
+                    func(std::move(x));
+                batch.clear();
+                backoff.reset();
+            } else if (_closed.load(std::memory_order_acquire)) {
+                if (!_ring.tryPop(batch))
+                    return;
+                for (auto&& x : batch)
+                    func(std::move(x));
+                batch.clear();
+            } else {
+                backoff.wait();
+            }
+        }
+    }
+
+private:
+    void flush() {
+        Backoff backoff;
+        while (!_ring.tryPush(_batch)) {
+            if (_state.cancelled())
+                throw PipelineCancelled();
+            backoff.wait();
+        }
+        // Ring gives back previously consumed batch, so its capacity is reused
+        _batch.clear();
+        _batch.reserve(BatchSize);
+    }
+
+    const State& _state;
+    std::vector<T> _batch;
+    SpscRing<std::vector<T>, BatchesCount> _ring;
+    std::atomic_bool _closed{false};
+};
+} // namespace cefal::detail
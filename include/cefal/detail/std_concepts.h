@@ -29,8 +29,10 @@
 
 #include "cefal/common.h"
 
+#include <algorithm>
 #include <concepts>
 #include <iterator>
+#include <type_traits>
 
 namespace cefal::detail {
 // clang-format off
@@ -71,6 +73,30 @@ concept VectorLikeContainer = SingleSocketedStdContainer<C> && requires (C c, In
     *c.begin() = value;
 };
 
+template <typename C>
+concept RandomAccessContainer = VectorLikeContainer<C> && std::random_access_iterator<typename C::iterator>
+&& std::is_lvalue_reference_v<decltype(*std::declval<C&>().begin())> && std::default_initializable<InnerType_T<C>>
+&& requires(C c, size_t size) {
+    c.resize(size);
+};
+
+template <typename C>
+concept OrderedAssociativeContainer = StdContainer<C> && requires(C c) {
+    typename C::node_type;
+    typename C::key_compare;
+    c.key_comp();
+    c.emplace_hint(c.end(), *c.begin());
+};
+
+template <typename C>
+concept UnorderedAssociativeContainer = StdContainer<C> && requires(C c, C other, size_t size) {
+    typename C::node_type;
+    typename C::hasher;
+    c.hash_function();
+    c.reserve(size);
+    c.merge(other);
+};
+
 template <typename C>
 concept Reservable = SingleSocketedStdContainer<C> && requires(C c, size_t size) {
     c.reserve(size);
@@ -78,7 +104,7 @@ concept Reservable = SingleSocketedStdContainer<C> && requires(C c, size_t size)
 };
 
 template <typename Src, typename Dest>
-concept TransferableSize = StdContainer<Src> && Reservable<Dest>;
+concept TransferableSize = StdContainer<Src> && (Reservable<Dest> || UnorderedAssociativeContainer<Dest>);
 
 template <typename Src, typename Func>
 concept StdRemoveIfable = SingleSocketedStdContainer<Src> && requires(Src src, Func func, InnerType_T<Src> value) {
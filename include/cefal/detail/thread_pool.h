@@ -0,0 +1,233 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cefal::detail {
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t workersCount) {
+        for (size_t i = 0; i < workersCount; ++i)
+            _workers.emplace_back([this] { work(); });
+    }
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool() {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _stopped = true;
+        }
+        _wakeUp.notify_all();
+        for (auto&& worker : _workers)
+            worker.join();
+    }
+
+    static ThreadPool& instance() {
+        static ThreadPool pool(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+        return pool;
+    }
+
+    // Calling thread is also counted, because it takes part in run()
+    size_t concurrency() const { return _workers.size() + 1; }
+
+    // Calls func(i) for each i in [0, tasksCount) and blocks until all of them are finished.
+    // Calling thread processes tasks as well, so nested run() calls can't deadlock.
+    // First exception thrown by func is rethrown after all tasks are finished.
+    template <typename Func>
+    void run(size_t tasksCount, Func&& func) {
+        if (!tasksCount)
+            return;
+        if (tasksCount == 1 || _workers.empty()) {
+            for (size_t i = 0; i < tasksCount; ++i)
+                func(i);
+            return;
+        }
+        auto state = std::make_shared<RunState>([&func](size_t i) { func(i); }, tasksCount, tasksCount);
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            for (size_t i = 0, helpers = std::min(tasksCount - 1, _workers.size()); i < helpers; ++i)
+                _jobs.push_back(state);
+        }
+        _wakeUp.notify_all();
+        state->process();
+        state->wait();
+        if (state->error)
+            std::rethrow_exception(state->error);
+    }
+
+    // Calls func(i) for each i in [0, tasksCount) with all of them running at the same time, so tasks can wait for each other.
+    // Idle workers are taken first and threads are started only for tasks they can't cover, calling thread runs one task too.
+    // If some thread can't be started cancel() is called, already running tasks should return soon after it.
+    template <typename Func, typename Cancel>
+    void runConcurrently(size_t tasksCount, Func&& func, Cancel&& cancel) {
+        if (!tasksCount)
+            return;
+        if (tasksCount == 1) {
+            func(0);
+            return;
+        }
+        auto state = std::make_shared<RunState>([&func](size_t i) { func(i); }, tasksCount, 1);
+        // Outlives try block, so started threads are joined only after wait() and never while their tasks are blocked
+        std::vector<std::jthread> extraThreads;
+        try {
+            size_t pooled = 0;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                // Workers that are still going to pick up queued jobs are not available
+                pooled = std::min(tasksCount - 1, _idleCount > _jobs.size() ? _idleCount - _jobs.size() : 0);
+                for (size_t i = 0; i < pooled; ++i)
+                    _jobs.push_back(state);
+            }
+            _wakeUp.notify_all();
+            extraThreads.reserve(tasksCount - 1 - pooled);
+            for (size_t i = pooled + 1; i < tasksCount; ++i)
+                extraThreads.emplace_back([state] { state->process(); });
+        } catch (...) {
+            state->fail(std::current_exception());
+            cancel();
+            // Tasks nobody has claimed are run here one after another, they see cancellation and return
+            state->process(tasksCount);
+            state->wait();
+            std::rethrow_exception(state->error);
+        }
+        state->process();
+        state->wait();
+        if (state->error)
+            std::rethrow_exception(state->error);
+    }
+
+private:
+    // Workers can pick up a job after run() is already finished, they will see that there are no tasks left.
+    // That's why the state is shared and func is never called after last task is claimed.
+    struct RunState {
+        RunState(std::function<void(size_t)>&& func, size_t tasksCount, size_t tasksPerJob)
+            : func(std::move(func)), tasksCount(tasksCount), tasksPerJob(tasksPerJob) {}
+
+        void process() { process(tasksPerJob); }
+
+        void process(size_t maxTasks) {
+            size_t processed = 0;
+            for (; processed < maxTasks; ++processed) {
+                const size_t i = next++;
+                if (i >= tasksCount)
+                    break;
+                try {
+                    func(i);
+                } catch (...) {
+                    fail(std::current_exception());
+                }
+            }
+            if (!processed)
+                return;
+            std::unique_lock<std::mutex> lock(mutex);
+            finished += processed;
+            if (finished == tasksCount)
+                allFinished.notify_all();
+        }
+
+        void fail(std::exception_ptr e) {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!error)
+                error = std::move(e);
+        }
+
+        void wait() {
+            std::unique_lock<std::mutex> lock(mutex);
+            allFinished.wait(lock, [this] { return finished == tasksCount; });
+        }
+
+        std::function<void(size_t)> func;
+        const size_t tasksCount;
+        // Limits how many tasks single job can take, concurrent runs need each task on its own thread
+        const size_t tasksPerJob;
+        std::atomic_size_t next{0};
+        std::mutex mutex;
+        std::condition_variable allFinished;
+        size_t finished = 0;
+        std::exception_ptr error;
+    };
+
+    void work() {
+        while (true) {
+            std::shared_ptr<RunState> job;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                ++_idleCount;
+                _wakeUp.wait(lock, [this] { return _stopped || !_jobs.empty(); });
+                --_idleCount;
+                if (_jobs.empty())
+                    return;
+                job = std::move(_jobs.front());
+                _jobs.pop_front();
+            }
+            job->process();
+        }
+    }
+
+    std::vector<std::thread> _workers;
+    std::deque<std::shared_ptr<RunState>> _jobs;
+    std::mutex _mutex;
+    std::condition_variable _wakeUp;
+    size_t _idleCount = 0;
+    bool _stopped = false;
+};
+
+// Amount of chunks for parallel processing of size elements, 1 means that it is not worth it
+inline size_t parallelChunksCount(size_t size, size_t minChunkSize = 4096) {
+    return std::clamp(size / minChunkSize, size_t(1), ThreadPool::instance().concurrency() * 4);
+}
+
+// Splits [0, size) into chunksCount contiguous chunks and calls func(chunk, begin, end) for each of them in parallel
+template <typename Func>
+void parallelForChunks(size_t size, size_t chunksCount, Func&& func) {
+    ThreadPool::instance().run(chunksCount, [size, chunksCount, &func](size_t chunk) {
+        func(chunk, size * chunk / chunksCount, size * (chunk + 1) / chunksCount);
+    });
+}
+
+// Combines neighbouring chunks pairwise in log2(chunksCount) rounds, independent pairs of each round run in parallel.
+// func(first, middle, last) should combine already combined chunks [first, middle) and [middle, last) into first one.
+template <typename Func>
+void parallelTreeCombine(size_t chunksCount, Func&& func) {
+    for (size_t step = 1; step < chunksCount; step *= 2) {
+        const size_t pairsCount = (chunksCount - step + 2 * step - 1) / (2 * step);
+        ThreadPool::instance().run(pairsCount, [chunksCount, step, &func](size_t pair) {
+            const size_t first = pair * 2 * step;
+            func(first, first + step, std::min(first + 2 * step, chunksCount));
+        });
+    }
+}
+} // namespace cefal::detail
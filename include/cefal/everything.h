@@ -25,20 +25,31 @@
 
 #include "cefal/cefal"
 
+#include "cefal/containers/vector.h"
+
+#include "cefal/helpers/persistent_containers.h"
+#include "cefal/helpers/shared.h"
+#include "cefal/helpers/small_vector.h"
 #include "cefal/helpers/std_containers.h"
 #include "cefal/helpers/std_ranges.h"
+#include "cefal/helpers/trivially_relocatable.h"
 
 #include "cefal/instances/converter/from_self.h"
 #include "cefal/instances/converter/from_std_containers.h"
 #include "cefal/instances/converter/from_std_optional.h"
+#include "cefal/instances/converter/persistent_containers.h"
 #include "cefal/instances/filterable/from_foldable.h"
+#include "cefal/instances/filterable/shared.h"
 #include "cefal/instances/filterable/std_optional.h"
 #include "cefal/instances/filterable/std_ranges.h"
 #include "cefal/instances/filterable/with_functions.h"
+#include "cefal/instances/foldable/persistent_containers.h"
+#include "cefal/instances/foldable/shared.h"
 #include "cefal/instances/foldable/std_containers.h"
 #include "cefal/instances/foldable/std_ranges.h"
 #include "cefal/instances/foldable/with_functions.h"
 #include "cefal/instances/functor/from_foldable.h"
+#include "cefal/instances/functor/shared.h"
 #include "cefal/instances/functor/std_optional.h"
 #include "cefal/instances/functor/std_ranges.h"
 #include "cefal/instances/functor/with_functions.h"
@@ -46,6 +57,8 @@
 #include "cefal/instances/monad/std_optional.h"
 #include "cefal/instances/monad/with_functions.h"
 #include "cefal/instances/monoid/basic_types.h"
+#include "cefal/instances/monoid/persistent_containers.h"
+#include "cefal/instances/monoid/shared.h"
 #include "cefal/instances/monoid/std_containers.h"
 #include "cefal/instances/monoid/std_optional.h"
 #include "cefal/instances/monoid/with_functions.h"
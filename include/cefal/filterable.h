@@ -26,12 +26,18 @@
 #pragma once
 
 #include "cefal/common.h"
+#include "cefal/functor.h"
+#include "cefal/helpers/placeholders.h"
 
 #include <concepts>
 #include <functional>
 #include <utility>
+#include <vector>
 
 namespace cefal {
+// Indices of selected elements in ascending order, produced by ops::select() and applied by ops::gather()
+using Selection = std::vector<size_t>;
+
 namespace instances {
 template <typename T>
 struct Filterable;
@@ -61,21 +67,51 @@ requires(CleanT x, std::function<bool(InnerT)> predicate) {
 } // namespace concepts
 
 namespace ops {
-template <typename Func>
+namespace detail {
+// clang-format off
+template <typename Instance, typename F, typename Func, typename Execution>
+concept BatchFilterable = std::same_as<Execution, Sequential>
+                          && cefal::detail::BatchPredicate<Func, InnerType_T<std::remove_cvref_t<F>>>
+                          && requires(F&& left, const Func& func) {
+    Instance::filterSimd(std::forward<F>(left), func);
+};
+// clang-format on
+} // namespace detail
+
+// With cefal::par accepted elements keep their relative order too
+template <typename Func, typename Execution = Sequential>
 struct filter {
     filter(Func&& func) : func(std::move(func)) {}
     filter(const Func& func) : func(func) {}
+    filter(Func&& func, Execution) : func(std::move(func)) {}
+    filter(const Func& func, Execution) : func(func) {}
 
+    // Placeholder expressions (i.e. `_1 > 4`) are evaluated for whole batches where instance supports it
     template <concepts::Filterable F>
     auto operator()(F&& left) && {
-        return instances::Filterable<std::remove_cvref_t<F>>::filter(std::forward<F>(left), std::move(func));
+        using Instance = instances::Filterable<std::remove_cvref_t<F>>;
+        if constexpr (detail::BatchFilterable<Instance, F, Func, Execution>)
+            return Instance::filterSimd(std::forward<F>(left), std::move(func));
+        else if constexpr (requires { Instance::filter(std::forward<F>(left), std::move(func), Execution()); })
+            return Instance::filter(std::forward<F>(left), std::move(func), Execution());
+        else
+            return Instance::filter(std::forward<F>(left), std::move(func));
     }
     template <concepts::Filterable F>
     auto operator()(F&& left) const& {
-        return instances::Filterable<std::remove_cvref_t<F>>::filter(std::forward<F>(left), func);
+        using Instance = instances::Filterable<std::remove_cvref_t<F>>;
+        if constexpr (detail::BatchFilterable<Instance, F, Func, Execution>)
+            return Instance::filterSimd(std::forward<F>(left), func);
+        else if constexpr (requires { Instance::filter(std::forward<F>(left), func, Execution()); })
+            return Instance::filter(std::forward<F>(left), func, Execution());
+        else
+            return Instance::filter(std::forward<F>(left), func);
     }
 
 private:
+    template <typename>
+    friend struct detail::FusedStage;
+
     Func func;
 };
 
@@ -93,10 +129,172 @@ private:
     Func func;
 };
 
+// Maps and filters in one go: func returns std::optional (or anything else testable as bool and dereferenceable),
+// empty results are dropped and payloads of other ones are moved to destination.
+// Instances can provide single pass mapMaybe(), others get map, filter and map applied one by one
+template <typename Func>
+struct mapMaybe {
+    mapMaybe(Func&& func) : func(std::move(func)) {}
+    mapMaybe(const Func& func) : func(func) {}
+
+    template <concepts::Filterable F>
+    auto operator()(F&& left) && {
+        using Instance = instances::Filterable<std::remove_cvref_t<F>>;
+        if constexpr (requires { Instance::mapMaybe(std::forward<F>(left), std::move(func)); })
+            return Instance::mapMaybe(std::forward<F>(left), std::move(func));
+        else
+            return applySeparately(std::forward<F>(left), std::move(func));
+    }
+    template <concepts::Filterable F>
+    auto operator()(F&& left) const& {
+        using Instance = instances::Filterable<std::remove_cvref_t<F>>;
+        if constexpr (requires { Instance::mapMaybe(std::forward<F>(left), func); })
+            return Instance::mapMaybe(std::forward<F>(left), func);
+        else
+            return applySeparately(std::forward<F>(left), func);
+    }
+
+private:
+    template <typename>
+    friend struct detail::FusedStage;
+
+    template <typename F, typename G>
+    static auto applySeparately(F&& left, G&& func) {
+        return std::forward<F>(left) | map(std::forward<G>(func))
+               | filter([]<typename T>(const T& x) { return static_cast<bool>(x); })
+               | map([]<typename T>(T&& x) { return std::remove_cvref_t<decltype(*x)>(*std::forward<T>(x)); });
+    }
+
+    Func func;
+};
+
+// Splits Filterable into pair of accepted and rejected parts, each of them keeps relative order of elements.
+// Instances can provide single pass partition(), others get filter applied twice
+template <typename Func>
+struct partition {
+    partition(Func&& func) : func(std::move(func)) {}
+    partition(const Func& func) : func(func) {}
+
+    template <concepts::Filterable F>
+    auto operator()(F&& left) && {
+        using Instance = instances::Filterable<std::remove_cvref_t<F>>;
+        if constexpr (requires { Instance::partition(std::forward<F>(left), std::move(func)); })
+            return Instance::partition(std::forward<F>(left), std::move(func));
+        else
+            return applySeparately(std::forward<F>(left), func);
+    }
+    template <concepts::Filterable F>
+    auto operator()(F&& left) const& {
+        using Instance = instances::Filterable<std::remove_cvref_t<F>>;
+        if constexpr (requires { Instance::partition(std::forward<F>(left), func); })
+            return Instance::partition(std::forward<F>(left), func);
+        else
+            return applySeparately(std::forward<F>(left), func);
+    }
+
+private:
+    // Accepted part is taken first, so rvalue source can still be moved to rejected one
+    template <typename F>
+    static auto applySeparately(F&& left, const Func& func) {
+        auto accepted = filter(func)(std::as_const(left));
+        auto rejected = filter([&func]<typename T>(const T& x) { return !static_cast<bool>(func(x)); })(std::forward<F>(left));
+        return std::make_pair(std::move(accepted), std::move(rejected));
+    }
+
+    Func func;
+};
+
+// Func gets Simd<T> batches and returns mask of accepted lanes. Contiguous containers of arithmetic types are filtered
+// batch by batch, other Filterables get each element broadcasted to a batch and first lane of mask is checked
+template <typename Func>
+struct filterSimd {
+    filterSimd(Func&& func) : func(std::move(func)) {}
+    filterSimd(const Func& func) : func(func) {}
+
+    template <concepts::Filterable F>
+    auto operator()(F&& left) && {
+        using Instance = instances::Filterable<std::remove_cvref_t<F>>;
+        if constexpr (requires { Instance::filterSimd(std::forward<F>(left), std::move(func)); })
+            return Instance::filterSimd(std::forward<F>(left), std::move(func));
+        else
+            return std::forward<F>(left) | filter(perElement(std::move(func)));
+    }
+    template <concepts::Filterable F>
+    auto operator()(F&& left) const& {
+        using Instance = instances::Filterable<std::remove_cvref_t<F>>;
+        if constexpr (requires { Instance::filterSimd(std::forward<F>(left), func); })
+            return Instance::filterSimd(std::forward<F>(left), func);
+        else
+            return std::forward<F>(left) | filter(perElement(func));
+    }
+
+private:
+    template <typename G>
+    static auto perElement(G&& func) {
+        return [func = std::forward<G>(func)]<typename T>(const T& x) {
+            return static_cast<bool>(cefal::detail::firstLane(func(Simd<T>(x))));
+        };
+    }
+
+    Func func;
+};
+
+// Runs predicate once and returns Selection of accepted elements instead of copying them.
+// Selection can later be gathered from the source or from any other container of the same size (i.e. other column)
+template <typename Func>
+struct select {
+    select(Func&& func) : func(std::move(func)) {}
+    select(const Func& func) : func(func) {}
+
+    template <concepts::Filterable F>
+    // clang-format off
+    requires requires(const F& left, const Func& func) { instances::Filterable<std::remove_cvref_t<F>>::select(left, func); }
+    // clang-format on
+    Selection operator()(const F& left) const {
+        return instances::Filterable<std::remove_cvref_t<F>>::select(left, func);
+    }
+
+private:
+    Func func;
+};
+
+// Copies selected elements to exactly sized container, elements of rvalue container are moved.
+// Selection passed as lvalue is referenced instead of being copied, so it should outlive the op.
+// Indices are not bounds checked, container should be at least as big as the one selection was made from
+template <typename S = Selection>
+struct gather {
+    gather(S selection) : selection(std::forward<S>(selection)) {}
+
+    template <concepts::Filterable F>
+    // clang-format off
+    requires requires(F&& left, const Selection& selection) {
+        instances::Filterable<std::remove_cvref_t<F>>::gather(std::forward<F>(left), selection);
+    }
+    // clang-format on
+    auto operator()(F&& left) const {
+        return instances::Filterable<std::remove_cvref_t<F>>::gather(std::forward<F>(left), std::as_const(selection));
+    }
+
+private:
+    S selection;
+};
+
 template <typename Func>
 filter(Func &&) -> filter<std::remove_cvref_t<Func>>;
+template <typename Func, typename Execution>
+filter(Func&&, Execution) -> filter<std::remove_cvref_t<Func>, Execution>;
 template <typename Func>
 innerFilter(Func &&) -> innerFilter<std::remove_cvref_t<Func>>;
+template <typename Func>
+mapMaybe(Func &&) -> mapMaybe<std::remove_cvref_t<Func>>;
+template <typename Func>
+partition(Func &&) -> partition<std::remove_cvref_t<Func>>;
+template <typename Func>
+filterSimd(Func &&) -> filterSimd<std::remove_cvref_t<Func>>;
+template <typename Func>
+select(Func &&) -> select<std::remove_cvref_t<Func>>;
+gather(const Selection&) -> gather<const Selection&>;
+gather(Selection&&) -> gather<Selection>;
 
 } // namespace ops
 } // namespace cefal
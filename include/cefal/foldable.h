@@ -85,6 +85,8 @@ struct foldLeft {
     }
 
 private:
+    template <typename>
+    friend struct detail::FusedStage;
     Result initial;
     Func func;
 };
@@ -92,5 +94,94 @@ private:
 template <typename Result, typename Func>
 foldLeft(Result&&, Func &&) -> foldLeft<std::remove_cvref_t<Result>, std::remove_cvref_t<Func>>;
 
+// Folds elements while accumulator satisfies condition, stops at the first one that doesn't.
+// Condition is checked for initial value too, so nothing is folded if it doesn't hold from the start.
+template <typename Result, typename Condition, typename Func>
+struct foldWhile {
+    foldWhile(Result initial, Condition condition, Func func)
+        : initial(std::move(initial)), condition(std::move(condition)), func(std::move(func)) {}
+
+    template <concepts::Foldable F>
+    auto operator()(F&& left) && {
+        if (!condition(std::as_const(initial)))
+            return std::move(initial);
+        return instances::Foldable<std::remove_cvref_t<F>>::foldLeft(std::forward<F>(left), std::move(initial), step());
+    }
+    template <concepts::Foldable F>
+    auto operator()(F&& left) const& {
+        if (!condition(initial))
+            return initial;
+        return instances::Foldable<std::remove_cvref_t<F>>::foldLeft(std::forward<F>(left), initial, step());
+    }
+
+private:
+    template <typename>
+    friend struct detail::FusedStage;
+
+    auto step() const {
+        return [this]<typename T>(Result&& acc, T&& x) {
+            Result result = func(std::move(acc), std::forward<T>(x));
+            const bool done = !condition(std::as_const(result));
+            return Reduced<Result>(std::move(result), done);
+        };
+    }
+
+    Result initial;
+    Condition condition;
+    Func func;
+};
+
+template <typename Result, typename Condition, typename Func>
+foldWhile(Result&&, Condition&&, Func &&)
+    -> foldWhile<std::remove_cvref_t<Result>, std::remove_cvref_t<Condition>, std::remove_cvref_t<Func>>;
+
+namespace detail {
+template <concepts::Monoid M, typename Func, typename Execution>
+struct foldMap_into {
+    foldMap_into(Func&& func) : func(std::move(func)) {}
+    foldMap_into(const Func& func) : func(func) {}
+
+    template <concepts::Foldable F>
+    auto operator()(F&& left) && {
+        return apply(std::forward<F>(left), std::move(func));
+    }
+    template <concepts::Foldable F>
+    auto operator()(F&& left) const& {
+        return apply(std::forward<F>(left), func);
+    }
+
+private:
+    template <typename>
+    friend struct FusedStage;
+
+    template <typename F, typename FuncRef>
+    static M apply(F&& left, FuncRef&& func) {
+        using Instance = instances::Foldable<std::remove_cvref_t<F>>;
+        if constexpr (requires { Instance::template foldMap<M>(std::forward<F>(left), func, Execution()); }) {
+            return Instance::template foldMap<M>(std::forward<F>(left), std::forward<FuncRef>(func), Execution());
+        } else {
+            return Instance::foldLeft(std::forward<F>(left), instances::Monoid<M>::empty(),
+                                      [&func]<typename T>(M&& result, T&& x) {
+                                          return instances::Monoid<M>::append(std::move(result),
+                                                                              static_cast<M>(func(std::forward<T>(x))));
+                                      });
+        }
+    }
+
+    Func func;
+};
+} // namespace detail
+
+// Maps each element to M and combines results with Monoid append.
+// With cefal::par chunks are reduced separately and combined in order, so append doesn't need to be commutative.
+template <concepts::Monoid M, typename Func>
+inline auto foldMap(Func&& func) {
+    return detail::foldMap_into<M, std::remove_cvref_t<Func>, Sequential>(std::forward<Func>(func));
+}
+template <concepts::Monoid M, typename Func, typename Execution>
+inline auto foldMap(Func&& func, Execution) {
+    return detail::foldMap_into<M, std::remove_cvref_t<Func>, Execution>(std::forward<Func>(func));
+}
+
 } // namespace ops
 } // namespace cefal
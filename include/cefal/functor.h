@@ -26,6 +26,7 @@
 #pragma once
 
 #include "cefal/common.h"
+#include "cefal/helpers/simd.h"
 
 #include <concepts>
 #include <functional>
@@ -74,21 +75,34 @@ inline auto unit(T&& x) requires concepts::Functor<F<CleanT>> {
     return unit<F<CleanT>>(std::forward<T>(x));
 }
 
-template <typename Func>
+// With cefal::par random access containers are mapped by chunks and associative ones are built in bulk
+template <typename Func, typename Execution = Sequential>
 struct map {
     map(Func&& func) : func(std::move(func)) {}
     map(const Func& func) : func(func) {}
+    map(Func&& func, Execution) : func(std::move(func)) {}
+    map(const Func& func, Execution) : func(func) {}
 
     template <concepts::Functor F>
     auto operator()(F&& left) && {
-        return instances::Functor<std::remove_cvref_t<F>>::map(std::forward<F>(left), std::move(func));
+        using Instance = instances::Functor<std::remove_cvref_t<F>>;
+        if constexpr (requires { Instance::map(std::forward<F>(left), std::move(func), Execution()); })
+            return Instance::map(std::forward<F>(left), std::move(func), Execution());
+        else
+            return Instance::map(std::forward<F>(left), std::move(func));
     }
     template <concepts::Functor F>
     auto operator()(F&& left) const& {
-        return instances::Functor<std::remove_cvref_t<F>>::map(std::forward<F>(left), func);
+        using Instance = instances::Functor<std::remove_cvref_t<F>>;
+        if constexpr (requires { Instance::map(std::forward<F>(left), func, Execution()); })
+            return Instance::map(std::forward<F>(left), func, Execution());
+        else
+            return Instance::map(std::forward<F>(left), func);
     }
 
 private:
+    template <typename>
+    friend struct detail::FusedStage;
     Func func;
 };
 
@@ -106,10 +120,49 @@ private:
     Func func;
 };
 
+// Func works with Simd<T> batches instead of single elements. Contiguous containers of arithmetic types are mapped
+// batch by batch, other Functors get each element broadcasted to a batch and first lane of result is taken
+template <typename Func>
+struct mapSimd {
+    mapSimd(Func&& func) : func(std::move(func)) {}
+    mapSimd(const Func& func) : func(func) {}
+
+    template <concepts::Functor F>
+    auto operator()(F&& left) && {
+        using Instance = instances::Functor<std::remove_cvref_t<F>>;
+        if constexpr (requires { Instance::mapSimd(std::forward<F>(left), std::move(func)); })
+            return Instance::mapSimd(std::forward<F>(left), std::move(func));
+        else
+            return std::forward<F>(left) | map(perElement(std::move(func)));
+    }
+    template <concepts::Functor F>
+    auto operator()(F&& left) const& {
+        using Instance = instances::Functor<std::remove_cvref_t<F>>;
+        if constexpr (requires { Instance::mapSimd(std::forward<F>(left), func); })
+            return Instance::mapSimd(std::forward<F>(left), func);
+        else
+            return std::forward<F>(left) | map(perElement(func));
+    }
+
+private:
+    template <typename G>
+    static auto perElement(G&& func) {
+        return [func = std::forward<G>(func)]<typename T>(const T& x) {
+            return cefal::detail::firstLane(func(Simd<T>(x)));
+        };
+    }
+
+    Func func;
+};
+
 template <typename Func>
 map(Func &&) -> map<std::remove_cvref_t<Func>>;
+template <typename Func, typename Execution>
+map(Func&&, Execution) -> map<std::remove_cvref_t<Func>, Execution>;
 template <typename Func>
 innerMap(Func &&) -> innerMap<std::remove_cvref_t<Func>>;
+template <typename Func>
+mapSimd(Func &&) -> mapSimd<std::remove_cvref_t<Func>>;
 
 } // namespace ops
 } // namespace cefal
@@ -0,0 +1,532 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include "cefal/detail/destination.h"
+#include "cefal/detail/instantiator.h"
+#include "cefal/detail/spsc_channel.h"
+#include "cefal/detail/std_concepts.h"
+#include "cefal/detail/thread_pool.h"
+
+#include "cefal/common.h"
+#include "cefal/converter.h"
+#include "cefal/filterable.h"
+#include "cefal/foldable.h"
+#include "cefal/functor.h"
+#include "cefal/monad.h"
+#include "cefal/monoid.h"
+
+#include <array>
+#include <concepts>
+#include <ranges>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace cefal {
+namespace ops {
+namespace detail {
+struct FusedNothing {};
+
+template <typename M, typename Next>
+void forEachFused(M&& m, Next&& next) {
+    ops::foldLeft(FusedNothing(), [&next]<typename T>(FusedNothing, T&& x) {
+        next(std::forward<T>(x));
+        return FusedNothing();
+    })(std::forward<M>(m));
+}
+
+// Marker that splits fused chain into segments running on separate threads, see ops::stage()
+struct stage_boundary {
+    // Returned by value, because sequentially applied chain would otherwise return reference to its own temporary
+    template <typename T>
+    std::remove_cvref_t<T> operator()(T&& x) const {
+        return std::forward<T>(x);
+    }
+};
+
+template <>
+struct FusedStage<stage_boundary> {
+    static constexpr bool terminal = false;
+    static constexpr bool filters = false;
+    static constexpr bool expands = false;
+
+    template <typename T>
+    using Output = T;
+
+    template <typename T, typename Next>
+    static void push(const stage_boundary&, T&& x, Next&& next) {
+        next(std::forward<T>(x));
+    }
+};
+
+template <typename Func>
+struct FusedStage<map<Func>> {
+    static constexpr bool terminal = false;
+    static constexpr bool filters = false;
+    static constexpr bool expands = false;
+
+    template <typename T>
+    using Output = std::remove_cvref_t<std::invoke_result_t<Func, T>>;
+
+    template <typename T, typename Next>
+    static void push(const map<Func>& stage, T&& x, Next&& next) {
+        next(stage.func(std::forward<T>(x)));
+    }
+};
+
+template <typename Func>
+struct FusedStage<filter<Func>> {
+    static constexpr bool terminal = false;
+    static constexpr bool filters = true;
+    static constexpr bool expands = false;
+
+    template <typename T>
+    using Output = T;
+
+    template <typename T, typename Next>
+    static void push(const filter<Func>& stage, T&& x, Next&& next) {
+        if (stage.func(std::as_const(x)))
+            next(std::forward<T>(x));
+    }
+};
+
+template <typename Func>
+struct FusedStage<mapMaybe<Func>> {
+    static constexpr bool terminal = false;
+    static constexpr bool filters = true;
+    static constexpr bool expands = false;
+
+    template <typename T>
+    using Output = std::remove_cvref_t<decltype(*std::declval<std::invoke_result_t<Func, T>>())>;
+
+    template <typename T, typename Next>
+    static void push(const mapMaybe<Func>& stage, T&& x, Next&& next) {
+        auto result = stage.func(std::forward<T>(x));
+        if (result)
+            next(std::move(*result));
+    }
+};
+
+template <typename Func>
+struct FusedStage<flatMap<Func>> {
+    static constexpr bool terminal = false;
+    static constexpr bool filters = false;
+    static constexpr bool expands = true;
+
+    template <typename T>
+    using Output = InnerType_T<std::invoke_result_t<Func, T>>;
+
+    template <typename T, typename Next>
+    static void push(const flatMap<Func>& stage, T&& x, Next&& next) {
+        forEachFused(stage.func(std::forward<T>(x)), std::forward<Next>(next));
+    }
+};
+
+template <typename Result, typename Func>
+struct FusedStage<foldLeft<Result, Func>> {
+    static constexpr bool terminal = true;
+    static constexpr bool filters = false;
+    static constexpr bool expands = false;
+
+    template <typename T>
+    using Output = T;
+
+    static Result initial(const foldLeft<Result, Func>& stage) { return stage.initial; }
+
+    template <typename T>
+    static bool step(const foldLeft<Result, Func>& stage, Result& acc, T&& x) {
+        return cefal::detail::applyFoldStep(acc, stage.func, std::forward<T>(x));
+    }
+};
+
+template <typename Result, typename Condition, typename Func>
+struct FusedStage<foldWhile<Result, Condition, Func>> {
+    static constexpr bool terminal = true;
+    static constexpr bool filters = false;
+    static constexpr bool expands = false;
+
+    template <typename T>
+    using Output = T;
+
+    static Result initial(const foldWhile<Result, Condition, Func>& stage) { return stage.initial; }
+    static bool done(const foldWhile<Result, Condition, Func>& stage, const Result& acc) { return !stage.condition(acc); }
+
+    template <typename T>
+    static bool step(const foldWhile<Result, Condition, Func>& stage, Result& acc, T&& x) {
+        acc = stage.func(std::move(acc), std::forward<T>(x));
+        return done(stage, acc);
+    }
+};
+
+template <typename M, typename Func>
+struct FusedStage<foldMap_into<M, Func, Sequential>> {
+    static constexpr bool terminal = true;
+    static constexpr bool filters = false;
+    static constexpr bool expands = false;
+
+    template <typename T>
+    using Output = T;
+
+    static M initial(const foldMap_into<M, Func, Sequential>&) { return instances::Monoid<M>::empty(); }
+
+    template <typename T>
+    static void step(const foldMap_into<M, Func, Sequential>& stage, M& acc, T&& x) {
+        acc = instances::Monoid<M>::append(std::move(acc), static_cast<M>(stage.func(std::forward<T>(x))));
+    }
+};
+
+template <template <typename...> typename U>
+struct FusedStage<as_templated<U>> {
+    static constexpr bool terminal = true;
+    static constexpr bool filters = false;
+    static constexpr bool expands = false;
+
+    template <typename T>
+    using Output = T;
+
+    template <typename Src, typename T>
+    using Dest = WithInnerType_T<cefal::detail::Instantiator_T<U>, T>;
+};
+
+template <typename U>
+struct FusedStage<as_full<U>> {
+    static constexpr bool terminal = true;
+    static constexpr bool filters = false;
+    static constexpr bool expands = false;
+
+    template <typename T>
+    using Output = T;
+
+    template <typename Src, typename T>
+    using Dest = std::remove_cvref_t<U>;
+};
+
+template <typename Dest>
+struct FusedStage<into<Dest>> {
+    using Sink = cefal::detail::DestinationSink<Dest>;
+    static constexpr bool terminal = true;
+    static constexpr bool filters = false;
+    static constexpr bool expands = false;
+
+    template <typename T>
+    using Output = T;
+
+    static Sink initial(const into<Dest>& stage) { return Sink(stage.dest); }
+    template <typename T>
+    static void step(const into<Dest>&, Sink& sink, T&& x) {
+        static_assert(std::is_same_v<NakedInnerType_T<Dest>, typename cefal::detail::FullDecay<std::remove_cvref_t<T>>::type>,
+                      "cefal::ops::into can be called only for destination with same inner type as source");
+        sink.add(std::forward<T>(x));
+    }
+    static Dest& finish(const into<Dest>&, Sink& sink) { return sink.finish(); }
+};
+
+template <typename T, typename... Stages>
+struct FusedOutput {
+    using type = T;
+};
+template <typename T, typename Stage, typename... Stages>
+struct FusedOutput<T, Stage, Stages...> : FusedOutput<typename FusedStage<Stage>::template Output<T>, Stages...> {};
+template <typename T, typename... Stages>
+using FusedOutput_T = cefal::detail::FullDecay<typename FusedOutput<T, Stages...>::type>::type;
+
+// Output of first N stages
+template <size_t N, typename T, typename... Stages>
+struct FusedPrefixOutput {
+    using type = T;
+};
+template <size_t N, typename T, typename Stage, typename... Stages>
+requires(N > 0) struct FusedPrefixOutput<N, T, Stage, Stages...>
+    : FusedPrefixOutput<N - 1, typename FusedStage<Stage>::template Output<T>, Stages...> {};
+template <size_t N, typename T, typename... Stages>
+using FusedPrefixOutput_T = cefal::detail::FullDecay<typename FusedPrefixOutput<N, T, Stages...>::type>::type;
+
+template <typename... Stages>
+class Fused;
+
+template <typename T>
+struct IsFused : std::false_type {};
+template <typename... Stages>
+struct IsFused<Fused<Stages...>> : std::true_type {};
+
+template <typename Op>
+struct IsTerminalOp : std::bool_constant<FusedStage<Op>::terminal> {};
+template <typename... Stages>
+struct IsTerminalOp<Fused<Stages...>> : std::bool_constant<Fused<Stages...>::terminal> {};
+
+// clang-format off
+template <typename Op, typename CleanOp = std::remove_cvref_t<Op>>
+concept FusableOp = IsFused<CleanOp>::value || requires { FusedStage<CleanOp>::terminal; };
+
+template <typename Op, typename CleanOp = std::remove_cvref_t<Op>>
+concept TerminalOp = FusableOp<Op> && IsTerminalOp<CleanOp>::value;
+
+template <typename Src, typename CleanSrc = std::remove_cvref_t<Src>>
+concept FusableSource = concepts::Foldable<CleanSrc> && (!std::ranges::view<CleanSrc>) && (!FusableOp<CleanSrc>);
+
+template <typename Dest>
+concept FusableDestination = concepts::SingletonEnabledMonoid<Dest>;
+// clang-format on
+
+template <typename Dest, typename T>
+void appendToFusedDestination(Dest& dest, T&& x) {
+    if constexpr (cefal::detail::VectorLikeContainer<Dest>)
+        dest.push_back(std::forward<T>(x));
+    else if constexpr (cefal::detail::SetLikeContainer<Dest>)
+        dest.insert(std::forward<T>(x));
+    else
+        dest = ops::append(helpers::SingletonFrom<Dest>{std::forward<T>(x)})(std::move(dest));
+}
+
+// Chain of map/filter/flatMap ops (optionally ending with foldLeft or as) that is applied
+// to Foldable source in one pass, without materializing intermediate containers.
+// Sources and destinations that can't be driven this way (ranges, optionals, types without SingletonFrom)
+// just get each op applied one by one.
+// If chain contains stage() markers, segments between them are run as a pipeline on separate threads.
+template <typename... Stages>
+class Fused {
+    using LastStage = std::tuple_element_t<sizeof...(Stages) - 1, std::tuple<Stages...>>;
+    static constexpr bool hasTerminal = FusedStage<LastStage>::terminal;
+    static constexpr size_t elementStagesCount = sizeof...(Stages) - (hasTerminal ? 1 : 0);
+    static constexpr bool filters = (FusedStage<Stages>::filters || ...);
+    static constexpr bool expands = (FusedStage<Stages>::expands || ...);
+    static constexpr size_t boundariesCount = (size_t(std::is_same_v<Stages, stage_boundary>) + ...);
+    static constexpr std::array<size_t, boundariesCount> boundaries = [] {
+        std::array<size_t, boundariesCount> result{};
+        size_t index = 0;
+        size_t found = 0;
+        ((std::is_same_v<Stages, stage_boundary> ? (void)(result[found++] = index++) : (void)index++), ...);
+        return result;
+    }();
+
+public:
+    static constexpr bool terminal = hasTerminal;
+
+    Fused(std::tuple<Stages...>&& stages) : _stages(std::move(stages)) {}
+    Fused(const std::tuple<Stages...>& stages) : _stages(stages) {}
+
+    const std::tuple<Stages...>& stages() const& { return _stages; }
+    std::tuple<Stages...>&& stages() && { return std::move(_stages); }
+
+    template <typename Input>
+    requires(!FusableOp<Input>) decltype(auto) operator()(Input&& src) const {
+        using Src = std::remove_cvref_t<Input>;
+        if constexpr (!FusableSource<Src>) {
+            return applySequentially<0>(std::forward<Input>(src));
+        } else {
+            using Output = FusedOutput_T<InnerType_T<Src>, Stages...>;
+            if constexpr (requires { FusedStage<LastStage>::initial(std::get<sizeof...(Stages) - 1>(_stages)); }) {
+                const auto& stage = std::get<sizeof...(Stages) - 1>(_stages);
+                auto result = FusedStage<LastStage>::initial(stage);
+                // Steps returning bool can stop the chain, nothing is passed to them afterwards
+                bool stopped = false;
+                if constexpr (requires { FusedStage<LastStage>::done(stage, result); })
+                    stopped = FusedStage<LastStage>::done(stage, result);
+                auto step = [&stage, &result, &stopped]<typename T>(T&& x) {
+                    using StepResult = decltype(FusedStage<LastStage>::step(stage, result, std::forward<T>(x)));
+                    if constexpr (std::is_same_v<StepResult, bool>) {
+                        if (!stopped)
+                            stopped = FusedStage<LastStage>::step(stage, result, std::forward<T>(x));
+                    } else {
+                        FusedStage<LastStage>::step(stage, result, std::forward<T>(x));
+                    }
+                };
+                if (!stopped)
+                    drive(std::forward<Input>(src), step, stopped);
+                if constexpr (requires { FusedStage<LastStage>::finish(stage, result); })
+                    return FusedStage<LastStage>::finish(stage, result);
+                else
+                    return result;
+            } else if constexpr (hasTerminal) {
+                using Dest = typename FusedStage<LastStage>::template Dest<Src, Output>;
+                static_assert(std::is_same_v<NakedInnerType_T<Dest>, Output>,
+                              "cefal::ops::as can be called only for destination with same inner type as source");
+                if constexpr (FusableDestination<Dest>)
+                    return materialize<Dest>(std::forward<Input>(src));
+                else
+                    return applySequentially<0>(std::forward<Input>(src));
+            } else if constexpr (requires { typename WithInnerType_T<Src, Output>; }) {
+                using Dest = WithInnerType_T<Src, Output>;
+                if constexpr (FusableDestination<Dest>)
+                    return materialize<Dest>(std::forward<Input>(src));
+                else
+                    return applySequentially<0>(std::forward<Input>(src));
+            } else {
+                return applySequentially<0>(std::forward<Input>(src));
+            }
+        }
+    }
+
+    template <typename Left, typename Op>
+    // clang-format off
+    requires std::same_as<std::remove_cvref_t<Op>, Fused> && (!FusableOp<Left>)
+        // clang-format on
+        friend decltype(auto) operator|(Left&& left, Op&& op) {
+        return std::forward<Op>(op)(std::forward<Left>(left));
+    }
+
+private:
+    template <typename Dest, typename Input>
+    Dest materialize(Input&& src) const {
+        using Src = std::remove_cvref_t<Input>;
+        // Maps-only chain on rvalue vector-like container that returns same type can be done in place
+        if constexpr (std::is_same_v<Src, Dest> && cefal::detail::VectorLikeContainer<Src> && !std::is_lvalue_reference_v<Input>
+                      && !filters && !expands && !hasTerminal && !boundariesCount) {
+            for (auto&& x : src)
+                push<0>(std::move(x), [&x]<typename T>(T&& result) { x = std::forward<T>(result); });
+            return std::move(src);
+        } else {
+            Dest dest = cefal::detail::createDestination<Dest>(src);
+            if constexpr (!expands && cefal::detail::TransferableSize<Src, Dest>)
+                dest.reserve(src.size());
+            drive(std::forward<Input>(src), [&dest]<typename T>(T&& x) { appendToFusedDestination(dest, std::forward<T>(x)); });
+            if constexpr (filters && !expands && cefal::detail::Reservable<Dest>) {
+                dest.shrink_to_fit();
+            } else if constexpr (filters && !expands && cefal::detail::UnorderedAssociativeContainer<Dest>) {
+                // Buckets were reserved for whole source, give them back if most of elements were rejected
+                if (dest.size() < dest.bucket_count() * dest.max_load_factor() / 4)
+                    dest.rehash(0);
+            }
+            return dest;
+        }
+    }
+
+    // Source is left as soon as sink sets stopped flag. Pipelines still run to the end, sink has to ignore the rest itself
+    template <typename Input, typename Sink>
+    void drive(Input&& src, Sink&& sink, const bool& stopped = false) const {
+        if constexpr (boundariesCount) {
+            drivePipeline(std::forward<Input>(src), sink, std::make_index_sequence<boundariesCount>());
+        } else {
+            ops::foldLeft(FusedNothing(), [this, &sink, &stopped]<typename T>(FusedNothing, T&& x) {
+                push<0>(std::forward<T>(x), sink);
+                return Reduced<FusedNothing>(FusedNothing(), stopped);
+            })(std::forward<Input>(src));
+        }
+    }
+
+    // Segment N (between boundaries N - 1 and N) runs on its own thread and passes results to the next one
+    // through channel N. Segments wait for each other, so they all are run at the same time with idle workers of
+    // shared pool and threads started for the rest.
+    template <typename Input, typename Sink, size_t... Ns>
+    void drivePipeline(Input&& src, Sink& sink, std::index_sequence<Ns...>) const {
+        using T = InnerType_T<std::remove_cvref_t<Input>>;
+        using State = cefal::detail::PipelineState<boundariesCount + 1>;
+        State state;
+        std::tuple<cefal::detail::SpscChannel<FusedPrefixOutput_T<boundaries[Ns], T, Stages...>, State>...> channels(
+            ((void)Ns, state)...);
+        auto segment = [this, &state, &channels, &src, &sink]<size_t N>(std::integral_constant<size_t, N>) {
+            state.run(N, [this, &channels, &src, &sink] { runSegment<N>(channels, std::forward<Input>(src), sink); });
+        };
+        cefal::detail::ThreadPool::instance().runConcurrently(
+            boundariesCount + 1,
+            [&segment](size_t n) {
+                if (n == boundariesCount)
+                    segment(std::integral_constant<size_t, boundariesCount>());
+                else
+                    ((n == Ns ? segment(std::integral_constant<size_t, Ns>()) : void()), ...);
+            },
+            [&state] { state.cancel(); });
+        state.rethrow();
+    }
+
+    template <size_t N, typename Channels, typename Input, typename Sink>
+    void runSegment(Channels& channels, Input&& src, Sink& sink) const {
+        [[maybe_unused]] constexpr size_t begin = N ? boundaries[N - 1] + 1 : 0;
+        [[maybe_unused]] constexpr size_t end = N == boundariesCount ? elementStagesCount : boundaries[N];
+        auto output = [&channels, &sink]<typename U>(U&& y) {
+            if constexpr (N == boundariesCount)
+                sink(std::forward<U>(y));
+            else
+                std::get<N>(channels).push(std::forward<U>(y));
+        };
+        if constexpr (N == 0) {
+            ops::foldLeft(FusedNothing(), [this, &output]<typename T>(FusedNothing, T&& x) {
+                push<begin, end>(std::forward<T>(x), output);
+                return FusedNothing();
+            })(std::forward<Input>(src));
+        } else {
+            std::get<N - 1>(channels).consume([this, &output]<typename T>(T&& x) { push<begin, end>(std::forward<T>(x), output); });
+        }
+        if constexpr (N != boundariesCount)
+            std::get<N>(channels).close();
+    }
+
+    template <size_t I, size_t End = elementStagesCount, typename T, typename Sink>
+    void push(T&& x, Sink&& sink) const {
+        if constexpr (I == End) {
+            sink(std::forward<T>(x));
+        } else {
+            using Stage = std::tuple_element_t<I, std::tuple<Stages...>>;
+            FusedStage<Stage>::push(std::get<I>(_stages), std::forward<T>(x),
+                                    [this, &sink]<typename U>(U&& y) { push<I + 1, End>(std::forward<U>(y), sink); });
+        }
+    }
+
+    template <size_t I, typename T>
+    decltype(auto) applySequentially(T&& x) const {
+        if constexpr (I + 1 == sizeof...(Stages))
+            return std::get<I>(_stages)(std::forward<T>(x));
+        else
+            return applySequentially<I + 1>(std::get<I>(_stages)(std::forward<T>(x)));
+    }
+
+    std::tuple<Stages...> _stages;
+};
+
+template <typename... Stages>
+Fused(std::tuple<Stages...>&&) -> Fused<Stages...>;
+template <typename... Stages>
+Fused(const std::tuple<Stages...>&) -> Fused<Stages...>;
+
+template <typename Op>
+auto fusedStages(Op&& op) {
+    if constexpr (IsFused<std::remove_cvref_t<Op>>::value)
+        return std::forward<Op>(op).stages();
+    else
+        return std::tuple<std::remove_cvref_t<Op>>(std::forward<Op>(op));
+}
+} // namespace detail
+
+// Splits fused chain, i.e. in `src | (map(f) | stage() | filter(p) | map(g))` f is run on one thread while
+// filter and g are run on another one for previously produced elements. Each segment is still run by single thread,
+// so functions in it don't need to be thread safe, only segments are run concurrently.
+inline auto stage() {
+    return detail::stage_boundary();
+}
+
+// Composing ops before applying them produces single fused op, i.e.
+// `src | (map(f) | filter(p) | map(g))` walks src once and allocates only final container.
+// Without parentheses each op is applied to container on its left and materializes its own result.
+template <typename Left, typename Right>
+// clang-format off
+requires detail::FusableOp<Left> && detail::FusableOp<Right> && (!detail::TerminalOp<Left>)
+    // clang-format on
+    inline auto operator|(Left&& left, Right&& right) {
+    return detail::Fused(std::tuple_cat(detail::fusedStages(std::forward<Left>(left)), detail::fusedStages(std::forward<Right>(right))));
+}
+} // namespace ops
+} // namespace cefal
@@ -0,0 +1,94 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
+
+namespace cefal {
+namespace detail {
+inline std::pmr::memory_resource*& currentArenaResource() {
+    thread_local std::pmr::memory_resource* resource = nullptr;
+    return resource;
+}
+
+// clang-format off
+template <typename C>
+concept ArenaAllocatable = requires { typename C::allocator_type; }
+                           && std::is_constructible_v<typename C::allocator_type, std::pmr::memory_resource*>;
+// clang-format on
+
+// Containers with memory resource based allocator (std::pmr ones) are created in current ArenaScope if there is one
+template <typename C>
+C createInArena() {
+    if constexpr (ArenaAllocatable<C>) {
+        if (auto resource = currentArenaResource())
+            return C(typename C::allocator_type(resource));
+    }
+    return C();
+}
+
+// Copy constructor of pmr container uses default resource, so lvalues are copied into arena explicitly.
+// Rvalues are moved as is, together with their allocator
+template <typename C, typename T>
+C forwardToArena(T&& x) {
+    if constexpr (ArenaAllocatable<C> && std::is_lvalue_reference_v<T>) {
+        if (auto resource = currentArenaResource())
+            return C(x, typename C::allocator_type(resource));
+    }
+    return std::forward<T>(x);
+}
+} // namespace detail
+
+// All containers created by cefal operations on this thread during scope lifetime are allocated from arena,
+// as long as their allocator can be constructed from std::pmr::memory_resource (i.e. std::pmr containers).
+// Memory is released at once when scope is destroyed, so these containers must not outlive it.
+// Scopes can be nested, innermost one is used.
+// Without active scope destinations get allocator of source container instead.
+// Arena is not thread safe, so parallel operations (cefal::par) that fill destination from worker threads create it
+// with default memory resource. Worker threads don't see arena either.
+class ArenaScope {
+public:
+    ArenaScope() : _previous(detail::currentArenaResource()) { detail::currentArenaResource() = &_resource; }
+    explicit ArenaScope(size_t initialSize) : _resource(initialSize), _previous(detail::currentArenaResource()) {
+        detail::currentArenaResource() = &_resource;
+    }
+    ArenaScope(void* buffer, size_t size) : _resource(buffer, size), _previous(detail::currentArenaResource()) {
+        detail::currentArenaResource() = &_resource;
+    }
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+    ~ArenaScope() { detail::currentArenaResource() = _previous; }
+
+    std::pmr::memory_resource* resource() { return &_resource; }
+
+private:
+    std::pmr::monotonic_buffer_resource _resource;
+    std::pmr::memory_resource* _previous;
+};
+} // namespace cefal
@@ -26,6 +26,8 @@
 #pragma once
 
 #include <concepts>
+#include <limits>
+#include <type_traits>
 
 namespace cefal {
 namespace detail {
@@ -46,4 +48,48 @@ struct Product {
     T value;
     operator T() const { return value; }
 };
+
+// Default constructed Min and Max hold identity of their monoids, so they can be used as accumulators right away
+template <detail::Arithmetic T>
+struct Min {
+    Min() {
+        if constexpr (std::numeric_limits<T>::has_infinity)
+            value = std::numeric_limits<T>::infinity();
+        else
+            value = std::numeric_limits<T>::max();
+    }
+    Min(T x) : value(x) {}
+    T value;
+    operator T() const { return value; }
+};
+
+template <detail::Arithmetic T>
+struct Max {
+    Max() {
+        if constexpr (std::numeric_limits<T>::has_infinity)
+            value = -std::numeric_limits<T>::infinity();
+        else
+            value = std::numeric_limits<T>::lowest();
+    }
+    Max(T x) : value(x) {}
+    T value;
+    operator T() const { return value; }
+};
+
+namespace detail {
+// Monoids over plain numbers, their append is commutative, so elements can be combined in any order
+template <typename M>
+struct IsArithmeticMonoid : std::false_type {};
+template <typename T>
+struct IsArithmeticMonoid<Sum<T>> : std::true_type {};
+template <typename T>
+struct IsArithmeticMonoid<Product<T>> : std::true_type {};
+template <typename T>
+struct IsArithmeticMonoid<Min<T>> : std::true_type {};
+template <typename T>
+struct IsArithmeticMonoid<Max<T>> : std::true_type {};
+
+template <typename M>
+concept ArithmeticMonoid = IsArithmeticMonoid<M>::value;
+} // namespace detail
 } // namespace cefal
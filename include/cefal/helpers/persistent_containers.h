@@ -0,0 +1,66 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include "cefal/containers/persistent_map.h"
+#include "cefal/containers/persistent_set.h"
+#include "cefal/helpers/std_containers.h"
+
+#include "cefal/common.h"
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace cefal {
+template <typename K, typename V, typename Hash, typename KeyEqual>
+struct InnerType<PersistentMap<K, V, Hash, KeyEqual>> {
+    using type = std::pair<K, V>;
+};
+
+// Hasher and key comparator are carried over to the result, rebound to the new inner type
+template <typename T, typename Hash, typename KeyEqual, typename NewT>
+struct WithInnerType<PersistentSet<T, Hash, KeyEqual>, NewT> {
+    using type = PersistentSet<NewT, detail::RebindHash_T<Hash, T, NewT>, detail::RebindKeyEqual_T<KeyEqual, T, NewT>>;
+};
+
+namespace detail {
+template <typename K, typename Hash, typename KeyEqual, typename NewK, typename NewV>
+struct WithPersistentMapInnerType {
+    using KeyType = std::remove_cvref_t<NewK>;
+    using ValueType = std::remove_cvref_t<NewV>;
+    using type = PersistentMap<KeyType, ValueType, RebindHash_T<Hash, K, KeyType>, RebindKeyEqual_T<KeyEqual, K, KeyType>>;
+};
+} // namespace detail
+
+template <typename K, typename V, typename Hash, typename KeyEqual, typename NewK, typename NewV>
+struct WithInnerType<PersistentMap<K, V, Hash, KeyEqual>, std::tuple<NewK, NewV>>
+    : detail::WithPersistentMapInnerType<K, Hash, KeyEqual, NewK, NewV> {};
+
+template <typename K, typename V, typename Hash, typename KeyEqual, typename NewK, typename NewV>
+struct WithInnerType<PersistentMap<K, V, Hash, KeyEqual>, std::pair<NewK, NewV>>
+    : detail::WithPersistentMapInnerType<K, Hash, KeyEqual, NewK, NewV> {};
+} // namespace cefal
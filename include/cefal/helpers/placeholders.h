@@ -0,0 +1,259 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include "cefal/helpers/nums.h"
+#include "cefal/helpers/simd.h"
+
+#include <concepts>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+namespace cefal {
+namespace detail {
+template <typename T>
+struct IsPlaceholderExpression : std::false_type {};
+
+// clang-format off
+template <typename T>
+concept PlaceholderExpression = IsPlaceholderExpression<std::remove_cvref_t<T>>::value;
+
+template <typename L, typename R>
+concept PlaceholderOperands = (PlaceholderExpression<L> || PlaceholderExpression<R>)
+                              && (PlaceholderExpression<L> || Arithmetic<std::remove_cvref_t<L>>)
+                              && (PlaceholderExpression<R> || Arithmetic<std::remove_cvref_t<R>>);
+// clang-format on
+
+struct Placeholder {
+    template <typename T>
+    const T& operator()(const T& x) const {
+        return x;
+    }
+};
+
+// Constants are converted to element type when evaluated for a batch, so i.e. `_1 > 4` works for batches of floats
+template <typename T>
+struct PlaceholderConstant {
+    T value;
+
+    template <typename X>
+    auto operator()(const X&) const {
+        if constexpr (isSimd<X>)
+            return X(static_cast<typename X::value_type>(value));
+        else
+            return value;
+    }
+};
+
+template <typename Op, typename Arg>
+struct PlaceholderUnary {
+    Arg arg;
+
+    template <typename X>
+    auto operator()(const X& x) const {
+        return Op()(arg(x));
+    }
+};
+
+template <typename Op, typename Left, typename Right>
+struct PlaceholderBinary {
+    Left left;
+    Right right;
+
+    template <typename X>
+    auto operator()(const X& x) const {
+        return Op()(left(x), right(x));
+    }
+};
+
+// Scalars keep short circuit of && and ||, batches get both sides evaluated for all lanes.
+// Right side guarded by left one (i.e. `_1 != 0 && 100 / _1 > 3`) can't be evaluated for all lanes if it divides
+// integers, such expressions are not batchable (see PlaceholderBatchable).
+template <bool isAnd, typename Left, typename Right>
+struct PlaceholderLogical {
+    Left left;
+    Right right;
+
+    template <typename X>
+    auto operator()(const X& x) const {
+        if constexpr (isAnd)
+            return left(x) && right(x);
+        else
+            return left(x) || right(x);
+    }
+};
+
+template <>
+struct IsPlaceholderExpression<Placeholder> : std::true_type {};
+template <typename Op, typename Arg>
+struct IsPlaceholderExpression<PlaceholderUnary<Op, Arg>> : std::true_type {};
+template <typename Op, typename Left, typename Right>
+struct IsPlaceholderExpression<PlaceholderBinary<Op, Left, Right>> : std::true_type {};
+template <bool isAnd, typename Left, typename Right>
+struct IsPlaceholderExpression<PlaceholderLogical<isAnd, Left, Right>> : std::true_type {};
+
+// Integer division (and modulus) by element dependent value can trap for lanes that short circuit would skip.
+// Division by constant is allowed, it traps for scalars too.
+template <typename Op, typename Divisor>
+struct PlaceholderDividesBy : std::bool_constant<std::is_same_v<Op, std::divides<>> || std::is_same_v<Op, std::modulus<>>> {};
+template <typename Op, typename C>
+struct PlaceholderDividesBy<Op, PlaceholderConstant<C>> : std::false_type {};
+
+template <typename Expr>
+struct PlaceholderDivides : std::false_type {};
+template <typename Op, typename Arg>
+struct PlaceholderDivides<PlaceholderUnary<Op, Arg>> : PlaceholderDivides<Arg> {};
+template <typename Op, typename Left, typename Right>
+struct PlaceholderDivides<PlaceholderBinary<Op, Left, Right>>
+    : std::disjunction<PlaceholderDividesBy<Op, Right>, PlaceholderDivides<Left>, PlaceholderDivides<Right>> {};
+template <bool isAnd, typename Left, typename Right>
+struct PlaceholderDivides<PlaceholderLogical<isAnd, Left, Right>>
+    : std::disjunction<PlaceholderDivides<Left>, PlaceholderDivides<Right>> {};
+
+// Scalars narrower than int are promoted before arithmetic, batches are not, so i.e. `_1 + _1 > 100` for int8_t
+// would overflow only in batches. Comparisons give the same result either way.
+template <typename Op>
+struct PlaceholderArithmeticOp
+    : std::disjunction<std::is_same<Op, std::plus<>>, std::is_same<Op, std::minus<>>, std::is_same<Op, std::multiplies<>>,
+                       std::is_same<Op, std::divides<>>, std::is_same<Op, std::modulus<>>, std::is_same<Op, std::negate<>>> {};
+template <typename Op, typename T>
+struct PlaceholderPromotionFree
+    : std::disjunction<std::negation<PlaceholderArithmeticOp<Op>>, std::is_same<decltype(+std::declval<T>()), T>> {};
+
+// Batches are evaluated in element type, so constants of wider types (i.e. `_1 < 4.5` for ints) or arithmetic on
+// promoted types would change meaning of expression. Such expressions are evaluated element by element.
+template <typename Expr, typename T>
+struct PlaceholderBatchable : std::true_type {};
+template <typename C, typename T>
+struct PlaceholderBatchable<PlaceholderConstant<C>, T> : std::is_same<std::common_type_t<T, C>, T> {};
+template <typename Op, typename Arg, typename T>
+struct PlaceholderBatchable<PlaceholderUnary<Op, Arg>, T>
+    : std::conjunction<PlaceholderPromotionFree<Op, T>, PlaceholderBatchable<Arg, T>> {};
+template <typename Op, typename Left, typename Right, typename T>
+struct PlaceholderBatchable<PlaceholderBinary<Op, Left, Right>, T>
+    : std::conjunction<PlaceholderPromotionFree<Op, T>, PlaceholderBatchable<Left, T>, PlaceholderBatchable<Right, T>> {};
+template <bool isAnd, typename Left, typename Right, typename T>
+struct PlaceholderBatchable<PlaceholderLogical<isAnd, Left, Right>, T>
+    : std::conjunction<PlaceholderBatchable<Left, T>, PlaceholderBatchable<Right, T>,
+                       std::disjunction<std::is_floating_point<T>, std::negation<PlaceholderDivides<Right>>>> {};
+
+// clang-format off
+template <typename Expr, typename T>
+concept BatchPredicate = PlaceholderExpression<Expr> && SimdArithmetic<T>
+                         && PlaceholderBatchable<std::remove_cvref_t<Expr>, T>::value
+                         && isSimdMask<decltype(std::declval<const std::remove_cvref_t<Expr>&>()(std::declval<const Simd<T>&>()))>;
+// clang-format on
+
+template <typename T>
+auto toPlaceholderOperand(T&& x) {
+    if constexpr (PlaceholderExpression<T>)
+        return std::remove_cvref_t<T>(std::forward<T>(x));
+    else
+        return PlaceholderConstant<std::remove_cvref_t<T>>{std::forward<T>(x)};
+}
+
+template <typename Op, typename L, typename R>
+auto makePlaceholderBinary(L&& left, R&& right) {
+    auto l = toPlaceholderOperand(std::forward<L>(left));
+    auto r = toPlaceholderOperand(std::forward<R>(right));
+    return PlaceholderBinary<Op, decltype(l), decltype(r)>{std::move(l), std::move(r)};
+}
+
+template <bool isAnd, typename L, typename R>
+auto makePlaceholderLogical(L&& left, R&& right) {
+    auto l = toPlaceholderOperand(std::forward<L>(left));
+    auto r = toPlaceholderOperand(std::forward<R>(right));
+    return PlaceholderLogical<isAnd, decltype(l), decltype(r)>{std::move(l), std::move(r)};
+}
+
+template <typename L, typename R>
+requires PlaceholderOperands<L, R> auto operator+(L&& left, R&& right) {
+    return makePlaceholderBinary<std::plus<>>(std::forward<L>(left), std::forward<R>(right));
+}
+template <typename L, typename R>
+requires PlaceholderOperands<L, R> auto operator-(L&& left, R&& right) {
+    return makePlaceholderBinary<std::minus<>>(std::forward<L>(left), std::forward<R>(right));
+}
+template <typename L, typename R>
+requires PlaceholderOperands<L, R> auto operator*(L&& left, R&& right) {
+    return makePlaceholderBinary<std::multiplies<>>(std::forward<L>(left), std::forward<R>(right));
+}
+template <typename L, typename R>
+requires PlaceholderOperands<L, R> auto operator/(L&& left, R&& right) {
+    return makePlaceholderBinary<std::divides<>>(std::forward<L>(left), std::forward<R>(right));
+}
+template <typename L, typename R>
+requires PlaceholderOperands<L, R> auto operator%(L&& left, R&& right) {
+    return makePlaceholderBinary<std::modulus<>>(std::forward<L>(left), std::forward<R>(right));
+}
+template <typename L, typename R>
+requires PlaceholderOperands<L, R> auto operator==(L&& left, R&& right) {
+    return makePlaceholderBinary<std::equal_to<>>(std::forward<L>(left), std::forward<R>(right));
+}
+template <typename L, typename R>
+requires PlaceholderOperands<L, R> auto operator!=(L&& left, R&& right) {
+    return makePlaceholderBinary<std::not_equal_to<>>(std::forward<L>(left), std::forward<R>(right));
+}
+template <typename L, typename R>
+requires PlaceholderOperands<L, R> auto operator<(L&& left, R&& right) {
+    return makePlaceholderBinary<std::less<>>(std::forward<L>(left), std::forward<R>(right));
+}
+template <typename L, typename R>
+requires PlaceholderOperands<L, R> auto operator<=(L&& left, R&& right) {
+    return makePlaceholderBinary<std::less_equal<>>(std::forward<L>(left), std::forward<R>(right));
+}
+template <typename L, typename R>
+requires PlaceholderOperands<L, R> auto operator>(L&& left, R&& right) {
+    return makePlaceholderBinary<std::greater<>>(std::forward<L>(left), std::forward<R>(right));
+}
+template <typename L, typename R>
+requires PlaceholderOperands<L, R> auto operator>=(L&& left, R&& right) {
+    return makePlaceholderBinary<std::greater_equal<>>(std::forward<L>(left), std::forward<R>(right));
+}
+template <typename L, typename R>
+requires PlaceholderOperands<L, R> auto operator&&(L&& left, R&& right) {
+    return makePlaceholderLogical<true>(std::forward<L>(left), std::forward<R>(right));
+}
+template <typename L, typename R>
+requires PlaceholderOperands<L, R> auto operator||(L&& left, R&& right) {
+    return makePlaceholderLogical<false>(std::forward<L>(left), std::forward<R>(right));
+}
+template <PlaceholderExpression T>
+auto operator!(T&& arg) {
+    return PlaceholderUnary<std::logical_not<>, std::remove_cvref_t<T>>{std::forward<T>(arg)};
+}
+template <PlaceholderExpression T>
+auto operator-(T&& arg) {
+    return PlaceholderUnary<std::negate<>, std::remove_cvref_t<T>>{std::forward<T>(arg)};
+}
+} // namespace detail
+
+// Argument of predicate built from expression, i.e. `_1 > 4 && _1 % 3 == 0`.
+// Such predicate is a normal callable, but ops::filter also evaluates it for whole batches of arithmetic values
+// in contiguous containers (see ops::filterSimd()).
+inline constexpr detail::Placeholder _1;
+} // namespace cefal
@@ -0,0 +1,73 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include <type_traits>
+#include <utility>
+
+namespace cefal {
+// Step function of foldLeft can return Reduced<Result> instead of Result.
+// Once it returns value marked as done, Foldable instances stop iterating and this value becomes result of the fold.
+template <typename T>
+struct Reduced {
+    Reduced(T value, bool done = false) : value(std::move(value)), done(done) {}
+    T value;
+    bool done;
+};
+
+// Final value of the fold, no more elements will be passed to step function
+template <typename T>
+inline auto reduced(T&& x) {
+    return Reduced<std::remove_cvref_t<T>>(std::forward<T>(x), true);
+}
+
+namespace detail {
+template <typename T>
+struct IsReduced : std::false_type {};
+template <typename T>
+struct IsReduced<Reduced<T>> : std::true_type {};
+
+// clang-format off
+template <typename Func, typename Result, typename T>
+concept ReducingStep = requires(Func func, Result result, T x) {
+    requires IsReduced<std::remove_cvref_t<decltype(func(std::move(result), std::forward<T>(x)))>>::value;
+};
+// clang-format on
+
+// Applies step function to accumulator in place, returns true if fold should be stopped
+template <typename Result, typename Func, typename T>
+inline bool applyFoldStep(Result& result, Func&& func, T&& x) {
+    if constexpr (ReducingStep<Func&, Result, T&&>) {
+        auto step = func(std::move(result), std::forward<T>(x));
+        result = std::move(step.value);
+        return step.done;
+    } else {
+        result = func(std::move(result), std::forward<T>(x));
+        return false;
+    }
+}
+} // namespace detail
+} // namespace cefal
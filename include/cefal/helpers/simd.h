@@ -0,0 +1,247 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include "cefal/detail/std_concepts.h"
+
+#include "cefal/helpers/nums.h"
+
+#include <algorithm>
+#include <concepts>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+#if __has_include(<experimental/simd>)
+#include <experimental/simd>
+#endif
+
+namespace cefal {
+#if __has_include(<experimental/simd>)
+// Batch of elements that mapSimd() and filterSimd() functions work with, as wide as target supports for T
+template <typename T>
+using Simd = std::experimental::native_simd<T>;
+#else
+// Without Parallelism TS batch is a single element, so batch functions are called element by element
+template <typename T>
+using Simd = T;
+#endif
+
+namespace detail {
+// clang-format off
+template <typename T>
+concept SimdArithmetic = Arithmetic<T> && (!std::same_as<T, bool>);
+
+template <typename C>
+concept SimdContainer = RandomAccessContainer<C> && std::contiguous_iterator<typename C::iterator>
+                        && SimdArithmetic<InnerType_T<C>>;
+// clang-format on
+
+#if __has_include(<experimental/simd>)
+template <typename X>
+inline constexpr bool isSimd = std::experimental::is_simd_v<X>;
+template <typename X>
+inline constexpr bool isSimdMask = std::experimental::is_simd_mask_v<X>;
+
+template <typename X>
+auto firstLane(const X& batch) {
+    return batch[0];
+}
+
+// Value type of batches returned by func, they should have same number of lanes as Simd<T>
+template <typename T, typename Func>
+struct SimdMapResult {
+    using Batch = std::invoke_result_t<Func&, Simd<T>>;
+    static_assert(std::experimental::is_simd_v<Batch> && Batch::size() == Simd<T>::size(),
+                  "cefal::ops::mapSimd function should return simd with the same number of lanes");
+    using type = typename Batch::value_type;
+};
+
+template <typename T, typename Func>
+using SimdMapResult_T = typename SimdMapResult<T, Func>::type;
+
+// Last batch is padded with copies of last element, so func always gets full batch and padding can't produce
+// anything it wouldn't produce for real elements (i.e. division by zero)
+template <typename T>
+Simd<T> loadSimdTail(const T* src, size_t size) {
+    T tail[Simd<T>::size()];
+    std::copy(src, src + size, tail);
+    std::fill(tail + size, tail + Simd<T>::size(), src[size - 1]);
+    return Simd<T>(tail, std::experimental::element_aligned);
+}
+
+// Maps size elements from src to dest batch by batch. Each batch is loaded before it is stored, so dest can be src.
+template <typename T, typename U, typename Func>
+void simdMapInto(const T* src, U* dest, size_t size, Func& func) {
+    constexpr size_t lanes = Simd<T>::size();
+    size_t i = 0;
+    for (; i + lanes <= size; i += lanes)
+        func(Simd<T>(src + i, std::experimental::element_aligned)).copy_to(dest + i, std::experimental::element_aligned);
+    if (i == size)
+        return;
+    U tail[lanes];
+    func(loadSimdTail(src + i, size - i)).copy_to(tail, std::experimental::element_aligned);
+    std::copy(tail, tail + (size - i), dest + i);
+}
+
+// Copies accepted elements from src to dest keeping their order and returns their count.
+// Write position never passes read position, so dest can be src.
+template <typename T, typename Func>
+size_t simdFilterInto(const T* src, T* dest, size_t size, Func& func) {
+    constexpr size_t lanes = Simd<T>::size();
+    size_t count = 0;
+    auto compact = [dest, &count](const Simd<T>& batch, const auto& accepted, size_t batchSize) {
+        for (size_t j = 0; j < batchSize; ++j) {
+            dest[count] = batch[j];
+            count += accepted[j];
+        }
+    };
+    size_t i = 0;
+    for (; i + lanes <= size; i += lanes) {
+        Simd<T> batch(src + i, std::experimental::element_aligned);
+        auto accepted = func(batch);
+        if (std::experimental::all_of(accepted)) {
+            batch.copy_to(dest + count, std::experimental::element_aligned);
+            count += lanes;
+        } else if (std::experimental::any_of(accepted)) {
+            compact(batch, accepted, lanes);
+        }
+    }
+    if (i < size) {
+        Simd<T> batch = loadSimdTail(src + i, size - i);
+        compact(batch, func(batch), size - i);
+    }
+    return count;
+}
+
+// Writes indices of accepted elements to dest in ascending order and returns their count
+template <typename T, typename Func>
+size_t simdSelectInto(const T* src, size_t* dest, size_t size, Func& func) {
+    constexpr size_t lanes = Simd<T>::size();
+    size_t count = 0;
+    auto compact = [dest, &count](size_t offset, const auto& accepted, size_t batchSize) {
+        for (size_t j = 0; j < batchSize; ++j) {
+            dest[count] = offset + j;
+            count += accepted[j];
+        }
+    };
+    size_t i = 0;
+    for (; i + lanes <= size; i += lanes) {
+        auto accepted = func(Simd<T>(src + i, std::experimental::element_aligned));
+        if (std::experimental::all_of(accepted)) {
+            for (size_t j = 0; j < lanes; ++j)
+                dest[count + j] = i + j;
+            count += lanes;
+        } else if (std::experimental::any_of(accepted)) {
+            compact(i, accepted, lanes);
+        }
+    }
+    if (i < size)
+        compact(i, func(loadSimdTail(src + i, size - i)), size - i);
+    return count;
+}
+
+#else
+template <typename X>
+inline constexpr bool isSimd = false;
+template <typename X>
+inline constexpr bool isSimdMask = std::is_same_v<X, bool>;
+
+template <typename X>
+X firstLane(const X& batch) {
+    return batch;
+}
+
+template <typename T, typename Func>
+struct SimdMapResult {
+    using type = std::remove_cvref_t<std::invoke_result_t<Func&, const T&>>;
+};
+
+template <typename T, typename Func>
+using SimdMapResult_T = typename SimdMapResult<T, Func>::type;
+
+template <typename T, typename U, typename Func>
+void simdMapInto(const T* src, U* dest, size_t size, Func& func) {
+    for (size_t i = 0; i < size; ++i)
+        dest[i] = func(src[i]);
+}
+
+template <typename T, typename Func>
+size_t simdFilterInto(const T* src, T* dest, size_t size, Func& func) {
+    size_t count = 0;
+    for (size_t i = 0; i < size; ++i) {
+        dest[count] = src[i];
+        count += static_cast<bool>(func(src[i]));
+    }
+    return count;
+}
+
+template <typename T, typename Func>
+size_t simdSelectInto(const T* src, size_t* dest, size_t size, Func& func) {
+    size_t count = 0;
+    for (size_t i = 0; i < size; ++i) {
+        dest[count] = i;
+        count += static_cast<bool>(func(src[i]));
+    }
+    return count;
+}
+#endif
+
+// New destinations are filled through small buffer instead of being resized upfront,
+// so their memory is written once instead of being zeroed first
+inline constexpr size_t simdBufferSize = 1024;
+
+template <typename Dest, typename T, typename Func>
+void simdMapAppend(Dest& dest, const T* src, size_t size, Func& func) {
+    NakedInnerType_T<Dest> buffer[simdBufferSize];
+    for (size_t begin = 0; begin < size; begin += simdBufferSize) {
+        const size_t count = std::min(simdBufferSize, size - begin);
+        simdMapInto(src + begin, buffer, count, func);
+        dest.insert(dest.end(), buffer, buffer + count);
+    }
+}
+
+template <typename Dest, typename T, typename Func>
+void simdFilterAppend(Dest& dest, const T* src, size_t size, Func& func) {
+    T buffer[simdBufferSize];
+    for (size_t begin = 0; begin < size; begin += simdBufferSize) {
+        const size_t count = simdFilterInto(src + begin, buffer, std::min(simdBufferSize, size - begin), func);
+        dest.insert(dest.end(), buffer, buffer + count);
+    }
+}
+
+template <typename T, typename Func>
+void simdSelectAppend(std::vector<size_t>& dest, const T* src, size_t size, Func& func) {
+    size_t buffer[simdBufferSize];
+    for (size_t begin = 0; begin < size; begin += simdBufferSize) {
+        const size_t count = simdSelectInto(src + begin, buffer, std::min(simdBufferSize, size - begin), func);
+        for (size_t i = 0; i < count; ++i)
+            buffer[i] += begin;
+        dest.insert(dest.end(), buffer, buffer + count);
+    }
+}
+} // namespace detail
+} // namespace cefal
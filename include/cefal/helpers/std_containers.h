@@ -27,62 +27,144 @@
 
 #include "cefal/detail/common_concepts.h"
 
+#include <deque>
+#include <functional>
+#include <list>
 #include <map>
+#include <memory>
+#include <set>
+#include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
+#include <vector>
 
 namespace cefal {
-template <typename K, typename V>
-struct InnerType<std::map<K, V>> {
+namespace detail {
+// Functors templated on old element type (std::less<T>, std::hash<T>, etc.) are rebound to new element type.
+// Other functors are carried over as is while they accept new element type, Default is used otherwise.
+template <typename F, typename T, typename NewT>
+struct RebindFunctor {
+    using type = F;
+};
+template <template <typename...> typename F, typename T, typename NewT>
+struct RebindFunctor<F<T>, T, NewT> {
+    using type = F<NewT>;
+};
+template <typename F, typename T, typename NewT, typename Default, typename... Args>
+using RebindFunctor_T = std::conditional_t<std::is_invocable_v<const typename RebindFunctor<F, T, NewT>::type&, const Args&...>,
+                                           typename RebindFunctor<F, T, NewT>::type, Default>;
+
+template <typename Compare, typename T, typename NewT>
+using RebindCompare_T = RebindFunctor_T<Compare, T, NewT, std::less<NewT>, NewT, NewT>;
+template <typename Hash, typename T, typename NewT>
+using RebindHash_T = RebindFunctor_T<Hash, T, NewT, std::hash<NewT>, NewT>;
+template <typename KeyEqual, typename T, typename NewT>
+using RebindKeyEqual_T = RebindFunctor_T<KeyEqual, T, NewT, std::equal_to<NewT>, NewT, NewT>;
+
+template <typename Allocator, typename NewT>
+using RebindAllocator_T = typename std::allocator_traits<Allocator>::template rebind_alloc<NewT>;
+} // namespace detail
+
+template <typename K, typename V, typename Compare, typename Allocator>
+struct InnerType<std::map<K, V, Compare, Allocator>> {
     using type = std::pair<K, V>;
 };
 
-template <typename K, typename V>
-struct InnerType<std::unordered_map<K, V>> {
+template <typename K, typename V, typename Hash, typename KeyEqual, typename Allocator>
+struct InnerType<std::unordered_map<K, V, Hash, KeyEqual, Allocator>> {
     using type = std::pair<K, V>;
 };
 
-template <typename K, typename V>
-struct InnerType<std::multimap<K, V>> {
+template <typename K, typename V, typename Compare, typename Allocator>
+struct InnerType<std::multimap<K, V, Compare, Allocator>> {
     using type = std::pair<K, V>;
 };
 
-template <typename K, typename V>
-struct InnerType<std::unordered_multimap<K, V>> {
+template <typename K, typename V, typename Hash, typename KeyEqual, typename Allocator>
+struct InnerType<std::unordered_multimap<K, V, Hash, KeyEqual, Allocator>> {
     using type = std::pair<K, V>;
 };
 
-template <typename K, typename V, typename NewK, typename NewV>
-struct WithInnerType<std::map<K, V>, std::tuple<NewK, NewV>> {
-    using type = std::map<std::remove_cvref_t<NewK>, std::remove_cvref_t<NewV>>;
+// Allocator, comparator and hasher are carried over to the result, rebound to the new inner type
+template <typename T, typename Allocator, typename NewT>
+struct WithInnerType<std::vector<T, Allocator>, NewT> {
+    using type = std::vector<NewT, detail::RebindAllocator_T<Allocator, NewT>>;
 };
-template <typename K, typename V, typename NewK, typename NewV>
-struct WithInnerType<std::unordered_map<K, V>, std::tuple<NewK, NewV>> {
-    using type = std::unordered_map<std::remove_cvref_t<NewK>, std::remove_cvref_t<NewV>>;
+template <typename T, typename Allocator, typename NewT>
+struct WithInnerType<std::deque<T, Allocator>, NewT> {
+    using type = std::deque<NewT, detail::RebindAllocator_T<Allocator, NewT>>;
 };
-template <typename K, typename V, typename NewK, typename NewV>
-struct WithInnerType<std::multimap<K, V>, std::tuple<NewK, NewV>> {
-    using type = std::multimap<std::remove_cvref_t<NewK>, std::remove_cvref_t<NewV>>;
+template <typename T, typename Allocator, typename NewT>
+struct WithInnerType<std::list<T, Allocator>, NewT> {
+    using type = std::list<NewT, detail::RebindAllocator_T<Allocator, NewT>>;
 };
-template <typename K, typename V, typename NewK, typename NewV>
-struct WithInnerType<std::unordered_multimap<K, V>, std::tuple<NewK, NewV>> {
-    using type = std::unordered_multimap<std::remove_cvref_t<NewK>, std::remove_cvref_t<NewV>>;
+template <typename T, typename Compare, typename Allocator, typename NewT>
+struct WithInnerType<std::set<T, Compare, Allocator>, NewT> {
+    using type = std::set<NewT, detail::RebindCompare_T<Compare, T, NewT>, detail::RebindAllocator_T<Allocator, NewT>>;
 };
-
-template <typename K, typename V, typename NewK, typename NewV>
-struct WithInnerType<std::map<K, V>, std::pair<NewK, NewV>> {
-    using type = std::map<std::remove_cvref_t<NewK>, std::remove_cvref_t<NewV>>;
+template <typename T, typename Compare, typename Allocator, typename NewT>
+struct WithInnerType<std::multiset<T, Compare, Allocator>, NewT> {
+    using type = std::multiset<NewT, detail::RebindCompare_T<Compare, T, NewT>, detail::RebindAllocator_T<Allocator, NewT>>;
 };
-template <typename K, typename V, typename NewK, typename NewV>
-struct WithInnerType<std::unordered_map<K, V>, std::pair<NewK, NewV>> {
-    using type = std::unordered_map<std::remove_cvref_t<NewK>, std::remove_cvref_t<NewV>>;
+template <typename T, typename Hash, typename KeyEqual, typename Allocator, typename NewT>
+struct WithInnerType<std::unordered_set<T, Hash, KeyEqual, Allocator>, NewT> {
+    using type = std::unordered_set<NewT, detail::RebindHash_T<Hash, T, NewT>, detail::RebindKeyEqual_T<KeyEqual, T, NewT>,
+                                    detail::RebindAllocator_T<Allocator, NewT>>;
 };
-template <typename K, typename V, typename NewK, typename NewV>
-struct WithInnerType<std::multimap<K, V>, std::pair<NewK, NewV>> {
-    using type = std::multimap<std::remove_cvref_t<NewK>, std::remove_cvref_t<NewV>>;
+template <typename T, typename Hash, typename KeyEqual, typename Allocator, typename NewT>
+struct WithInnerType<std::unordered_multiset<T, Hash, KeyEqual, Allocator>, NewT> {
+    using type = std::unordered_multiset<NewT, detail::RebindHash_T<Hash, T, NewT>, detail::RebindKeyEqual_T<KeyEqual, T, NewT>,
+                                         detail::RebindAllocator_T<Allocator, NewT>>;
+};
+
+namespace detail {
+template <template <typename...> typename C, typename K, typename Compare, typename Allocator, typename NewK, typename NewV>
+struct WithOrderedMapInnerType {
+    using KeyType = std::remove_cvref_t<NewK>;
+    using ValueType = std::remove_cvref_t<NewV>;
+    using type = C<KeyType, ValueType, RebindCompare_T<Compare, K, KeyType>,
+                   RebindAllocator_T<Allocator, std::pair<const KeyType, ValueType>>>;
 };
-template <typename K, typename V, typename NewK, typename NewV>
-struct WithInnerType<std::unordered_multimap<K, V>, std::pair<NewK, NewV>> {
-    using type = std::unordered_multimap<std::remove_cvref_t<NewK>, std::remove_cvref_t<NewV>>;
+template <template <typename...> typename C, typename K, typename Hash, typename KeyEqual, typename Allocator, typename NewK,
+          typename NewV>
+struct WithUnorderedMapInnerType {
+    using KeyType = std::remove_cvref_t<NewK>;
+    using ValueType = std::remove_cvref_t<NewV>;
+    using type = C<KeyType, ValueType, RebindHash_T<Hash, K, KeyType>, RebindKeyEqual_T<KeyEqual, K, KeyType>,
+                   RebindAllocator_T<Allocator, std::pair<const KeyType, ValueType>>>;
 };
+} // namespace detail
+
+template <typename K, typename V, typename Compare, typename Allocator, typename NewK, typename NewV>
+struct WithInnerType<std::map<K, V, Compare, Allocator>, std::tuple<NewK, NewV>>
+    : detail::WithOrderedMapInnerType<std::map, K, Compare, Allocator, NewK, NewV> {};
+
+template <typename K, typename V, typename Hash, typename KeyEqual, typename Allocator, typename NewK, typename NewV>
+struct WithInnerType<std::unordered_map<K, V, Hash, KeyEqual, Allocator>, std::tuple<NewK, NewV>>
+    : detail::WithUnorderedMapInnerType<std::unordered_map, K, Hash, KeyEqual, Allocator, NewK, NewV> {};
+
+template <typename K, typename V, typename Compare, typename Allocator, typename NewK, typename NewV>
+struct WithInnerType<std::multimap<K, V, Compare, Allocator>, std::tuple<NewK, NewV>>
+    : detail::WithOrderedMapInnerType<std::multimap, K, Compare, Allocator, NewK, NewV> {};
+
+template <typename K, typename V, typename Hash, typename KeyEqual, typename Allocator, typename NewK, typename NewV>
+struct WithInnerType<std::unordered_multimap<K, V, Hash, KeyEqual, Allocator>, std::tuple<NewK, NewV>>
+    : detail::WithUnorderedMapInnerType<std::unordered_multimap, K, Hash, KeyEqual, Allocator, NewK, NewV> {};
+
+template <typename K, typename V, typename Compare, typename Allocator, typename NewK, typename NewV>
+struct WithInnerType<std::map<K, V, Compare, Allocator>, std::pair<NewK, NewV>>
+    : detail::WithOrderedMapInnerType<std::map, K, Compare, Allocator, NewK, NewV> {};
+
+template <typename K, typename V, typename Hash, typename KeyEqual, typename Allocator, typename NewK, typename NewV>
+struct WithInnerType<std::unordered_map<K, V, Hash, KeyEqual, Allocator>, std::pair<NewK, NewV>>
+    : detail::WithUnorderedMapInnerType<std::unordered_map, K, Hash, KeyEqual, Allocator, NewK, NewV> {};
+
+template <typename K, typename V, typename Compare, typename Allocator, typename NewK, typename NewV>
+struct WithInnerType<std::multimap<K, V, Compare, Allocator>, std::pair<NewK, NewV>>
+    : detail::WithOrderedMapInnerType<std::multimap, K, Compare, Allocator, NewK, NewV> {};
+
+template <typename K, typename V, typename Hash, typename KeyEqual, typename Allocator, typename NewK, typename NewV>
+struct WithInnerType<std::unordered_multimap<K, V, Hash, KeyEqual, Allocator>, std::pair<NewK, NewV>>
+    : detail::WithUnorderedMapInnerType<std::unordered_multimap, K, Hash, KeyEqual, Allocator, NewK, NewV> {};
 } // namespace cefal
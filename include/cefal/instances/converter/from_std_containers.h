@@ -25,6 +25,8 @@
 
 #pragma once
 
+#include "cefal/detail/destination.h"
+#include "cefal/detail/parallel_associative.h"
 #include "cefal/detail/std_concepts.h"
 
 #include "cefal/common.h"
@@ -34,6 +36,7 @@
 #include <numeric>
 #include <ranges>
 #include <type_traits>
+#include <vector>
 
 namespace cefal::instances {
 namespace detail {
@@ -49,7 +52,7 @@ void prepareConvertFromRangeDestination(const Src& src, Dest& dest) {
 
 template <cefal::detail::StdContainer Dest, typename Src>
 Dest createConvertFromRangeDestination(const Src& src) {
-    Dest dest;
+    Dest dest = cefal::detail::createDestination<Dest>(src);
     prepareConvertFromRangeDestination(src, dest);
     return dest;
 }
@@ -106,8 +109,13 @@ struct Converter<Src, Dest> {
         return dest;
     }
 
+    // Maps without node handles (e.g. PersistentMap) are converted as lvalues
     template <typename = void>
-    requires cefal::detail::DoubleSocketedStdContainer<Src> static auto convert(Src&& src) {
+    // clang-format off
+    requires cefal::detail::DoubleSocketedStdContainer<Src>
+             && (cefal::detail::OrderedAssociativeContainer<Src> || cefal::detail::UnorderedAssociativeContainer<Src>)
+        // clang-format on
+        static auto convert(Src&& src) {
         using InnerT = std::ranges::range_value_t<Src>;
         using KeyT = std::remove_cvref_t<std::tuple_element_t<0, InnerT>>;
         Dest dest = detail::createConvertFromRangeDestination<Dest>(src);
@@ -131,6 +139,25 @@ struct Converter<Src, Dest> {
             detail::addToConvertFromRangeDestination(dest, x);
         return dest;
     }
+
+    // Random access source is sorted or partitioned by hash in parallel to build associative destination in bulk.
+    // Rvalue source is used as a buffer itself, lvalue one is copied first.
+    template <typename Input>
+    // clang-format off
+    requires std::same_as<std::remove_cvref_t<Input>, Src> && cefal::detail::RandomAccessContainer<Src>
+             && (cefal::detail::OrderedAssociativeContainer<Dest> || cefal::detail::UnorderedAssociativeContainer<Dest>)
+        // clang-format on
+        static Dest convert(Input&& src, Parallel) {
+        size_t chunksCount = cefal::detail::parallelChunksCount(src.size());
+        if (chunksCount < 2)
+            return convert(std::forward<Input>(src));
+        auto dest = cefal::detail::createParallelDestination<Dest>(src);
+        if constexpr (std::is_lvalue_reference_v<Input>)
+            return cefal::detail::buildAssociative(std::move(dest), std::vector<typename Src::value_type>(src.begin(), src.end()),
+                                                   chunksCount);
+        else
+            return cefal::detail::buildAssociative(std::move(dest), std::move(src), chunksCount);
+    }
 };
 
 } // namespace cefal::instances
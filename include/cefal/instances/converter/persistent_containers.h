@@ -0,0 +1,102 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include "cefal/containers/persistent_map.h"
+#include "cefal/containers/persistent_set.h"
+#include "cefal/containers/persistent_vector.h"
+
+#include "cefal/common.h"
+#include "cefal/converter.h"
+
+#include <concepts>
+#include <ranges>
+#include <tuple>
+#include <utility>
+
+namespace cefal::instances {
+// Conversion from PersistentVector to std containers is covered by generic conversion from ranges
+template <std::ranges::range Src, typename T>
+// clang-format off
+requires (!std::same_as<Src, PersistentVector<T>>)
+    // clang-format on
+    struct Converter<Src, PersistentVector<T>> {
+    static PersistentVector<T> convert(const Src& src) {
+        PersistentVector<T> dest;
+        for (const auto& x : src)
+            dest.push_back(x);
+        return dest;
+    }
+
+    static PersistentVector<T> convert(Src&& src) {
+        PersistentVector<T> dest;
+        for (auto&& x : src)
+            dest.push_back(std::move(x));
+        return dest;
+    }
+};
+
+template <std::ranges::range Src, typename T, typename Hash, typename KeyEqual>
+// clang-format off
+requires (!std::same_as<Src, PersistentSet<T, Hash, KeyEqual>>)
+    // clang-format on
+    struct Converter<Src, PersistentSet<T, Hash, KeyEqual>> {
+    static PersistentSet<T, Hash, KeyEqual> convert(const Src& src) {
+        PersistentSet<T, Hash, KeyEqual> dest;
+        for (const auto& x : src)
+            dest.insert(x);
+        return dest;
+    }
+
+    static PersistentSet<T, Hash, KeyEqual> convert(Src&& src) {
+        PersistentSet<T, Hash, KeyEqual> dest;
+        for (auto&& x : src)
+            dest.insert(std::move(x));
+        return dest;
+    }
+};
+
+// Source elements can be either pairs or tuples, as for std maps
+template <std::ranges::range Src, typename K, typename V, typename Hash, typename KeyEqual>
+// clang-format off
+requires (!std::same_as<Src, PersistentMap<K, V, Hash, KeyEqual>>)
+    // clang-format on
+    struct Converter<Src, PersistentMap<K, V, Hash, KeyEqual>> {
+    static PersistentMap<K, V, Hash, KeyEqual> convert(const Src& src) {
+        PersistentMap<K, V, Hash, KeyEqual> dest;
+        for (const auto& x : src)
+            dest.insert(std::pair<K, V>(std::get<0>(x), std::get<1>(x)));
+        return dest;
+    }
+
+    static PersistentMap<K, V, Hash, KeyEqual> convert(Src&& src) {
+        PersistentMap<K, V, Hash, KeyEqual> dest;
+        for (auto&& x : src)
+            dest.insert(std::pair<K, V>(std::get<0>(std::move(x)), std::get<1>(std::move(x))));
+        return dest;
+    }
+};
+} // namespace cefal::instances
@@ -25,7 +25,9 @@
 
 #pragma once
 
+#include "cefal/detail/destination.h"
 #include "cefal/detail/std_concepts.h"
+#include "cefal/detail/thread_pool.h"
 
 #include "cefal/common.h"
 #include "cefal/filterable.h"
@@ -34,22 +36,29 @@
 #include "cefal/monoid.h"
 
 #include <algorithm>
+#include <memory>
+#include <numeric>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace cefal::instances {
 namespace detail {
-template <cefal::detail::Reservable C>
-void prepareFilterDestination(const C& src, C& dest) {
+inline constexpr size_t selectBufferSize = 1024;
+
+// Source size is an upper bound for destination, finalizeFilterDestination() gives unused space back
+template <typename Src, typename Dest>
+requires cefal::detail::TransferableSize<Src, Dest> void prepareFilterDestination(const Src& src, Dest& dest) {
     dest.reserve(src.size());
 }
 
-template <typename C>
-void prepareFilterDestination(const C& src, C& dest) {
+template <typename Src, typename Dest>
+void prepareFilterDestination(const Src& src, Dest& dest) {
 }
 
-template <concepts::Monoid C>
-C createFilterDestination(const C& src) {
-    auto dest = ops::empty<C>();
+template <concepts::Monoid Dest, typename Src>
+Dest createFilterDestination(const Src& src) {
+    auto dest = cefal::detail::createDestination<Dest>(src);
     prepareFilterDestination(src, dest);
     return dest;
 }
@@ -59,9 +68,26 @@ void finalizeFilterDestination(C& dest) {
     dest.shrink_to_fit();
 }
 
+// Buckets reserved for whole source save all rehashes while filling destination.
+// If most of elements were rejected, they are given back with single rehash afterwards.
+template <cefal::detail::UnorderedAssociativeContainer C>
+void finalizeFilterDestination(C& dest) {
+    if (dest.size() < dest.bucket_count() * dest.max_load_factor() / 4)
+        dest.rehash(0);
+}
+
 template <typename C>
 void finalizeFilterDestination(C& dest) {
 }
+
+// Element is passed by const reference, it is converted to T only if predicate can't take it as is
+template <typename T, typename Func, typename U>
+bool acceptedByPredicate(const Func& func, const U& x) {
+    if constexpr (std::is_invocable_v<const Func&, const U&>)
+        return static_cast<bool>(func(x));
+    else
+        return static_cast<bool>(func(static_cast<T>(x)));
+}
 } // namespace detail
 
 template <typename Src>
@@ -80,7 +106,7 @@ public:
     static auto filter(Input&& src, Func&& func) {
         return std::forward<Input>(src)
                | ops::foldLeft(ops::empty<Src>(), [func = std::forward<Func>(func)]<typename T2>(Src&& l, T2&& r) {
-                     if (!func(static_cast<T>(r)))
+                     if (!detail::acceptedByPredicate<T>(func, r))
                          return std::move(l);
                      return std::move(l) | ops::append(ops::unit<Src>(std::forward<T2>(r)));
                  });
@@ -93,11 +119,14 @@ public:
     requires concepts::SingletonEnabledMonoid<Src>
         // clang-format on
         static auto filter(const Src& src, Func&& func) {
-        return src | ops::foldLeft(ops::empty<Src>(), [func = std::forward<Func>(func)](Src&& l, const T& r) {
-                   if (!func(static_cast<T>(r)))
-                       return std::move(l);
-                   return std::move(l) | ops::append(helpers::SingletonFrom<Src>{r});
-               });
+        auto step = [func = std::forward<Func>(func)]<typename T2>(Src&& l, const T2& r) {
+            if (!detail::acceptedByPredicate<T>(func, r))
+                return std::move(l);
+            return std::move(l) | ops::append(helpers::SingletonFrom<Src>{r});
+        };
+        Src dest = src | ops::foldLeft(detail::createFilterDestination<Src>(src), std::move(step));
+        detail::finalizeFilterDestination(dest);
+        return dest;
     }
 
     template <typename Func>
@@ -105,8 +134,9 @@ public:
     requires concepts::SingletonEnabledMonoid<Src>
         // clang-format on
         static auto filter(Src&& src, Func&& func) {
-        return std::move(src) | ops::foldLeft(ops::empty<Src>(), [func = std::forward<Func>(func)](Src&& l, T&& r) {
-                   if (!func(static_cast<T>(r)))
+        auto dest = cefal::detail::createDestination<Src>(src);
+        return std::move(src) | ops::foldLeft(std::move(dest), [func = std::forward<Func>(func)](Src&& l, T&& r) {
+                   if (!detail::acceptedByPredicate<T>(func, r))
                        return std::move(l);
                    return std::move(l) | ops::append(helpers::SingletonFrom<Src>{std::move(r)});
                });
@@ -121,7 +151,7 @@ public:
     requires concepts::SingletonEnabledMonoid<Src> && cefal::detail::VectorLikeContainer<Src>
         // clang-format on
         static auto filter(const Src& src, Func&& func) {
-        Src dest = detail::createFilterDestination(src);
+        Src dest = detail::createFilterDestination<Src>(src);
         for (auto&& x : src) {
             if (func(x))
                 dest.push_back(x);
@@ -149,12 +179,225 @@ public:
         // clang-format on
         static auto filter(Src&& src, Func&& func) {
         for (auto it = src.begin(), end = src.end(); it != end;) {
-            if (func(*it))
+            if (detail::acceptedByPredicate<T>(func, *it))
                 ++it;
             else
                 it = src.erase(it);
         }
+        detail::finalizeFilterDestination(src);
         return std::move(src);
     }
+
+    // Single pass of map and filter: payload of each non-empty result is moved straight into destination
+    template <typename Input, typename Func>
+    // clang-format off
+    requires std::same_as<std::remove_cvref_t<Input>, Src> && concepts::SingletonEnabledMonoid<Src>
+        // clang-format on
+        static auto mapMaybe(Input&& src, Func&& func) {
+        using Dest = WithInnerType_T<Src, std::remove_cvref_t<decltype(*std::declval<std::invoke_result_t<Func, T>>())>>;
+        auto step = [&func]<typename T2>(Dest&& acc, T2&& x) {
+            auto result = func(std::forward<T2>(x));
+            if (!result)
+                return std::move(acc);
+            return std::move(acc) | ops::append(helpers::SingletonFrom<Dest>{std::move(*result)});
+        };
+        Dest dest = std::forward<Input>(src) | ops::foldLeft(detail::createFilterDestination<Dest>(src), std::move(step));
+        detail::finalizeFilterDestination(dest);
+        return dest;
+    }
+
+    // Both parts are filled in the same pass and grow geometrically, so neither of them holds space for the whole source
+    template <typename Func>
+    // clang-format off
+    requires concepts::SingletonEnabledMonoid<Src>
+        // clang-format on
+        static auto partition(const Src& src, Func&& func) {
+        return partitionByFolding(src, func);
+    }
+
+    template <typename Func>
+    // clang-format off
+    requires concepts::SingletonEnabledMonoid<Src>
+        // clang-format on
+        static auto partition(Src&& src, Func&& func) {
+        return partitionByFolding(std::move(src), func);
+    }
+
+    // Accepted elements stay in place, rejected ones are moved to the tail and then to their own container
+    template <typename Func>
+    // clang-format off
+    requires concepts::SingletonEnabledMonoid<Src> && cefal::detail::VectorLikeContainer<Src>
+        // clang-format on
+        static auto partition(Src&& src, Func&& func) {
+        auto rejectedBegin = std::stable_partition(src.begin(), src.end(),
+                                                   [&func](const T& x) { return detail::acceptedByPredicate<T>(func, x); });
+        auto rejected = cefal::detail::createDestination<Src>(src);
+        rejected.insert(rejected.end(), std::make_move_iterator(rejectedBegin), std::make_move_iterator(src.end()));
+        src.erase(rejectedBegin, src.end());
+        return std::make_pair(std::move(src), std::move(rejected));
+    }
+
+    // Rejected nodes are extracted and relinked into their own container, without any element being moved or reallocated
+    template <typename Func>
+    // clang-format off
+    requires concepts::SingletonEnabledMonoid<Src>
+             && (cefal::detail::OrderedAssociativeContainer<Src> || cefal::detail::UnorderedAssociativeContainer<Src>)
+        // clang-format on
+        static auto partition(Src&& src, Func&& func) {
+        auto rejected = cefal::detail::createNodeDestination(src);
+        for (auto it = src.begin(), end = src.end(); it != end;) {
+            auto current = it++;
+            if (!detail::acceptedByPredicate<T>(func, *current))
+                rejected.insert(rejected.end(), src.extract(current));
+        }
+        detail::finalizeFilterDestination(src);
+        return std::make_pair(std::move(src), std::move(rejected));
+    }
+
+    // Accepted lanes of each batch are compacted to destination, rvalue source is compacted in place
+    template <typename Func>
+    // clang-format off
+    requires cefal::detail::SimdContainer<Src>
+        // clang-format on
+        static auto filterSimd(const Src& src, Func&& func) {
+        Src dest = detail::createFilterDestination<Src>(src);
+        cefal::detail::simdFilterAppend(dest, std::to_address(src.begin()), src.size(), func);
+        detail::finalizeFilterDestination(dest);
+        return dest;
+    }
+
+    template <typename Func>
+    // clang-format off
+    requires cefal::detail::SimdContainer<Src>
+        // clang-format on
+        static auto filterSimd(Src&& src, Func&& func) {
+        src.resize(cefal::detail::simdFilterInto(std::to_address(src.begin()), std::to_address(src.begin()), src.size(), func));
+        return std::move(src);
+    }
+
+    // Index is written for each element, but cursor is advanced only for accepted ones, so there is no branch on predicate.
+    // Indices go through small buffer, so selection grows up to accepted count instead of source size
+    template <typename Func>
+    // clang-format off
+    requires cefal::detail::VectorLikeContainer<Src>
+        // clang-format on
+        static Selection select(const Src& src, Func&& func) {
+        Selection selection;
+        size_t buffer[detail::selectBufferSize];
+        size_t count = 0;
+        size_t index = 0;
+        for (const auto& x : src) {
+            buffer[count] = index++;
+            count += detail::acceptedByPredicate<T>(func, x);
+            if (count == detail::selectBufferSize) {
+                selection.insert(selection.end(), buffer, buffer + count);
+                count = 0;
+            }
+        }
+        selection.insert(selection.end(), buffer, buffer + count);
+        detail::finalizeFilterDestination(selection);
+        return selection;
+    }
+
+    template <typename Func>
+    // clang-format off
+    requires cefal::detail::SimdContainer<Src> && cefal::detail::BatchPredicate<std::remove_cvref_t<Func>, T>
+        // clang-format on
+        static Selection select(const Src& src, Func&& func) {
+        Selection selection;
+        cefal::detail::simdSelectAppend(selection, std::to_address(src.begin()), src.size(), func);
+        detail::finalizeFilterDestination(selection);
+        return selection;
+    }
+
+    // Selection size is known, so destination is reserved exactly.
+    // Containers without random access are walked once, that's why selection should be in ascending order.
+    // Indices are not checked, all of them should be less than src.size()
+    template <typename Input>
+    // clang-format off
+    requires std::same_as<std::remove_cvref_t<Input>, Src> && cefal::detail::VectorLikeContainer<Src>
+        // clang-format on
+        static Src gather(Input&& src, const Selection& selection) {
+        Src dest = cefal::detail::createDestination<Src>(src);
+        if constexpr (cefal::detail::Reservable<Src>)
+            dest.reserve(selection.size());
+        auto pick = [&dest](auto& x) {
+            if constexpr (std::is_lvalue_reference_v<Input>)
+                dest.push_back(x);
+            else
+                dest.push_back(std::move(x));
+        };
+        if constexpr (std::random_access_iterator<typename Src::iterator>) {
+            for (size_t index : selection)
+                pick(src.begin()[index]);
+        } else {
+            auto it = src.begin();
+            size_t position = 0;
+            for (size_t index : selection) {
+                std::advance(it, index - position);
+                position = index;
+                pick(*it);
+            }
+        }
+        return dest;
+    }
+
+    // Predicate is called once per element in parallel and results are stored.
+    // Each chunk then knows its own offset in destination (through prefix sum of accepted counts) and can be
+    // copied/moved there in parallel without any synchronization, keeping the order.
+    template <typename Input, typename Func>
+    // clang-format off
+    requires std::same_as<std::remove_cvref_t<Input>, Src> && concepts::SingletonEnabledMonoid<Src>
+             && cefal::detail::RandomAccessContainer<Src>
+        // clang-format on
+        static Src filter(Input&& src, Func&& func, Parallel) {
+        size_t chunksCount = cefal::detail::parallelChunksCount(src.size());
+        if (chunksCount < 2)
+            return filter(std::forward<Input>(src), std::forward<Func>(func));
+
+        std::vector<char> accepted(src.size());
+        std::vector<size_t> offsets(chunksCount + 1, 0);
+        auto markAccepted = [&src, &func, &accepted, &offsets](size_t chunk, size_t begin, size_t end) {
+            size_t count = 0;
+            auto it = src.begin() + begin;
+            for (size_t i = begin; i < end; ++i, ++it) {
+                accepted[i] = static_cast<bool>(func(std::as_const(*it)));
+                count += accepted[i];
+            }
+            offsets[chunk + 1] = count;
+        };
+        cefal::detail::parallelForChunks(src.size(), chunksCount, markAccepted);
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+        auto dest = cefal::detail::createParallelDestination<Src>(src);
+        dest.resize(offsets.back());
+        auto scatterAccepted = [&src, &dest, &accepted, &offsets](size_t chunk, size_t begin, size_t end) {
+            auto from = src.begin() + begin;
+            auto to = dest.begin() + offsets[chunk];
+            for (size_t i = begin; i < end; ++i, ++from) {
+                if (!accepted[i])
+                    continue;
+                if constexpr (std::is_lvalue_reference_v<Input>)
+                    *to = *from;
+                else
+                    *to = std::move(*from);
+                ++to;
+            }
+        };
+        cefal::detail::parallelForChunks(src.size(), chunksCount, scatterAccepted);
+        return dest;
+    }
+
+private:
+    template <typename Input, typename Func>
+    static std::pair<Src, Src> partitionByFolding(Input&& src, const Func& func) {
+        auto step = [&func]<typename T2>(std::pair<Src, Src>&& acc, T2&& x) {
+            Src& part = detail::acceptedByPredicate<T>(func, x) ? acc.first : acc.second;
+            part = std::move(part) | ops::append(helpers::SingletonFrom<Src>{std::forward<T2>(x)});
+            return std::move(acc);
+        };
+        auto init = std::make_pair(cefal::detail::createDestination<Src>(src), cefal::detail::createDestination<Src>(src));
+        return std::forward<Input>(src) | ops::foldLeft(std::move(init), std::move(step));
+    }
 };
 } // namespace cefal::instances
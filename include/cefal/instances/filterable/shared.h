@@ -0,0 +1,87 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include "cefal/containers/shared.h"
+#include "cefal/helpers/shared.h"
+
+#include "cefal/common.h"
+#include "cefal/filterable.h"
+
+#include <type_traits>
+#include <utility>
+
+namespace cefal::instances {
+// Uniquely owned rvalue handle is filtered with rvalue path of underlying container (i.e. erased in place for
+// vector-like ones), shared one gets new container with accepted elements copied
+template <typename C>
+requires concepts::Filterable<C>
+struct Filterable<Shared<C>> {
+    using Src = Shared<C>;
+
+private:
+    using T = InnerType_T<C>;
+
+public:
+    template <typename Input, typename Func, typename Execution = Sequential>
+    // clang-format off
+    requires std::same_as<std::remove_cvref_t<Input>, Src>
+        // clang-format on
+        static Src filter(Input&& src, Func&& func, Execution = Execution()) {
+        return cefal::detail::transformShared<true>(
+            std::forward<Input>(src),
+            [&func]<typename C2>(C2&& container) { return std::forward<C2>(container) | ops::filter(func, Execution()); });
+    }
+
+    template <typename Input, typename Func>
+    // clang-format off
+    requires std::same_as<std::remove_cvref_t<Input>, Src>
+        // clang-format on
+        static auto mapMaybe(Input&& src, Func&& func) {
+        return cefal::detail::transformShared<std::is_invocable_v<Func&, const T&>>(
+            std::forward<Input>(src),
+            [&func]<typename C2>(C2&& container) { return std::forward<C2>(container) | ops::mapMaybe(func); });
+    }
+
+    // Accepted part of uniquely owned handle stays in the same allocation
+    template <typename Input, typename Func>
+    // clang-format off
+    requires std::same_as<std::remove_cvref_t<Input>, Src>
+        // clang-format on
+        static std::pair<Src, Src> partition(Input&& src, Func&& func) {
+        if constexpr (!std::is_lvalue_reference_v<Input>) {
+            if (src.unique()) {
+                C& container = src.mutate();
+                auto [accepted, rejected] = std::move(container) | ops::partition(func);
+                container = std::move(accepted);
+                return std::make_pair(std::move(src), Src(std::move(rejected)));
+            }
+        }
+        auto [accepted, rejected] = src.get() | ops::partition(func);
+        return std::make_pair(Src(std::move(accepted)), Src(std::move(rejected)));
+    }
+};
+} // namespace cefal::instances
@@ -0,0 +1,150 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include "cefal/containers/persistent_map.h"
+#include "cefal/containers/persistent_set.h"
+#include "cefal/containers/persistent_vector.h"
+#include "cefal/detail/arithmetic_fold.h"
+
+#include "cefal/common.h"
+#include "cefal/foldable.h"
+
+#include <type_traits>
+#include <utility>
+
+namespace cefal::instances {
+namespace detail {
+// Entries of each trie node are contiguous, so they are folded the same way as leaves of PersistentVector
+template <typename Src, typename T>
+struct PersistentHashFoldable {
+    template <typename Result, typename Func>
+    static auto foldLeft(const Src& src, Result&& initial, Func&& func) {
+        std::remove_cvref_t<Result> result = std::forward<Result>(initial);
+        auto foldNode = [&result, &func](const T* values, size_t count, bool) {
+            for (size_t i = 0; i < count; ++i) {
+                if (cefal::detail::applyFoldStep(result, func, values[i]))
+                    return true;
+            }
+            return false;
+        };
+        src.forEachNode(foldNode);
+        return result;
+    }
+
+    template <typename Result, typename Func>
+    static auto foldLeft(Src&& src, Result&& initial, Func&& func) {
+        std::remove_cvref_t<Result> result = std::forward<Result>(initial);
+        auto foldNode = [&result, &func](T* values, size_t count, bool unique) {
+            for (size_t i = 0; i < count; ++i) {
+                const bool done = unique ? cefal::detail::applyFoldStep(result, func, std::move(values[i]))
+                                         : cefal::detail::applyFoldStep(result, func, T(values[i]));
+                if (done)
+                    return true;
+            }
+            return false;
+        };
+        src.forEachNode(foldNode);
+        return result;
+    }
+
+    template <concepts::Monoid M, typename Input, typename Func>
+    // clang-format off
+    requires std::same_as<std::remove_cvref_t<Input>, Src> && cefal::detail::ArithmeticMonoid<M>
+    // clang-format on
+    static M foldMap(Input&& src, Func&& func, Sequential) {
+        M result = Monoid<M>::empty();
+        auto mapper = [&func](const T& x) { return static_cast<M>(func(x)); };
+        auto foldNode = [&result, &mapper](const T* values, size_t count, bool) {
+            result = Monoid<M>::append(std::move(result), cefal::detail::arithmeticFold<M>(values, count, mapper));
+            return false;
+        };
+        src.forEachNode(foldNode);
+        return result;
+    }
+};
+} // namespace detail
+
+// Leaves are walked directly instead of looking up each element through the tree
+template <typename T>
+struct Foldable<PersistentVector<T>> {
+    using Src = PersistentVector<T>;
+
+    template <typename Result, typename Func>
+    static auto foldLeft(const Src& src, Result&& initial, Func&& func) {
+        std::remove_cvref_t<Result> result = std::forward<Result>(initial);
+        auto foldLeaf = [&result, &func](const T* values, size_t count, bool) {
+            for (size_t i = 0; i < count; ++i) {
+                if (cefal::detail::applyFoldStep(result, func, values[i]))
+                    return true;
+            }
+            return false;
+        };
+        src.forEachLeaf(foldLeaf);
+        return result;
+    }
+
+    // Elements are moved only from leaves that are not shared with other vectors, others get copied
+    template <typename Result, typename Func>
+    static auto foldLeft(Src&& src, Result&& initial, Func&& func) {
+        std::remove_cvref_t<Result> result = std::forward<Result>(initial);
+        auto foldLeaf = [&result, &func](T* values, size_t count, bool unique) {
+            for (size_t i = 0; i < count; ++i) {
+                const bool done = unique ? cefal::detail::applyFoldStep(result, func, std::move(values[i]))
+                                         : cefal::detail::applyFoldStep(result, func, T(values[i]));
+                if (done)
+                    return true;
+            }
+            return false;
+        };
+        src.forEachLeaf(foldLeaf);
+        return result;
+    }
+
+    // Each leaf is contiguous, so arithmetic monoids are folded with the same kernel as contiguous containers
+    template <concepts::Monoid M, typename Input, typename Func>
+    // clang-format off
+    requires std::same_as<std::remove_cvref_t<Input>, Src> && cefal::detail::ArithmeticMonoid<M>
+    // clang-format on
+    static M foldMap(Input&& src, Func&& func, Sequential) {
+        M result = Monoid<M>::empty();
+        auto mapper = [&func](const T& x) { return static_cast<M>(func(x)); };
+        auto foldLeaf = [&result, &mapper](const T* values, size_t count, bool) {
+            result = Monoid<M>::append(std::move(result), cefal::detail::arithmeticFold<M>(values, count, mapper));
+            return false;
+        };
+        src.forEachLeaf(foldLeaf);
+        return result;
+    }
+};
+
+template <typename T, typename Hash, typename KeyEqual>
+struct Foldable<PersistentSet<T, Hash, KeyEqual>> : detail::PersistentHashFoldable<PersistentSet<T, Hash, KeyEqual>, T> {};
+
+template <typename K, typename V, typename Hash, typename KeyEqual>
+struct Foldable<PersistentMap<K, V, Hash, KeyEqual>>
+    : detail::PersistentHashFoldable<PersistentMap<K, V, Hash, KeyEqual>, std::pair<K, V>> {};
+} // namespace cefal::instances
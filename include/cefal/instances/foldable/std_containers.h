@@ -25,28 +25,45 @@
 
 #pragma once
 
+#include "cefal/detail/arithmetic_fold.h"
 #include "cefal/detail/std_concepts.h"
+#include "cefal/detail/thread_pool.h"
 
 #include "cefal/common.h"
 #include "cefal/foldable.h"
 
+#include <iterator>
+#include <memory>
 #include <numeric>
 #include <type_traits>
+#include <vector>
 
 namespace cefal::instances {
 template <cefal::detail::SingleSocketedStdContainer Src>
 struct Foldable<Src> {
     template <typename Result, typename Func>
     static auto foldLeft(const Src& src, Result&& initial, Func&& func) {
-        return std::accumulate(src.begin(), src.end(), std::forward<Result>(initial), std::forward<Func>(func));
+        using CleanResult = std::remove_cvref_t<Result>;
+        if constexpr (cefal::detail::ReducingStep<Func&, CleanResult, const typename Src::value_type&>) {
+            CleanResult result = std::forward<Result>(initial);
+            for (const auto& x : src) {
+                if (cefal::detail::applyFoldStep(result, func, x))
+                    break;
+            }
+            return result;
+        } else {
+            return std::accumulate(src.begin(), src.end(), std::forward<Result>(initial), std::forward<Func>(func));
+        }
     }
 
     template <typename Result, typename Func>
     static auto foldLeft(Src&& src, Result&& initial, Func&& func) requires cefal::detail::VectorLikeContainer<Src> {
         using CleanResult = std::remove_cvref_t<Result>;
         CleanResult result = std::forward<Result>(initial);
-        for (auto&& x : src)
-            result = func(std::move(result), std::move(x));
+        for (auto&& x : src) {
+            if (cefal::detail::applyFoldStep(result, func, std::move(x)))
+                break;
+        }
         return result;
     }
 
@@ -56,14 +73,85 @@ struct Foldable<Src> {
         using InnerT = typename Src::value_type;
         CleanResult result = std::forward<Result>(initial);
         if constexpr (std::is_trivial_v<InnerT> && sizeof(InnerT) <= 8) {
-            for (auto x : src)
-                result = func(std::move(result), std::move(x));
+            for (auto x : src) {
+                if (cefal::detail::applyFoldStep(result, func, std::move(x)))
+                    break;
+            }
         } else {
-            while (!src.empty())
-                result = func(std::move(result), std::move(src.extract(src.begin()).value()));
+            while (!src.empty()) {
+                if (cefal::detail::applyFoldStep(result, func, std::move(src.extract(src.begin()).value())))
+                    break;
+            }
         }
         return result;
     }
+
+    // Arithmetic monoids don't depend on order of elements, so contiguous storage is folded
+    // with multiple accumulators and pairwise combining instead of one element at a time
+    template <concepts::Monoid M, typename Input, typename Func>
+    // clang-format off
+    requires std::same_as<std::remove_cvref_t<Input>, Src>
+        && cefal::detail::ArithmeticMonoid<M>
+        && std::contiguous_iterator<typename Src::iterator>
+    // clang-format on
+    static M foldMap(Input&& src, Func&& func, Sequential) {
+        auto mapper = arithmeticFoldMapper<M, Input>(func);
+        return cefal::detail::arithmeticFold<M>(std::to_address(src.begin()), src.size(), mapper);
+    }
+
+    // Chunks are folded in parallel and then partial results are combined pairwise (preserving order),
+    // which is valid because Monoid append is associative.
+    template <concepts::Monoid M, typename Input, typename Func>
+    // clang-format off
+    requires std::same_as<std::remove_cvref_t<Input>, Src>
+        && cefal::detail::VectorLikeContainer<Src>
+        && std::random_access_iterator<typename Src::iterator>
+    // clang-format on
+    static M foldMap(Input&& src, Func&& func, Parallel) {
+        auto foldChunk = [&src, &func](size_t begin, size_t end) {
+            if constexpr (cefal::detail::ArithmeticMonoid<M> && std::contiguous_iterator<typename Src::iterator>) {
+                auto mapper = arithmeticFoldMapper<M, Input>(func);
+                return cefal::detail::arithmeticFold<M>(std::to_address(src.begin()) + begin, end - begin, mapper);
+            } else {
+                M result = Monoid<M>::empty();
+                for (auto it = src.begin() + begin, last = src.begin() + end; it != last; ++it) {
+                    if constexpr (std::is_lvalue_reference_v<Input>)
+                        result = Monoid<M>::append(std::move(result), static_cast<M>(func(*it)));
+                    else
+                        result = Monoid<M>::append(std::move(result), static_cast<M>(func(std::move(*it))));
+                }
+                return result;
+            }
+        };
+
+        const size_t size = src.size();
+        const size_t chunksCount = cefal::detail::parallelChunksCount(size);
+        if (chunksCount < 2)
+            return foldChunk(0, size);
+
+        std::vector<M> partials;
+        partials.reserve(chunksCount);
+        for (size_t i = 0; i < chunksCount; ++i)
+            partials.push_back(Monoid<M>::empty());
+        cefal::detail::parallelForChunks(size, chunksCount, [&partials, &foldChunk](size_t chunk, size_t begin, size_t end) {
+            partials[chunk] = foldChunk(begin, end);
+        });
+        cefal::detail::parallelTreeCombine(chunksCount, [&partials](size_t first, size_t middle, size_t) {
+            partials[first] = Monoid<M>::append(std::move(partials[first]), std::move(partials[middle]));
+        });
+        return std::move(partials.front());
+    }
+
+private:
+    template <typename M, typename Input, typename Func>
+    static auto arithmeticFoldMapper(Func& func) {
+        return [&func]<typename T>(T& x) {
+            if constexpr (std::is_lvalue_reference_v<Input>)
+                return static_cast<M>(func(std::as_const(x)));
+            else
+                return static_cast<M>(func(std::move(x)));
+        };
+    }
 };
 
 template <cefal::detail::DoubleSocketedStdContainer Src>
@@ -72,8 +160,10 @@ struct Foldable<Src> {
     static auto foldLeft(const Src& src, Result&& initial, Func&& func) {
         using CleanResult = std::remove_cvref_t<Result>;
         CleanResult result = std::forward<Result>(initial);
-        for (const auto& x : src)
-            result = func(std::move(result), x);
+        for (const auto& x : src) {
+            if (cefal::detail::applyFoldStep(result, func, x))
+                break;
+        }
         return result;
     }
 
@@ -84,12 +174,15 @@ struct Foldable<Src> {
         using KeyT = std::remove_cvref_t<std::tuple_element_t<0, InnerT>>;
         CleanResult result = std::forward<Result>(initial);
         if constexpr (std::is_trivial_v<KeyT> && sizeof(KeyT) <= 8) {
-            for (auto& x : src)
-                result = func(std::move(result), std::make_pair(x.first, std::move(x.second)));
+            for (auto& x : src) {
+                if (cefal::detail::applyFoldStep(result, func, std::make_pair(x.first, std::move(x.second))))
+                    break;
+            }
         } else {
             while (!src.empty()) {
                 auto node = src.extract(src.begin());
-                result = func(std::move(result), std::make_pair(std::move(node.key()), std::move(node.mapped())));
+                if (cefal::detail::applyFoldStep(result, func, std::make_pair(std::move(node.key()), std::move(node.mapped()))))
+                    break;
             }
         }
         return result;
@@ -37,6 +37,23 @@ template <typename T>
 struct FoldableFromFunctionsExists {
     using type = T;
 };
+
+// User defined foldLeft can't be interrupted, so step returning Reduced is wrapped
+// to pass accumulator through untouched once it is done
+template <typename Input, typename Result, typename Func>
+decltype(auto) adaptFoldStep(Func&& func, bool& done) {
+    using InnerT = InnerType_T<std::remove_cvref_t<Input>>;
+    using Element = std::conditional_t<std::is_lvalue_reference_v<Input>, const InnerT&, InnerT&&>;
+    if constexpr (cefal::detail::ReducingStep<Func&, Result, Element>) {
+        return [&func, &done]<typename T>(Result acc, T&& x) -> Result {
+            if (!done)
+                done = cefal::detail::applyFoldStep(acc, func, std::forward<T>(x));
+            return std::move(acc);
+        };
+    } else {
+        return std::forward<Func>(func);
+    }
+}
 } // namespace detail
 template <detail::HasFoldableMethods T>
 struct Foldable<T> {
@@ -45,7 +62,9 @@ struct Foldable<T> {
     requires std::same_as<std::remove_cvref_t<Input>, T>
         // clang-format on
         static std::remove_cvref_t<Result> foldLeft(Input&& src, Result&& initial, Func&& func) {
-        return std::forward<Input>(src).foldLeft(std::forward<Result>(initial), std::forward<Func>(func));
+        bool done = false;
+        auto&& step = detail::adaptFoldStep<Input, std::remove_cvref_t<Result>>(std::forward<Func>(func), done);
+        return std::forward<Input>(src).foldLeft(std::forward<Result>(initial), std::forward<decltype(step)>(step));
     }
 };
 
@@ -56,7 +75,9 @@ struct Foldable<T> {
     requires std::same_as<std::remove_cvref_t<Input>, T>
         // clang-format on
         static std::remove_cvref_t<Result> foldLeft(Input&& src, Result&& initial, Func&& func) {
-        return std::forward<Input>(src).fold_left(std::forward<Result>(initial), std::forward<Func>(func));
+        bool done = false;
+        auto&& step = detail::adaptFoldStep<Input, std::remove_cvref_t<Result>>(std::forward<Func>(func), done);
+        return std::forward<Input>(src).fold_left(std::forward<Result>(initial), std::forward<decltype(step)>(step));
     }
 };
 } // namespace cefal::instances
@@ -25,7 +25,10 @@
 
 #pragma once
 
+#include "cefal/detail/destination.h"
+#include "cefal/detail/parallel_associative.h"
 #include "cefal/detail/std_concepts.h"
+#include "cefal/detail/thread_pool.h"
 
 #include "cefal/common.h"
 #include "cefal/foldable.h"
@@ -34,7 +37,9 @@
 
 #include <algorithm>
 #include <concepts>
+#include <memory>
 #include <type_traits>
+#include <vector>
 
 namespace cefal::instances {
 namespace detail {
@@ -49,7 +54,7 @@ void prepareMapDestination(const Src& src, Dest& dest) {
 
 template <concepts::Monoid Dest, typename Src>
 Dest createMapDestination(const Src& src) {
-    auto dest = ops::empty<Dest>();
+    auto dest = cefal::detail::createDestination<Dest>(src);
     prepareMapDestination(src, dest);
     return dest;
 }
@@ -189,12 +194,14 @@ public:
         }
     }
 
-    template <typename Func, typename Dest = WithInnerType_T<Src, std::invoke_result_t<Func, T>>>
+    template <typename Func>
     // clang-format off
-    requires concepts::SingletonEnabledMonoid<Src> && cefal::detail::SetLikeContainer<Src> && std::same_as<Src, Dest>
+    requires concepts::SingletonEnabledMonoid<Src> && cefal::detail::SetLikeContainer<Src>
+             && std::same_as<Src, WithInnerType_T<Src, std::invoke_result_t<Func, T>>>
         // clang-format on
         static auto map(Src&& src, Func&& func) {
-        auto dest = detail::createMapDestination<Dest>(src);
+        auto dest = cefal::detail::createNodeDestination(src);
+        detail::prepareMapDestination(src, dest);
         while (!src.empty()) {
             auto node = src.extract(src.begin());
             node.value() = func(std::move(node.value()));
@@ -203,12 +210,15 @@ public:
         return dest;
     }
 
-    template <typename Func, typename Dest = WithInnerType_T<Src, std::invoke_result_t<Func, T>>>
+    template <typename Func>
     // clang-format off
-    requires concepts::SingletonEnabledMonoid<Src> && cefal::detail::DoubleSocketedStdContainer<Src> && std::same_as<Src, Dest>
+    requires concepts::SingletonEnabledMonoid<Src> && cefal::detail::DoubleSocketedStdContainer<Src>
+             && (cefal::detail::OrderedAssociativeContainer<Src> || cefal::detail::UnorderedAssociativeContainer<Src>)
+             && std::same_as<Src, WithInnerType_T<Src, std::invoke_result_t<Func, T>>>
         // clang-format on
         static auto map(Src&& src, Func&& func) {
-        auto dest = detail::createMapDestination<Dest>(src);
+        auto dest = cefal::detail::createNodeDestination(src);
+        detail::prepareMapDestination(src, dest);
         while (!src.empty()) {
             auto node = src.extract(src.begin());
             auto result = func(std::make_pair(std::move(node.key()), std::move(node.mapped())));
@@ -218,5 +228,99 @@ public:
         }
         return dest;
     }
+
+    // Batches are loaded straight from source storage, no per element push_back. Rvalue source is overwritten in place
+    template <typename Input, typename Func>
+    // clang-format off
+    requires std::same_as<std::remove_cvref_t<Input>, Src> && cefal::detail::SimdContainer<Src>
+        // clang-format on
+        static auto mapSimd(Input&& src, Func&& func) {
+        using Dest = WithInnerType_T<Src, cefal::detail::SimdMapResult_T<T, Func>>;
+        if constexpr (std::is_same_v<Dest, Src> && !std::is_lvalue_reference_v<Input>) {
+            cefal::detail::simdMapInto(std::to_address(src.begin()), std::to_address(src.begin()), src.size(), func);
+            return std::move(src);
+        } else {
+            auto dest = detail::createMapDestination<Dest>(src);
+            cefal::detail::simdMapAppend(dest, std::to_address(src.begin()), src.size(), func);
+            return dest;
+        }
+    }
+
+    template <typename Input, typename Func, typename Dest = WithInnerType_T<Src, std::invoke_result_t<Func, T>>>
+    // clang-format off
+    requires std::same_as<std::remove_cvref_t<Input>, Src> && concepts::SingletonEnabledMonoid<Src>
+             && cefal::detail::RandomAccessContainer<Src> && cefal::detail::RandomAccessContainer<Dest>
+        // clang-format on
+        static Dest map(Input&& src, Func&& func, Parallel) {
+        size_t chunksCount = cefal::detail::parallelChunksCount(src.size());
+        if (chunksCount < 2)
+            return map(std::forward<Input>(src), std::forward<Func>(func));
+
+        if constexpr (std::is_same_v<Dest, Src> && !std::is_lvalue_reference_v<Input>) {
+            cefal::detail::parallelForChunks(src.size(), chunksCount, [&src, &func](size_t, size_t begin, size_t end) {
+                for (auto from = src.begin() + begin, last = src.begin() + end; from != last; ++from)
+                    *from = func(std::move(*from));
+            });
+            return std::move(src);
+        } else {
+            auto dest = cefal::detail::createParallelDestination<Dest>(src);
+            dest.resize(src.size());
+            cefal::detail::parallelForChunks(src.size(), chunksCount, [&src, &dest, &func](size_t, size_t begin, size_t end) {
+                auto from = src.begin() + begin;
+                auto last = src.begin() + end;
+                for (auto to = dest.begin() + begin; from != last; ++from, ++to) {
+                    if constexpr (std::is_lvalue_reference_v<Input>)
+                        *to = func(*from);
+                    else
+                        *to = func(std::move(*from));
+                }
+            });
+            return dest;
+        }
+    }
+
+    // Results are computed in parallel into a buffer which is then sorted or partitioned by hash in parallel
+    // to build the destination in bulk. Rvalue sources give away their nodes, so values are moved into func.
+    template <typename Input, typename Func, typename Result = std::invoke_result_t<Func, T>,
+              typename Dest = WithInnerType_T<Src, Result>>
+    // clang-format off
+    requires std::same_as<std::remove_cvref_t<Input>, Src> && concepts::SingletonEnabledMonoid<Src>
+             && (cefal::detail::SetLikeContainer<Src> || cefal::detail::DoubleSocketedStdContainer<Src>)
+             && (cefal::detail::OrderedAssociativeContainer<Dest> || cefal::detail::UnorderedAssociativeContainer<Dest>)
+             && std::default_initializable<Result>
+        // clang-format on
+        static Dest map(Input&& src, Func&& func, Parallel) {
+        size_t chunksCount = cefal::detail::parallelChunksCount(src.size());
+        if (chunksCount < 2)
+            return map(std::forward<Input>(src), std::forward<Func>(func));
+
+        auto dest = cefal::detail::createParallelDestination<Dest>(src);
+        std::vector<Result> buffer(src.size());
+        if constexpr (std::is_lvalue_reference_v<Input>) {
+            std::vector<const typename Src::value_type*> values;
+            values.reserve(src.size());
+            for (const auto& x : src)
+                values.push_back(&x);
+            cefal::detail::parallelForChunks(src.size(), chunksCount, [&values, &buffer, &func](size_t, size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i)
+                    buffer[i] = func(*values[i]);
+            });
+        } else {
+            std::vector<typename Src::node_type> nodes;
+            nodes.reserve(src.size());
+            while (!src.empty())
+                nodes.push_back(src.extract(src.begin()));
+            cefal::detail::parallelForChunks(nodes.size(), chunksCount, [&nodes, &buffer, &func](size_t, size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    if constexpr (cefal::detail::DoubleSocketedStdContainer<Src>)
+                        buffer[i] = func(std::make_pair(std::move(nodes[i].key()), std::move(nodes[i].mapped())));
+                    else
+                        buffer[i] = func(std::move(nodes[i].value()));
+                    nodes[i] = typename Src::node_type();
+                }
+            });
+        }
+        return cefal::detail::buildAssociative(std::move(dest), std::move(buffer), chunksCount);
+    }
 };
 } // namespace cefal::instances
@@ -25,15 +25,23 @@
 
 #pragma once
 
+#include "cefal/detail/destination.h"
+#include "cefal/detail/std_concepts.h"
+#include "cefal/detail/thread_pool.h"
+
 #include "cefal/common.h"
 #include "cefal/foldable.h"
 #include "cefal/monad.h"
 #include "cefal/monoid.h"
 
 #include "cefal/instances/functor/from_foldable.h"
+#include "cefal/instances/monoid/std_containers.h"
 
 #include <algorithm>
+#include <iterator>
+#include <numeric>
 #include <type_traits>
+#include <vector>
 
 namespace cefal::instances {
 template <typename Src>
@@ -57,5 +65,78 @@ public:
                      return std::move(l) | ops::append(func(std::forward<T2>(r)));
                  });
     }
+
+    // Results are moved into single accumulator which grows geometrically, so the whole flatMap is amortized linear
+    template <typename Input, typename Func, concepts::Monoid Dest = std::invoke_result_t<Func, T>>
+    // clang-format off
+    requires std::same_as<std::remove_cvref_t<Input>, Src> && cefal::detail::VectorLikeContainer<Dest>
+        // clang-format on
+        static auto flatMap(Input&& src, Func&& func) {
+        static_assert(std::is_same_v<Dest, WithInnerType_T<Src, InnerType_T<Dest>>>, "Function should return same type");
+        return std::forward<Input>(src)
+               | ops::foldLeft(ops::empty<Dest>(), [func = std::forward<Func>(func)]<typename T2>(Dest&& l, T2&& r) {
+                     Dest inner = func(std::forward<T2>(r));
+                     if (l.empty())
+                         return inner;
+                     detail::growContainer(l, l.size() + inner.size());
+                     l.insert(l.end(), std::make_move_iterator(inner.begin()), std::make_move_iterator(inner.end()));
+                     return std::move(l);
+                 });
+    }
+
+    // Each chunk collects its results into a local buffer, then destination is allocated once with the total size
+    // and buffers are moved into it in parallel at offsets given by prefix sums of their sizes.
+    // Elements that can't be default constructed have no place to be moved to, so their buffers are appended
+    // to reserved destination one after another instead.
+    template <typename Input, typename Func, concepts::Monoid Dest = std::invoke_result_t<Func, T>>
+    // clang-format off
+    requires std::same_as<std::remove_cvref_t<Input>, Src>
+             && cefal::detail::VectorLikeContainer<Src> && std::random_access_iterator<typename Src::iterator>
+             && cefal::detail::VectorLikeContainer<Dest> && std::random_access_iterator<typename Dest::iterator>
+        // clang-format on
+        static Dest flatMap(Input&& src, Func&& func, Parallel) {
+        static_assert(std::is_same_v<Dest, WithInnerType_T<Src, InnerType_T<Dest>>>, "Function should return same type");
+        // Every element produces a whole container, so chunks can be smaller than for map
+        size_t chunksCount = cefal::detail::parallelChunksCount(src.size(), 512);
+        if (chunksCount < 2)
+            return flatMap(std::forward<Input>(src), std::forward<Func>(func));
+
+        std::vector<Dest> buffers(chunksCount);
+        cefal::detail::parallelForChunks(src.size(), chunksCount, [&src, &func, &buffers](size_t chunk, size_t begin, size_t end) {
+            Dest& buffer = buffers[chunk];
+            for (auto from = src.begin() + begin, last = src.begin() + end; from != last; ++from) {
+                Dest inner = [&func, &from]() {
+                    if constexpr (std::is_lvalue_reference_v<Input>)
+                        return func(*from);
+                    else
+                        return func(std::move(*from));
+                }();
+                std::move(inner.begin(), inner.end(), std::back_inserter(buffer));
+            }
+        });
+
+        std::vector<size_t> offsets(chunksCount + 1, 0);
+        for (size_t i = 0; i < chunksCount; ++i)
+            offsets[i + 1] = buffers[i].size();
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+        if constexpr (cefal::detail::RandomAccessContainer<Dest>) {
+            auto dest = cefal::detail::createParallelDestination<Dest>(src);
+            dest.resize(offsets.back());
+            cefal::detail::ThreadPool::instance().run(chunksCount, [&buffers, &offsets, &dest](size_t chunk) {
+                std::move(buffers[chunk].begin(), buffers[chunk].end(), dest.begin() + offsets[chunk]);
+                buffers[chunk] = Dest();
+            });
+            return dest;
+        } else {
+            auto dest = cefal::detail::createParallelDestination<Dest>(src);
+            detail::reserveContainer(dest, offsets.back());
+            for (auto& buffer : buffers) {
+                dest.insert(dest.end(), std::make_move_iterator(buffer.begin()), std::make_move_iterator(buffer.end()));
+                buffer = Dest();
+            }
+            return dest;
+        }
+    }
 };
 } // namespace cefal::instances
@@ -56,4 +56,16 @@ struct Monoid<Product<T>> {
     static Product<T> empty() { return static_cast<T>(1); }
     static Product<T> append(Product<T> left, Product<T> right) { return left.value * right.value; }
 };
+
+template <cefal::detail::Arithmetic T>
+struct Monoid<Min<T>> {
+    static Min<T> empty() { return Min<T>(); }
+    static Min<T> append(Min<T> left, Min<T> right) { return right.value < left.value ? right.value : left.value; }
+};
+
+template <cefal::detail::Arithmetic T>
+struct Monoid<Max<T>> {
+    static Max<T> empty() { return Max<T>(); }
+    static Max<T> append(Max<T> left, Max<T> right) { return left.value < right.value ? right.value : left.value; }
+};
 } // namespace cefal::instances
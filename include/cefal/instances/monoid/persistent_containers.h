@@ -0,0 +1,158 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include "cefal/containers/persistent_map.h"
+#include "cefal/containers/persistent_set.h"
+#include "cefal/containers/persistent_vector.h"
+
+#include "cefal/common.h"
+#include "cefal/monoid.h"
+
+#include <type_traits>
+#include <utility>
+
+namespace cefal {
+namespace helpers {
+template <typename T>
+struct SingletonFrom<PersistentVector<T>> {
+    using exists = void;
+    T value;
+};
+
+template <typename T, typename Hash, typename KeyEqual>
+struct SingletonFrom<PersistentSet<T, Hash, KeyEqual>> {
+    using exists = void;
+    T value;
+};
+
+template <typename K, typename V, typename Hash, typename KeyEqual>
+struct SingletonFrom<PersistentMap<K, V, Hash, KeyEqual>> {
+    using exists = void;
+    SingletonFrom(const std::pair<K, V>& x) : key(x.first), value(x.second) {}
+    SingletonFrom(std::pair<K, V>&& x) : key(std::move(x.first)), value(std::move(x.second)) {}
+    K key;
+    V value;
+};
+} // namespace helpers
+
+namespace instances {
+template <typename T>
+struct Monoid<PersistentVector<T>> {
+    using Src = PersistentVector<T>;
+
+    static Src empty() { return Src(); }
+
+    // Small right side is pushed to the rvalue left one in place instead of building new seam
+    template <typename T1, typename T2>
+    static Src append(T1&& left, T2&& right) {
+        static_assert(std::is_same_v<std::remove_cvref_t<T1>, Src>, "Argument type should be the same as monoid");
+        static_assert(std::is_same_v<std::remove_cvref_t<T2>, Src>, "Argument type should be the same as monoid");
+        if constexpr (!std::is_lvalue_reference_v<T1>) {
+            if (right.size() <= cefal::detail::persistentVectorBranching) {
+                Src result = std::move(left);
+                for (const auto& x : right)
+                    result.push_back(x);
+                return result;
+            }
+        }
+        return Src::concat(left, right);
+    }
+
+    template <typename T1>
+    static Src append(T1&& left, helpers::SingletonFrom<Src>&& right) {
+        static_assert(std::is_same_v<std::remove_cvref_t<T1>, Src>, "Argument type should be the same as monoid");
+        Src result = std::forward<T1>(left);
+        result.push_back(std::move(right.value));
+        return result;
+    }
+};
+
+// Smaller side is inserted into the bigger one, so append costs O(m log32 n) for m elements of the smaller side
+// and the rest of trie is shared. Elements of left side win, as in merge of std containers.
+template <typename T, typename Hash, typename KeyEqual>
+struct Monoid<PersistentSet<T, Hash, KeyEqual>> {
+    using Src = PersistentSet<T, Hash, KeyEqual>;
+
+    static Src empty() { return Src(); }
+
+    template <typename T1, typename T2>
+    static Src append(T1&& left, T2&& right) {
+        static_assert(std::is_same_v<std::remove_cvref_t<T1>, Src>, "Argument type should be the same as monoid");
+        static_assert(std::is_same_v<std::remove_cvref_t<T2>, Src>, "Argument type should be the same as monoid");
+        if (left.size() < right.size()) {
+            Src result = std::forward<T2>(right);
+            for (const auto& x : left)
+                result.insert(x);
+            return result;
+        }
+        Src result = std::forward<T1>(left);
+        for (const auto& x : right)
+            result.insert(x);
+        return result;
+    }
+
+    template <typename T1>
+    static Src append(T1&& left, helpers::SingletonFrom<Src>&& right) {
+        static_assert(std::is_same_v<std::remove_cvref_t<T1>, Src>, "Argument type should be the same as monoid");
+        Src result = std::forward<T1>(left);
+        result.insert(std::move(right.value));
+        return result;
+    }
+};
+
+template <typename K, typename V, typename Hash, typename KeyEqual>
+struct Monoid<PersistentMap<K, V, Hash, KeyEqual>> {
+    using Src = PersistentMap<K, V, Hash, KeyEqual>;
+
+    static Src empty() { return Src(); }
+
+    template <typename T1, typename T2>
+    static Src append(T1&& left, T2&& right) {
+        static_assert(std::is_same_v<std::remove_cvref_t<T1>, Src>, "Argument type should be the same as monoid");
+        static_assert(std::is_same_v<std::remove_cvref_t<T2>, Src>, "Argument type should be the same as monoid");
+        if (left.size() < right.size()) {
+            Src result = std::forward<T2>(right);
+            for (const auto& x : left)
+                result.insert_or_assign(x.first, x.second);
+            return result;
+        }
+        Src result = std::forward<T1>(left);
+        for (const auto& x : right)
+            result.insert(x);
+        return result;
+    }
+
+    template <typename T1>
+    static Src append(T1&& left, helpers::SingletonFrom<Src>&& right) {
+        static_assert(std::is_same_v<std::remove_cvref_t<T1>, Src>, "Argument type should be the same as monoid");
+        Src result = std::forward<T1>(left);
+        result.insert(std::make_pair(std::move(right.key), std::move(right.value)));
+        return result;
+    }
+};
+} // namespace instances
+} // namespace cefal
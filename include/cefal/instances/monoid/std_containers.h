@@ -30,6 +30,8 @@
 #include "cefal/common.h"
 #include "cefal/monoid.h"
 
+#include <algorithm>
+#include <iterator>
 #include <type_traits>
 
 namespace cefal {
@@ -59,18 +61,59 @@ void reserveContainer(C& c, size_t size) {
 template <typename C>
 void reserveContainer(C& c, size_t size) {
 }
+
+// Unlike reserveContainer it grows capacity geometrically,
+// so appending to the same container over and over stays amortized linear
+template <cefal::detail::Reservable C>
+void growContainer(C& c, size_t size) {
+    if (size > c.capacity())
+        c.reserve(std::max(size, 2 * c.capacity()));
+}
+// Hashed containers are reserved up to upper bound of resulting size, so merge doesn't rehash on the way
+template <cefal::detail::UnorderedAssociativeContainer C>
+void growContainer(C& c, size_t size) {
+    if (size > c.bucket_count() * c.max_load_factor())
+        c.reserve(std::max(size, 2 * c.size()));
+}
+template <typename C>
+void growContainer(C&, size_t) {
+}
+
+// Nodes of rvalue source are spliced into destination, lvalue source is left intact.
+// Nodes of source with another allocator (i.e. one from ArenaScope) can't be relinked,
+// they are extracted one by one and their values are moved instead
+template <typename C>
+void mergeContainer(C& dest, C&& source) {
+    growContainer(dest, dest.size() + source.size());
+    if (dest.get_allocator() == source.get_allocator()) {
+        dest.merge(std::move(source));
+        return;
+    }
+    while (!source.empty()) {
+        auto node = source.extract(source.begin());
+        if constexpr (cefal::detail::DoubleSocketedStdContainer<C>)
+            dest.emplace(std::move(node.key()), std::move(node.mapped()));
+        else
+            dest.insert(std::move(node.value()));
+    }
+}
+template <typename C>
+void mergeContainer(C& dest, const C& source) {
+    growContainer(dest, dest.size() + source.size());
+    dest.insert(source.begin(), source.end());
+}
 } // namespace detail
 
 template <cefal::detail::VectorLikeContainer Src>
 struct Monoid<Src> {
-    static Src empty() { return Src(); }
+    static Src empty() { return cefal::detail::createInArena<Src>(); }
 
     static Src append(const Src& left, const Src& right) {
         if (!left.size())
-            return right;
+            return cefal::detail::forwardToArena<Src>(right);
         if (!right.size())
-            return left;
-        Src result;
+            return cefal::detail::forwardToArena<Src>(left);
+        Src result = cefal::detail::createInArena<Src>();
         detail::reserveContainer(result, left.size() + right.size());
         result.insert(result.end(), left.begin(), left.end());
         result.insert(result.end(), right.begin(), right.end());
@@ -79,10 +122,10 @@ struct Monoid<Src> {
 
     static Src append(Src&& left, const Src& right) {
         if (!left.size())
-            return right;
+            return cefal::detail::forwardToArena<Src>(right);
         if (!right.size())
             return std::move(left);
-        detail::reserveContainer(left, left.size() + right.size());
+        detail::growContainer(left, left.size() + right.size());
         left.insert(left.end(), right.begin(), right.end());
         return std::move(left);
     }
@@ -91,8 +134,8 @@ struct Monoid<Src> {
         if (!left.size())
             return std::move(right);
         if (!right.size())
-            return left;
-        detail::reserveContainer(right, left.size() + right.size());
+            return cefal::detail::forwardToArena<Src>(left);
+        detail::growContainer(right, left.size() + right.size());
         right.insert(right.begin(), left.begin(), left.end());
         return std::move(right);
     }
@@ -103,12 +146,12 @@ struct Monoid<Src> {
         if (!right.size())
             return std::move(left);
         if (left.size() < right.size()) {
-            detail::reserveContainer(right, left.size() + right.size());
-            right.insert(right.begin(), left.begin(), left.end());
+            detail::growContainer(right, left.size() + right.size());
+            right.insert(right.begin(), std::make_move_iterator(left.begin()), std::make_move_iterator(left.end()));
             return std::move(right);
         } else {
-            detail::reserveContainer(left, left.size() + right.size());
-            left.insert(left.end(), right.begin(), right.end());
+            detail::growContainer(left, left.size() + right.size());
+            left.insert(left.end(), std::make_move_iterator(right.begin()), std::make_move_iterator(right.end()));
             return std::move(left);
         }
     }
@@ -116,7 +159,7 @@ struct Monoid<Src> {
     template <typename T>
     static Src append(T&& left, helpers::SingletonFrom<Src>&& right) {
         static_assert(std::is_same_v<std::remove_cvref_t<T>, Src>, "Argument type should be the same as monoid");
-        Src result = std::forward<T>(left);
+        Src result = cefal::detail::forwardToArena<Src>(std::forward<T>(left));
         result.push_back(std::move(right.value));
         return result;
     }
@@ -124,21 +167,21 @@ struct Monoid<Src> {
 
 template <cefal::detail::SetLikeContainer Src>
 struct Monoid<Src> {
-    static Src empty() { return Src(); }
+    static Src empty() { return cefal::detail::createInArena<Src>(); }
 
     template <typename T1, typename T2>
     static Src append(T1&& left, T2&& right) {
         static_assert(std::is_same_v<std::remove_cvref_t<T1>, Src>, "Argument type should be the same as monoid");
         static_assert(std::is_same_v<std::remove_cvref_t<T2>, Src>, "Argument type should be the same as monoid");
-        Src result = std::forward<T1>(left);
-        result.merge(std::forward<T2>(right));
+        Src result = cefal::detail::forwardToArena<Src>(std::forward<T1>(left));
+        detail::mergeContainer(result, std::forward<T2>(right));
         return result;
     }
 
     template <typename T>
     static Src append(T&& left, helpers::SingletonFrom<Src>&& right) {
         static_assert(std::is_same_v<std::remove_cvref_t<T>, Src>, "Argument type should be the same as monoid");
-        Src result = std::forward<T>(left);
+        Src result = cefal::detail::forwardToArena<Src>(std::forward<T>(left));
         result.insert(std::move(right.value));
         return result;
     }
@@ -146,21 +189,21 @@ struct Monoid<Src> {
 
 template <cefal::detail::DoubleSocketedStdContainer Src>
 struct Monoid<Src> {
-    static Src empty() { return Src(); }
+    static Src empty() { return cefal::detail::createInArena<Src>(); }
 
     template <typename T1, typename T2>
     static Src append(T1&& left, T2&& right) {
         static_assert(std::is_same_v<std::remove_cvref_t<T1>, Src>, "Argument type should be the same as monoid");
         static_assert(std::is_same_v<std::remove_cvref_t<T2>, Src>, "Argument type should be the same as monoid");
-        Src result = std::forward<T1>(left);
-        result.merge(std::forward<T2>(right));
+        Src result = cefal::detail::forwardToArena<Src>(std::forward<T1>(left));
+        detail::mergeContainer(result, std::forward<T2>(right));
         return result;
     }
 
     template <typename T>
     static Src append(T&& left, helpers::SingletonFrom<Src>&& right) {
         static_assert(std::is_same_v<std::remove_cvref_t<T>, Src>, "Argument type should be the same as monoid");
-        Src result = std::forward<T>(left);
+        Src result = cefal::detail::forwardToArena<Src>(std::forward<T>(left));
         result.emplace(std::move(right.key), std::move(right.value));
         return result;
     }
@@ -68,21 +68,34 @@ Functor<T> && requires (CleanT x, std::function<CleanT(InnerT)> converter) {
 } // namespace concepts
 
 namespace ops {
-template <typename Func>
+// With cefal::par results of all chunks are concatenated in source order
+template <typename Func, typename Execution = Sequential>
 struct flatMap {
     flatMap(Func&& func) : func(std::move(func)) {}
     flatMap(const Func& func) : func(func) {}
+    flatMap(Func&& func, Execution) : func(std::move(func)) {}
+    flatMap(const Func& func, Execution) : func(func) {}
 
     template <concepts::Monad M>
     auto operator()(M&& left) && {
-        return instances::Monad<std::remove_cvref_t<M>>::flatMap(std::forward<M>(left), std::move(func));
+        using Instance = instances::Monad<std::remove_cvref_t<M>>;
+        if constexpr (requires { Instance::flatMap(std::forward<M>(left), std::move(func), Execution()); })
+            return Instance::flatMap(std::forward<M>(left), std::move(func), Execution());
+        else
+            return Instance::flatMap(std::forward<M>(left), std::move(func));
     }
     template <concepts::Monad M>
     auto operator()(M&& left) const& {
-        return instances::Monad<std::remove_cvref_t<M>>::flatMap(std::forward<M>(left), func);
+        using Instance = instances::Monad<std::remove_cvref_t<M>>;
+        if constexpr (requires { Instance::flatMap(std::forward<M>(left), func, Execution()); })
+            return Instance::flatMap(std::forward<M>(left), func, Execution());
+        else
+            return Instance::flatMap(std::forward<M>(left), func);
     }
 
 private:
+    template <typename>
+    friend struct detail::FusedStage;
     Func func;
 };
 
@@ -102,6 +115,8 @@ private:
 
 template <typename Func>
 flatMap(Func &&) -> flatMap<std::remove_cvref_t<Func>>;
+template <typename Func, typename Execution>
+flatMap(Func&&, Execution) -> flatMap<std::remove_cvref_t<Func>, Execution>;
 template <typename Func>
 innerFlatMap(Func &&) -> innerFlatMap<std::remove_cvref_t<Func>>;
 
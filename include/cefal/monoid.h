@@ -86,7 +86,7 @@ struct append;
 template <concepts::Monoid M>
 struct append<M> {
     append(M&& right) : right(std::move(right)) {}
-    append(const M& right) : right(right) {}
+    append(const M& right) : right(cefal::detail::forwardToArena<M>(right)) {}
 
     inline auto operator()(M&& left) && { return instances::Monoid<M>::append(std::move(left), std::move(right)); }
     inline auto operator()(const M& left) && { return instances::Monoid<M>::append(left, std::move(right)); }
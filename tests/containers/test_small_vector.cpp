@@ -0,0 +1,214 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include "cefal/containers/small_vector.h"
+
+#include "catch2/catch.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace cefal;
+
+namespace {
+// Long enough to not fit into small string buffer, so dangling references are visible to sanitizers
+std::string longString(int seed) {
+    return "long enough string to be allocated on heap #" + std::to_string(seed);
+}
+
+// Move constructor can throw, so elements are copied on relocation. Copy of negative value throws
+struct ThrowingCopy {
+    inline static int alive = 0;
+
+    ThrowingCopy(int value) : value(longString(value)), negative(value < 0) { ++alive; }
+    ThrowingCopy(const ThrowingCopy& other) : value(other.value), negative(other.negative) {
+        if (negative)
+            throw std::runtime_error("negative");
+        ++alive;
+    }
+    ThrowingCopy(ThrowingCopy&& other) noexcept(false) : ThrowingCopy(std::as_const(other)) {}
+    ~ThrowingCopy() { --alive; }
+
+    std::string value;
+    bool negative;
+};
+
+SmallVector<std::string, 2> longStrings(int count) {
+    SmallVector<std::string, 2> result;
+    for (int i = 0; i < count; ++i)
+        result.push_back(longString(i));
+    return result;
+}
+} // namespace
+
+TEST_CASE("SmallVector - insert() and emplace() in the middle") {
+    SECTION("Inline") {
+        SmallVector<std::string, 4> vector = {"a", "d"};
+        auto it = vector.insert(vector.begin() + 1, "b");
+        CHECK(*it == "b");
+        it = vector.emplace(vector.begin() + 2, 1, 'c');
+        CHECK(*it == "c");
+        CHECK(vector.isInline());
+        CHECK(vector == SmallVector<std::string, 4>{"a", "b", "c", "d"});
+    }
+    SECTION("Growing to heap") {
+        auto vector = longStrings(2);
+        vector.insert(vector.begin() + 1, longString(10));
+        vector.emplace(vector.begin(), longString(11));
+        vector.insert(vector.begin() + 2, 2, longString(12));
+        vector.insert(vector.begin() + 1, {longString(13), longString(14)});
+        CHECK(!vector.isInline());
+        CHECK(vector
+              == SmallVector<std::string, 2>{longString(11), longString(13), longString(14), longString(0), longString(12),
+                                             longString(12), longString(10), longString(1)});
+    }
+}
+
+TEST_CASE("SmallVector - erase() in the middle") {
+    auto vector = longStrings(6);
+    auto it = vector.erase(vector.begin() + 1);
+    CHECK(*it == longString(2));
+    it = vector.erase(vector.begin() + 1, vector.begin() + 3);
+    CHECK(*it == longString(4));
+    CHECK(vector == SmallVector<std::string, 2>{longString(0), longString(4), longString(5)});
+    it = vector.erase(vector.begin() + 1, vector.begin() + 1);
+    CHECK(*it == longString(4));
+    CHECK(vector.size() == 3);
+}
+
+TEST_CASE("SmallVector - shrink_to_fit() goes back to inline storage") {
+    auto vector = longStrings(5);
+    CHECK(!vector.isInline());
+    vector.erase(vector.begin() + 1, vector.end() - 1);
+    CHECK(!vector.isInline());
+    vector.shrink_to_fit();
+    CHECK(vector.isInline());
+    CHECK(vector.capacity() == 2);
+    CHECK(vector == SmallVector<std::string, 2>{longString(0), longString(4)});
+    vector.push_back(longString(5));
+    vector.shrink_to_fit();
+    CHECK(!vector.isInline());
+    CHECK(vector.capacity() == 3);
+}
+
+TEST_CASE("SmallVector - Values referring to own elements") {
+    SECTION("emplace_back() going to heap") {
+        auto vector = longStrings(2);
+        vector.emplace_back(vector[0]);
+        CHECK(vector == SmallVector<std::string, 2>{longString(0), longString(1), longString(0)});
+    }
+    SECTION("emplace_back() growing heap") {
+        auto vector = longStrings(4);
+        vector.push_back(vector[1]);
+        CHECK(vector == SmallVector<std::string, 2>{longString(0), longString(1), longString(2), longString(3), longString(1)});
+    }
+    SECTION("emplace() growing") {
+        auto vector = longStrings(2);
+        vector.emplace(vector.begin(), vector[1]);
+        CHECK(vector == SmallVector<std::string, 2>{longString(1), longString(0), longString(1)});
+    }
+    SECTION("resize() going to heap") {
+        auto vector = longStrings(2);
+        vector.resize(4, vector[0]);
+        CHECK(vector == SmallVector<std::string, 2>{longString(0), longString(1), longString(0), longString(0)});
+    }
+    SECTION("resize() growing heap") {
+        auto vector = longStrings(3);
+        vector.resize(8, vector[2]);
+        CHECK(vector.size() == 8);
+        CHECK(std::count(vector.begin(), vector.end(), longString(2)) == 6);
+    }
+    SECTION("insert() of several copies") {
+        auto vector = longStrings(2);
+        vector.insert(vector.begin() + 1, 3, vector[1]);
+        CHECK(vector == SmallVector<std::string, 2>{longString(0), longString(1), longString(1), longString(1), longString(1)});
+    }
+}
+
+TEST_CASE("SmallVector - Move assignment") {
+    SECTION("Inline to inline") {
+        auto left = longStrings(1);
+        auto right = longStrings(2);
+        left = std::move(right);
+        CHECK(left.isInline());
+        CHECK(left == longStrings(2));
+        CHECK(right.empty());
+    }
+    SECTION("Heap to inline") {
+        auto left = longStrings(1);
+        auto right = longStrings(5);
+        const std::string* data = right.data();
+        left = std::move(right);
+        CHECK(left.data() == data);
+        CHECK(left == longStrings(5));
+        CHECK(right.empty());
+        CHECK(right.isInline());
+    }
+    SECTION("Inline to heap") {
+        auto left = longStrings(5);
+        auto right = longStrings(2);
+        left = std::move(right);
+        CHECK(left == longStrings(2));
+        CHECK(right.empty());
+        left.push_back(longString(2));
+        CHECK(left == longStrings(3));
+    }
+    SECTION("Heap to heap") {
+        auto left = longStrings(3);
+        auto right = longStrings(6);
+        const std::string* data = right.data();
+        left = std::move(right);
+        CHECK(left.data() == data);
+        CHECK(left == longStrings(6));
+        CHECK(right.empty());
+        CHECK(right.isInline());
+        right.push_back(longString(0));
+        CHECK(right == longStrings(1));
+    }
+}
+
+TEST_CASE("SmallVector - Failed relocation on growth") {
+    {
+        SmallVector<ThrowingCopy, 2> vector;
+        vector.emplace_back(1);
+        vector.emplace_back(-1);
+        SECTION("Going to heap") {
+            CHECK_THROWS_AS(vector.emplace_back(3), std::runtime_error);
+            CHECK(vector.isInline());
+        }
+        SECTION("Growing heap") {
+            vector.data()[1].negative = false;
+            vector.emplace_back(3);
+            vector.data()[1].negative = true;
+            vector.emplace_back(4);
+            CHECK_THROWS_AS(vector.emplace_back(5), std::runtime_error);
+            CHECK(vector.size() == 4);
+        }
+        CHECK(ThrowingCopy::alive == int(vector.size()));
+        CHECK(vector.data()[0].value == longString(1));
+    }
+    CHECK(ThrowingCopy::alive == 0);
+}
@@ -0,0 +1,190 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include "cefal/containers/vector.h"
+
+#include "catch2/catch.hpp"
+
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+using namespace cefal;
+
+namespace {
+// Negative values can't be copied, construction from int throws for them too
+struct Throwing {
+    inline static int alive = 0;
+
+    Throwing(int value) : value(value) {
+        if (value < 0)
+            throw std::runtime_error("negative");
+        ++alive;
+    }
+    Throwing(const Throwing& other) : Throwing(other.value) {}
+    ~Throwing() { --alive; }
+    Throwing& operator=(const Throwing&) = default;
+
+    int value;
+    bool operator==(const Throwing&) const = default;
+};
+
+std::vector<std::unique_ptr<int>> pointers(std::initializer_list<int> values) {
+    std::vector<std::unique_ptr<int>> result;
+    for (int x : values)
+        result.push_back(std::make_unique<int>(x));
+    return result;
+}
+
+template <typename Pointers>
+std::vector<int> values(const Pointers& pointers) {
+    std::vector<int> result;
+    for (auto&& x : pointers)
+        result.push_back(*x);
+    return result;
+}
+} // namespace
+
+template <>
+struct cefal::IsTriviallyRelocatable<Throwing> : std::true_type {};
+
+TEST_CASE("Vector - insert() in the middle of trivially relocatable elements") {
+    SECTION("Trivially copyable") {
+        Vector<int> vector = {1, 2, 6};
+        std::vector<int> middle = {3, 4, 5};
+        auto it = vector.insert(vector.begin() + 2, middle.begin(), middle.end());
+        CHECK(it == vector.begin() + 2);
+        CHECK(vector == Vector<int>{1, 2, 3, 4, 5, 6});
+        vector.insert(vector.begin(), {-1, 0});
+        CHECK(vector == Vector<int>{-1, 0, 1, 2, 3, 4, 5, 6});
+        vector.insert(vector.begin() + 1, 2, 42);
+        CHECK(vector == Vector<int>{-1, 42, 42, 0, 1, 2, 3, 4, 5, 6});
+    }
+    SECTION("Owning pointers") {
+        Vector<std::unique_ptr<int>> vector;
+        for (auto&& x : pointers({1, 5}))
+            vector.push_back(std::move(x));
+        auto middle = pointers({2, 3, 4});
+        auto it = vector.insert(vector.begin() + 1, std::make_move_iterator(middle.begin()),
+                                std::make_move_iterator(middle.end()));
+        CHECK(**it == 2);
+        CHECK(values(vector) == std::vector{1, 2, 3, 4, 5});
+    }
+    SECTION("Gap is closed if element throws") {
+        Vector<Throwing> vector = {1, 2, 3};
+        vector.reserve(10);
+        std::vector<Throwing> middle = {10, 20, 30};
+        middle[1].value = -1;
+        CHECK_THROWS_AS(vector.insert(vector.begin() + 1, middle.begin(), middle.end()), std::runtime_error);
+        CHECK(vector == Vector<Throwing>{1, 2, 3});
+        middle[1].value = 20;
+        vector.insert(vector.begin() + 1, middle.begin(), middle.end());
+        CHECK(vector == Vector<Throwing>{1, 10, 20, 30, 2, 3});
+    }
+}
+
+TEST_CASE("Vector - emplace() in the middle") {
+    SECTION("Trivially copyable") {
+        Vector<int> vector = {1, 3};
+        vector.emplace(vector.begin() + 1, 2);
+        vector.emplace(vector.begin(), vector[2]);
+        CHECK(vector == Vector<int>{3, 1, 2, 3});
+    }
+    SECTION("Owning pointers") {
+        Vector<std::unique_ptr<int>> vector;
+        vector.emplace_back(std::make_unique<int>(1));
+        vector.emplace_back(std::make_unique<int>(3));
+        auto it = vector.emplace(vector.begin() + 1, std::make_unique<int>(2));
+        CHECK(**it == 2);
+        vector.shrink_to_fit();
+        vector.emplace(vector.begin(), std::make_unique<int>(0));
+        CHECK(values(vector) == std::vector{0, 1, 2, 3});
+    }
+    SECTION("Not trivially relocatable") {
+        Vector<std::string> vector = {"a", "c"};
+        vector.emplace(vector.begin() + 1, "b");
+        vector.emplace(vector.begin(), vector[2]);
+        CHECK(vector == Vector<std::string>{"c", "a", "b", "c"});
+    }
+}
+
+TEST_CASE("Vector - erase() of trivially relocatable elements") {
+    SECTION("Trivially copyable") {
+        Vector<int> vector = {1, 2, 3, 4, 5, 6};
+        auto it = vector.erase(vector.begin() + 1);
+        CHECK(*it == 3);
+        it = vector.erase(vector.begin() + 1, vector.begin() + 3);
+        CHECK(*it == 5);
+        CHECK(vector == Vector<int>{1, 5, 6});
+        it = vector.erase(vector.begin() + 2, vector.end());
+        CHECK(it == vector.end());
+        CHECK(vector == Vector<int>{1, 5});
+    }
+    SECTION("Owning pointers") {
+        Vector<std::unique_ptr<int>> vector;
+        for (auto&& x : pointers({1, 2, 3, 4, 5}))
+            vector.push_back(std::move(x));
+        auto it = vector.erase(vector.begin() + 1, vector.begin() + 3);
+        CHECK(**it == 4);
+        vector.erase(vector.begin());
+        CHECK(values(vector) == std::vector{4, 5});
+    }
+    SECTION("Erased elements are destroyed") {
+        {
+            Vector<Throwing> vector = {1, 2, 3, 4};
+            vector.erase(vector.begin() + 1, vector.begin() + 3);
+            CHECK(Throwing::alive == 2);
+            CHECK(vector == Vector<Throwing>{1, 4});
+        }
+        CHECK(Throwing::alive == 0);
+    }
+}
+
+TEST_CASE("Vector - Throwing element constructors don't leak") {
+    std::vector<Throwing> source = {1, 2, 3, 4};
+    source[2].value = -1;
+    SECTION("Copy") {
+        Vector<Throwing> vector(source.begin(), source.begin() + 2);
+        vector.push_back(source[3]);
+        vector.data()[1].value = -1;
+        CHECK_THROWS_AS(Vector<Throwing>(vector), std::runtime_error);
+        CHECK(Throwing::alive == 7);
+    }
+    SECTION("Forward iterators") {
+        CHECK_THROWS_AS(Vector<Throwing>(source.begin(), source.end()), std::runtime_error);
+        CHECK(Throwing::alive == 4);
+    }
+    SECTION("Input iterators") {
+        std::istringstream stream("1 2 -1 3");
+        CHECK_THROWS_AS(Vector<Throwing>(std::istream_iterator<int>(stream), std::istream_iterator<int>()),
+                        std::runtime_error);
+        CHECK(Throwing::alive == 4);
+    }
+    SECTION("Filled") {
+        CHECK_THROWS_AS(Vector<Throwing>(3, source[2]), std::runtime_error);
+        CHECK(Throwing::alive == 4);
+    }
+}
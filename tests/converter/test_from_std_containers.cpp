@@ -32,6 +32,7 @@
 
 #include <deque>
 #include <list>
+#include <memory_resource>
 #include <set>
 #include <string>
 #include <tuple>
@@ -374,3 +375,187 @@ TEMPLATE_LIST_TEST_CASE("ops::as() - from view (from map)", "", SingleSocketCont
     CHECK(result
           == Dest{{CountedValue(11), CountedValue(1)}, {CountedValue(12), CountedValue(2)}, {CountedValue(13), CountedValue(3)}});
 }
+
+using ParallelSingleToSingle = typename TypesProduct<
+    std::tuple<std::vector<int>, std::deque<int>>,
+    std::tuple<std::set<int>, std::unordered_set<int>, std::multiset<int>, std::unordered_multiset<int>>>::type;
+using ParallelSingleToDouble = typename TypesProduct<
+    std::tuple<std::vector<std::pair<int, std::string>>, std::deque<std::pair<int, std::string>>>,
+    std::tuple<std::map<int, std::string>, std::unordered_map<int, std::string>, std::multimap<int, std::string>,
+               std::unordered_multimap<int, std::string>>>::type;
+
+TEMPLATE_LIST_TEST_CASE("ops::as() - Parallel", "", ParallelSingleToSingle) {
+    using Src = std::tuple_element_t<0, TestType>;
+    using Dest = std::tuple_element_t<1, TestType>;
+    Src left;
+    for (int i = 0; i < 30000; ++i)
+        left.push_back((i * 7919) % 20000);
+    Dest expected = left | ops::as<Dest>();
+    Dest result;
+    SECTION("Lvalue") { result = left | ops::as<Dest>(cefal::par); }
+    SECTION("Rvalue") { result = std::move(left) | ops::as<Dest>(cefal::par); }
+    CHECK(result == expected);
+}
+
+TEMPLATE_LIST_TEST_CASE("ops::as() - Parallel", "", ParallelSingleToDouble) {
+    using Src = std::tuple_element_t<0, TestType>;
+    using Dest = std::tuple_element_t<1, TestType>;
+    Src left;
+    for (int i = 0; i < 30000; ++i)
+        left.emplace_back((i * 7919) % 20000, std::to_string(i));
+    Dest expected = left | ops::as<Dest>();
+    Dest result;
+    SECTION("Lvalue") { result = left | ops::as<Dest>(cefal::par); }
+    SECTION("Rvalue") { result = std::move(left) | ops::as<Dest>(cefal::par); }
+    CHECK(result.size() == expected.size());
+    CHECK(result == expected);
+}
+
+TEST_CASE("ops::as() - Parallel - templated") {
+    std::vector<int> left;
+    for (int i = 0; i < 30000; ++i)
+        left.push_back(30000 - i);
+    std::set<int> result = left | ops::as<std::set>(cefal::par);
+    CHECK(result.size() == 30000);
+    CHECK(*result.begin() == 1);
+    CHECK(*result.rbegin() == 30000);
+}
+
+TEST_CASE("ops::as() - Hashed destination is reserved") {
+    std::vector<int> left;
+    for (int i = 0; i < 10000; ++i)
+        left.push_back(i);
+    CountedUnorderedSet<int> result;
+    ArrayAllocations::count = 0;
+    SECTION("Lvalue") { result = left | ops::as<CountedUnorderedSet<int>>(); }
+    SECTION("Rvalue") { result = std::move(left) | ops::as<CountedUnorderedSet<int>>(); }
+    CHECK(result.size() == 10000);
+    CHECK(ArrayAllocations::count == 1);
+}
+
+TEST_CASE("ops::as() - Hashed destination is reserved (from map)") {
+    std::map<int, std::string> left;
+    for (int i = 0; i < 1000; ++i)
+        left.emplace(i, std::to_string(i));
+    std::unordered_map<int, std::string> reserved;
+    reserved.reserve(1000);
+    auto result = left | ops::as<std::unordered_map<int, std::string>>();
+    CHECK(result.size() == 1000);
+    CHECK(result.bucket_count() == reserved.bucket_count());
+}
+
+TEST_CASE("ops::as() - ArenaScope") {
+    std::vector<int> left = {3, 1, 2};
+    ArenaScope arena;
+    auto result = left | ops::as<std::pmr::set<int>>();
+    CHECK(result == std::pmr::set<int>{1, 2, 3});
+    CHECK(result.get_allocator().resource() == arena.resource());
+}
+
+TEST_CASE("ops::as() - Allocator instance is carried over") {
+    std::vector<int, TaggedAllocator<int>> left(TaggedAllocator<int>(7));
+    for (int i = 0; i < 30000; ++i)
+        left.push_back(i);
+    using Dest = std::set<int, std::less<int>, TaggedAllocator<int>>;
+    auto check = [](const Dest& result) {
+        CHECK(result.get_allocator().id == 7);
+        CHECK(result.size() == 30000);
+    };
+    SECTION("Lvalue") { check(left | ops::as<Dest>()); }
+    SECTION("Rvalue") { check(std::move(left) | ops::as<Dest>()); }
+    SECTION("Parallel") { check(left | ops::as<Dest>(cefal::par)); }
+}
+
+TEST_CASE("ops::as() - Hasher and comparator instances are carried over") {
+    SECTION("Hasher") {
+        using Src = std::unordered_set<int, SeededHash, std::equal_to<int>, TaggedAllocator<int>>;
+        using Dest = std::unordered_multiset<int, SeededHash, std::equal_to<int>, TaggedAllocator<int>>;
+        Src left(0, SeededHash{42}, std::equal_to<int>(), TaggedAllocator<int>(7));
+        for (int i = 0; i < 100; ++i)
+            left.insert(i);
+        auto result = left | ops::as<Dest>();
+        CHECK(result.hash_function().seed == 42);
+        CHECK(result.get_allocator().id == 7);
+        CHECK(result.size() == 100);
+    }
+    SECTION("Comparator") {
+        std::set<int, FlaggedLess> left({1, 2, 3}, FlaggedLess{true});
+        auto result = left | ops::as<std::multiset<int, FlaggedLess>>();
+        CHECK(result.key_comp().reversed);
+        CHECK(*result.begin() == 3);
+    }
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::into()", "", (std::vector, SmallVector4, Vector, std::list, std::deque), (int, std::string)) {
+    using InnerType = typename TestType::value_type;
+    TestType dest = {createValue<InnerType>(5), createValue<InnerType>(6), createValue<InnerType>(7)};
+    SECTION("Shrinks") {
+        const std::vector<InnerType> left = {createValue<InnerType>(1), createValue<InnerType>(2)};
+        TestType& result = left | ops::into(dest);
+        CHECK(&result == &dest);
+        CHECK(dest == TestType{createValue<InnerType>(1), createValue<InnerType>(2)});
+    }
+    SECTION("Grows") {
+        std::set<InnerType> left = {createValue<InnerType>(1), createValue<InnerType>(2), createValue<InnerType>(3),
+                                    createValue<InnerType>(4)};
+        std::move(left) | ops::into(dest);
+        CHECK(dest
+              == TestType{createValue<InnerType>(1), createValue<InnerType>(2), createValue<InnerType>(3), createValue<InnerType>(4)});
+    }
+}
+
+TEST_CASE("ops::into() - Capacity is reused") {
+    std::vector<int> dest;
+    dest.reserve(100);
+    const int* data = dest.data();
+    for (int i = 0; i < 10; ++i) {
+        std::vector<int> left(50 + i, i);
+        left | ops::into(dest);
+        CHECK(dest == left);
+    }
+    CHECK(dest.data() == data);
+    CHECK(dest.capacity() == 100);
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::into() - Nodes are reused", "", (std::set, std::unordered_set, std::multiset, std::unordered_multiset),
+                           (int)) {
+    TestType dest = {1, 2, 3};
+    std::set<const int*> addresses;
+    for (auto&& x : dest)
+        addresses.insert(&x);
+    SECTION("Same size") {
+        std::vector<int> left = {10, 20, 30};
+        left | ops::into(dest);
+        CHECK(dest == TestType{10, 20, 30});
+        for (auto&& x : dest)
+            CHECK(addresses.count(&x));
+    }
+    SECTION("Different size") {
+        std::vector<int> left = {10, 20, 30, 40};
+        left | ops::into(dest);
+        CHECK(dest == TestType{10, 20, 30, 40});
+        left = {50};
+        left | ops::into(dest);
+        CHECK(dest == TestType{50});
+    }
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::into() - Nodes are reused", "", (std::map, std::unordered_map, std::multimap, std::unordered_multimap),
+                           ((int, std::string))) {
+    TestType dest = {{1, "a"}, {2, "b"}};
+    std::set<const std::string*> addresses;
+    for (auto&& x : dest)
+        addresses.insert(&x.second);
+    std::vector<std::pair<int, std::string>> left = {{3, "c"}, {4, "d"}};
+    left | ops::into(dest);
+    CHECK(dest == TestType{{3, "c"}, {4, "d"}});
+    for (auto&& x : dest)
+        CHECK(addresses.count(&x.second));
+}
+
+TEST_CASE("ops::into() - Duplicates in unique container") {
+    std::set<int> dest = {1, 2, 3};
+    std::vector<int> left = {5, 5, 6, 5};
+    left | ops::into(dest);
+    CHECK(dest == std::set<int>{5, 6});
+}
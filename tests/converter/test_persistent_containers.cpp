@@ -0,0 +1,164 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "counter.h"
+#include "test_helpers.h"
+
+#include "cefal/everything.h"
+
+#include "catch2/catch.hpp"
+
+#include <deque>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace cefal;
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::as() - To PersistentVector", "", (std::vector, std::list, std::deque, std::set),
+                           (int, std::string)) {
+    using InnerType = typename TestType::value_type;
+    TestType source;
+    PersistentVector<InnerType> expected;
+    for (int i = 0; i < 100; ++i) {
+        source.insert(source.end(), createValue<InnerType>(i));
+        expected.push_back(createValue<InnerType>(i));
+    }
+    if constexpr (std::is_same_v<TestType, std::set<InnerType>>)
+        expected = PersistentVector<InnerType>(source.begin(), source.end());
+    PersistentVector<InnerType> result;
+    SECTION("Lvalue") {
+        SECTION("Templated") { result = source | ops::as<PersistentVector>(); }
+        SECTION("Full") { result = source | ops::as<PersistentVector<InnerType>>(); }
+    }
+    SECTION("Rvalue") {
+        SECTION("Templated") { result = std::move(source) | ops::as<PersistentVector>(); }
+        SECTION("Full") { result = std::move(source) | ops::as<PersistentVector<InnerType>>(); }
+    }
+    CHECK(result == expected);
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::as() - From PersistentVector", "", (std::vector, std::list, std::deque, std::set),
+                           (int, std::string)) {
+    using InnerType = typename TestType::value_type;
+    PersistentVector<InnerType> source;
+    TestType expected;
+    for (int i = 0; i < 100; ++i) {
+        source.push_back(createValue<InnerType>(i));
+        expected.insert(expected.end(), createValue<InnerType>(i));
+    }
+    TestType result;
+    SECTION("Lvalue") { result = source | ops::as<TestType>(); }
+    SECTION("Rvalue") { result = std::move(source) | ops::as<TestType>(); }
+    CHECK(result == expected);
+}
+
+TEST_CASE("ops::as() - PersistentVector to itself") {
+    const PersistentVector<int> source = {1, 2, 3};
+    CHECK((source | ops::as<PersistentVector>()) == source);
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::as() - To PersistentSet", "", (std::vector, std::set, std::unordered_set), (int, std::string)) {
+    using InnerType = typename TestType::value_type;
+    TestType source;
+    PersistentSet<InnerType> expected;
+    for (int i = 0; i < 100; ++i) {
+        source.insert(source.end(), createValue<InnerType>(i % 50));
+        expected.insert(createValue<InnerType>(i % 50));
+    }
+    PersistentSet<InnerType> result;
+    SECTION("Lvalue") {
+        SECTION("Templated") { result = source | ops::as<PersistentSet>(); }
+        SECTION("Full") { result = source | ops::as<PersistentSet<InnerType>>(); }
+    }
+    SECTION("Rvalue") {
+        SECTION("Templated") { result = std::move(source) | ops::as<PersistentSet>(); }
+        SECTION("Full") { result = std::move(source) | ops::as<PersistentSet<InnerType>>(); }
+    }
+    CHECK(result.size() == 50);
+    CHECK(result == expected);
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::as() - From PersistentSet", "", (std::set, std::unordered_set), (int, std::string)) {
+    using InnerType = typename TestType::value_type;
+    PersistentSet<InnerType> source;
+    TestType expected;
+    for (int i = 0; i < 100; ++i) {
+        source.insert(createValue<InnerType>(i));
+        expected.insert(createValue<InnerType>(i));
+    }
+    TestType result;
+    SECTION("Lvalue") { result = source | ops::as<TestType>(); }
+    SECTION("Rvalue") { result = std::move(source) | ops::as<TestType>(); }
+    CHECK(result == expected);
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::as() - To PersistentMap", "", (std::map, std::unordered_map),
+                           ((int, std::string), (std::string, int))) {
+    using Key = typename TestType::key_type;
+    using Value = typename TestType::mapped_type;
+    TestType source;
+    PersistentMap<Key, Value> expected;
+    for (int i = 0; i < 100; ++i) {
+        source.emplace(createValue<Key>(i), createValue<Value>(i));
+        expected.insert(std::make_pair(createValue<Key>(i), createValue<Value>(i)));
+    }
+    PersistentMap<Key, Value> result;
+    SECTION("Lvalue") {
+        SECTION("Templated") { result = source | ops::as<PersistentMap>(); }
+        SECTION("Full") { result = source | ops::as<PersistentMap<Key, Value>>(); }
+    }
+    SECTION("Rvalue") {
+        SECTION("Templated") { result = std::move(source) | ops::as<PersistentMap>(); }
+        SECTION("Full") { result = std::move(source) | ops::as<PersistentMap<Key, Value>>(); }
+    }
+    CHECK(result == expected);
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::as() - From PersistentMap", "", (std::map, std::unordered_map),
+                           ((int, std::string), (std::string, int))) {
+    using Key = typename TestType::key_type;
+    using Value = typename TestType::mapped_type;
+    PersistentMap<Key, Value> source;
+    TestType expected;
+    for (int i = 0; i < 100; ++i) {
+        source.insert(std::make_pair(createValue<Key>(i), createValue<Value>(i)));
+        expected.emplace(createValue<Key>(i), createValue<Value>(i));
+    }
+    TestType result;
+    SECTION("Lvalue") { result = source | ops::as<TestType>(); }
+    SECTION("Rvalue") { result = std::move(source) | ops::as<TestType>(); }
+    CHECK(result == expected);
+}
+
+TEST_CASE("ops::as() - Vector of pairs to PersistentMap") {
+    const std::vector<std::pair<int, std::string>> source = {{1, "a"}, {2, "b"}, {1, "c"}};
+    auto result = source | ops::as<PersistentMap<int, std::string>>();
+    CHECK(result == PersistentMap<int, std::string>{{1, "a"}, {2, "b"}});
+}
@@ -24,13 +24,18 @@
  */
 
 #include "counter.h"
+#include "test_helpers.h"
 
 #include "cefal/everything.h"
 
 #include "catch2/catch.hpp"
 
+#include <cstdint>
 #include <deque>
 #include <list>
+#include <optional>
+#include <memory_resource>
+#include <numeric>
 #include <set>
 #include <string>
 #include <unordered_set>
@@ -121,8 +126,8 @@ struct SingletonFrom<TemplatedWithFunctionsWithSingleton<T>> {
 } // namespace cefal::helpers
 
 TEMPLATE_PRODUCT_TEST_CASE("ops::filter()", "",
-                           (std::vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
-                            std::unordered_multiset),
+                           (std::vector, SmallVector4, Vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
+                            std::unordered_multiset, PersistentVector, PersistentSet),
                            (std::string)) {
     TestType result;
     auto func = [](const std::string& s) { return std::stoi(s) % 2; };
@@ -140,7 +145,8 @@ TEMPLATE_PRODUCT_TEST_CASE("ops::filter()", "",
     CHECK(result == TestType{"1", "3"});
 }
 
-TEMPLATE_PRODUCT_TEST_CASE("ops::filter()", "", (std::map, std::unordered_map, std::multimap, std::unordered_multimap),
+TEMPLATE_PRODUCT_TEST_CASE("ops::filter()", "",
+                           (std::map, std::unordered_map, std::multimap, std::unordered_multimap, PersistentMap),
                            ((std::string, int))) {
     TestType result;
     auto func = [](const std::pair<std::string, int>& x) { return x.second % 2; };
@@ -174,3 +180,528 @@ TEMPLATE_TEST_CASE("ops::filter()", "", TemplatedWithFunctions<std::string>, Tem
 
     CHECK(result.value == "3");
 }
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::filter() - Rejected elements are not copied", "",
+                           (std::vector, SmallVector4, Vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
+                            std::unordered_multiset, PersistentVector, PersistentSet),
+                           (CountedValue)) {
+    TestType result;
+    auto func = [](const CountedValue& x) { return x.value > 3; };
+    SECTION("Lvalue") {
+        const auto left = TestType{CountedValue(1), CountedValue(2), CountedValue(3), CountedValue(4)};
+        Counter::reset();
+        result = left | ops::filter(func);
+        CHECK(Counter::copied() == 1);
+    }
+    SECTION("Rvalue") {
+        auto left = TestType{CountedValue(1), CountedValue(2), CountedValue(3), CountedValue(4)};
+        Counter::reset();
+        result = std::move(left) | ops::filter(func);
+        CHECK(Counter::copied() == 0);
+    }
+    CHECK(result == TestType{CountedValue(4)});
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::filter() - Rejected elements are not copied", "",
+                           (std::map, std::unordered_map, std::multimap, std::unordered_multimap, PersistentMap),
+                           ((int, CountedValue))) {
+    TestType result;
+    auto func = [](const auto& x) { return x.first > 3; };
+    SECTION("Lvalue") {
+        const auto left = TestType{{1, CountedValue(1)}, {2, CountedValue(2)}, {3, CountedValue(3)}, {4, CountedValue(4)}};
+        Counter::reset();
+        result = left | ops::filter(func);
+        CHECK(Counter::copied() == 1);
+    }
+    SECTION("Rvalue") {
+        auto left = TestType{{1, CountedValue(1)}, {2, CountedValue(2)}, {3, CountedValue(3)}, {4, CountedValue(4)}};
+        Counter::reset();
+        result = std::move(left) | ops::filter(func);
+        CHECK(Counter::copied() == 0);
+    }
+    CHECK(result == TestType{{4, CountedValue(4)}});
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::filter() - Predicate gets const reference", "",
+                           (std::vector, std::list, std::deque, std::set, std::unordered_set), (int)) {
+    auto left = TestType{1, 2, 3, 4};
+    auto func = [](auto&& x) { return std::is_const_v<std::remove_reference_t<decltype(x)>>; };
+    SECTION("Lvalue") { CHECK((left | ops::filter(func)).size() == 4); }
+    SECTION("Rvalue") { CHECK((std::move(left) | ops::filter(func)).size() == 4); }
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::filter() - Predicate gets const reference", "",
+                           (std::map, std::unordered_map, std::multimap, std::unordered_multimap), ((int, int))) {
+    auto left = TestType{{1, 1}, {2, 2}, {3, 3}, {4, 4}};
+    auto func = [](auto&& x) { return std::is_const_v<std::remove_reference_t<decltype(x)>>; };
+    SECTION("Lvalue") { CHECK((left | ops::filter(func)).size() == 4); }
+    SECTION("Rvalue") { CHECK((std::move(left) | ops::filter(func)).size() == 4); }
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::filter() - Parallel", "", (std::vector, std::deque, std::list), (int, std::string)) {
+    using InnerType = typename TestType::value_type;
+    TestType left;
+    TestType expected;
+    for (int i = 0; i < 100000; ++i) {
+        left.push_back(createValue<InnerType>(i));
+        if (i % 3)
+            expected.push_back(createValue<InnerType>(i));
+    }
+    auto func = [](const InnerType& x) {
+        if constexpr (std::is_same_v<InnerType, std::string>)
+            return std::stoi(x.substr(4)) % 3 != 0;
+        else
+            return (x - 10) % 3 != 0;
+    };
+
+    TestType result;
+    SECTION("Lvalue") { result = left | ops::filter(func, cefal::par); }
+    SECTION("Rvalue") { result = std::move(left) | ops::filter(func, cefal::par); }
+    CHECK(result == expected);
+}
+
+TEST_CASE("ops::filter() - Parallel - nothing accepted") {
+    std::vector<int> left(100000, 1);
+    auto result = left | ops::filter([](int x) { return x != 1; }, cefal::par);
+    CHECK(result.empty());
+}
+
+TEST_CASE("ops::filter() - Hashed destination is reserved") {
+    CountedUnorderedSet<int> left;
+    for (int i = 0; i < 10000; ++i)
+        left.insert(i);
+
+    SECTION("Most accepted") {
+        ArrayAllocations::count = 0;
+        auto result = left | ops::filter([](int x) { return x % 10 != 0; });
+        CHECK(result.size() == 9000);
+        CHECK(ArrayAllocations::count == 1);
+    }
+    SECTION("Most rejected - Lvalue") {
+        ArrayAllocations::count = 0;
+        auto result = left | ops::filter([](int x) { return x % 10 == 0; });
+        CHECK(result.size() == 1000);
+        // Single rehash at the end to give buckets back
+        CHECK(ArrayAllocations::count == 2);
+        CHECK(result.bucket_count() < 2000);
+    }
+    SECTION("Most rejected - Rvalue") {
+        auto result = std::move(left) | ops::filter([](int x) { return x % 10 == 0; });
+        CHECK(result.size() == 1000);
+        CHECK(result.bucket_count() < 2000);
+    }
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::filter() - ArenaScope", "", (std::pmr::vector, std::pmr::list, std::pmr::unordered_set), (int)) {
+    TestType left = {1, 2, 3, 4};
+    ArenaScope arena;
+    auto result = left | ops::filter([](int x) { return x % 2; });
+    CHECK(result.size() == 2);
+    CHECK(result.get_allocator().resource() == arena.resource());
+}
+
+TEST_CASE("ops::filter() - Parallel - ArenaScope") {
+    // Elements allocate with container allocator, so they would be copied into arena from worker threads
+    auto func = [](const std::pmr::string& x) { return x.back() % 3 != 0; };
+    std::pmr::vector<std::pmr::string> left;
+    std::pmr::vector<std::pmr::string> expected;
+    for (int i = 0; i < 100000; ++i) {
+        left.emplace_back("long enough string to be allocated #" + std::to_string(i));
+        if (func(left.back()))
+            expected.push_back(left.back());
+    }
+    ArenaScope arena;
+    auto check = [&arena, &expected](const std::pmr::vector<std::pmr::string>& result) {
+        CHECK(result == expected);
+        CHECK(result.get_allocator().resource() != arena.resource());
+    };
+    SECTION("Lvalue") { check(left | ops::filter(func, cefal::par)); }
+    SECTION("Rvalue") { check(std::move(left) | ops::filter(func, cefal::par)); }
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::mapMaybe()", "",
+                           (std::vector, SmallVector4, Vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
+                            std::unordered_multiset, PersistentVector, PersistentSet),
+                           (std::string)) {
+    auto func = [](const std::string& s) -> std::optional<int> {
+        if (s.empty() || s[0] == 'x')
+            return std::nullopt;
+        return std::stoi(s);
+    };
+    WithInnerType_T<TestType, int> result;
+    SECTION("Lvalue") {
+        const auto left = TestType{"1", "x2", "", "3"};
+        SECTION("Pipe") { result = left | ops::mapMaybe(func); }
+        SECTION("Curried") { result = ops::mapMaybe(func)(left); }
+    }
+    SECTION("Rvalue") {
+        auto left = TestType{"1", "x2", "", "3"};
+        result = std::move(left) | ops::mapMaybe(func);
+    }
+    CHECK(result == WithInnerType_T<TestType, int>{1, 3});
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::mapMaybe()", "",
+                           (std::map, std::unordered_map, std::multimap, std::unordered_multimap, PersistentMap),
+                           ((int, std::string))) {
+    using Dest = WithInnerType_T<TestType, std::pair<std::string, int>>;
+    auto func = [](const std::pair<int, std::string>& x) -> std::optional<std::pair<std::string, int>> {
+        if (x.first % 2)
+            return std::nullopt;
+        return std::make_pair(x.second, x.first);
+    };
+    const auto left = TestType{{1, "a"}, {2, "b"}, {3, "c"}, {4, "d"}};
+    Dest result = left | ops::mapMaybe(func);
+    CHECK(result == Dest{{"b", 2}, {"d", 4}});
+}
+
+TEST_CASE("ops::mapMaybe() - Payload is moved") {
+    std::vector<int> left = {1, 2, 3, 4};
+    Counter::reset();
+    auto result = left | ops::mapMaybe([](int x) -> std::optional<CountedValue> {
+                      if (x % 2)
+                          return std::nullopt;
+                      return CountedValue(x);
+                  });
+    CHECK(Counter::copied() == 0);
+    REQUIRE(result.size() == 2);
+    CHECK(result[1].value == 4);
+}
+
+TEST_CASE("ops::mapMaybe() - Elements of rvalue source are moved") {
+    std::vector<std::string> left = {"abcdefghijklmnopqrstuvwxyz", "x"};
+    auto result = std::move(left) | ops::mapMaybe([](std::string&& x) -> std::optional<std::string> {
+                      if (x.size() < 2)
+                          return std::nullopt;
+                      return std::move(x);
+                  });
+    CHECK(result == std::vector<std::string>{"abcdefghijklmnopqrstuvwxyz"});
+    CHECK(left[0].empty());
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::partition()", "",
+                           (std::vector, SmallVector4, Vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
+                            std::unordered_multiset, PersistentVector, PersistentSet),
+                           (std::string)) {
+    std::pair<TestType, TestType> result;
+    auto func = [](const std::string& s) { return std::stoi(s) % 2; };
+    SECTION("Lvalue") {
+        const auto left = TestType{"1", "2", "3", "4", "5"};
+        SECTION("Pipe") { result = left | ops::partition(func); }
+        SECTION("Curried") { result = ops::partition(func)(left); }
+    }
+    SECTION("Rvalue") {
+        auto left = TestType{"1", "2", "3", "4", "5"};
+        SECTION("Pipe") { result = std::move(left) | ops::partition(func); }
+        SECTION("Curried") { result = ops::partition(func)(std::move(left)); }
+    }
+
+    CHECK(result.first == TestType{"1", "3", "5"});
+    CHECK(result.second == TestType{"2", "4"});
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::partition()", "",
+                           (std::map, std::unordered_map, std::multimap, std::unordered_multimap, PersistentMap),
+                           ((std::string, int))) {
+    std::pair<TestType, TestType> result;
+    auto func = [](const std::pair<std::string, int>& x) { return x.second % 2; };
+    SECTION("Lvalue") {
+        const auto left = TestType{{"abc", 1}, {"de", 2}, {"f", 3}};
+        result = left | ops::partition(func);
+    }
+    SECTION("Rvalue") {
+        auto left = TestType{{"abc", 1}, {"de", 2}, {"f", 3}};
+        result = std::move(left) | ops::partition(func);
+    }
+
+    CHECK(result.first == TestType{{"abc", 1}, {"f", 3}});
+    CHECK(result.second == TestType{{"de", 2}});
+}
+
+TEMPLATE_TEST_CASE("ops::partition()", "", TemplatedWithFunctions<std::string>,
+                   TemplatedWithFunctionsWithSingleton<std::string>) {
+    auto func = [](const std::string& s) { return s == "3"; };
+    auto left = TestType("3");
+    auto result = std::move(left) | ops::partition(func);
+    CHECK(result.first.value == "3");
+    CHECK(result.second.value == "");
+}
+
+TEST_CASE("ops::partition() - Relative order is kept") {
+    std::vector<int> left = {5, 2, 8, 1, 4, 7, 6, 3};
+    auto func = [](int x) { return x % 2 == 0; };
+    std::pair<std::vector<int>, std::vector<int>> result;
+    SECTION("Lvalue") { result = left | ops::partition(func); }
+    SECTION("Rvalue") { result = std::move(left) | ops::partition(func); }
+    CHECK(result.first == std::vector<int>{2, 8, 4, 6});
+    CHECK(result.second == std::vector<int>{5, 1, 7, 3});
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::partition() - Elements are copied once", "",
+                           (std::vector, SmallVector4, Vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
+                            std::unordered_multiset),
+                           (CountedValue)) {
+    std::pair<TestType, TestType> result;
+    auto func = [](const CountedValue& x) { return x.value > 2; };
+    SECTION("Lvalue") {
+        const auto left = TestType{CountedValue(1), CountedValue(2), CountedValue(3), CountedValue(4)};
+        Counter::reset();
+        result = left | ops::partition(func);
+        CHECK(Counter::copied() == 4);
+    }
+    SECTION("Rvalue") {
+        auto left = TestType{CountedValue(1), CountedValue(2), CountedValue(3), CountedValue(4)};
+        Counter::reset();
+        result = std::move(left) | ops::partition(func);
+        CHECK(Counter::copied() == 0);
+    }
+    CHECK(result.first == TestType{CountedValue(3), CountedValue(4)});
+    CHECK(result.second == TestType{CountedValue(1), CountedValue(2)});
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::partition() - Nodes of rvalue source are relinked", "",
+                           (std::map, std::unordered_map, std::multimap, std::unordered_multimap), ((int, CountedValue))) {
+    auto left = TestType{{1, CountedValue(1)}, {2, CountedValue(2)}, {3, CountedValue(3)}, {4, CountedValue(4)}};
+    const auto* rejectedAddress = &left.find(1)->second;
+    Counter::reset();
+    auto result = std::move(left) | ops::partition([](const auto& x) { return x.first > 3; });
+    CHECK(Counter::copied() == 0);
+    CHECK(Counter::moved() == 0);
+    CHECK(result.first == TestType{{4, CountedValue(4)}});
+    CHECK(result.second == TestType{{1, CountedValue(1)}, {2, CountedValue(2)}, {3, CountedValue(3)}});
+    CHECK(&result.second.find(1)->second == rejectedAddress);
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::filterSimd()", "",
+                           (std::vector, SmallVector4, Vector, std::deque, std::list), (int, float, double)) {
+    using T = InnerType_T<TestType>;
+    // Sizes around batch width, including ones that leave a tail
+    auto size = GENERATE(0, 1, 3, 16, 17, 100);
+    TestType left;
+    TestType expected;
+    for (int i = 0; i < size; ++i) {
+        left.push_back(static_cast<T>(i));
+        if (i < 5 || i > 11)
+            expected.push_back(static_cast<T>(i));
+    }
+    TestType result;
+    SECTION("Some accepted") {
+        auto func = [](const Simd<T>& x) { return x < 5 || x > 11; };
+        SECTION("Lvalue") { result = left | ops::filterSimd(func); }
+        SECTION("Rvalue") { result = std::move(left) | ops::filterSimd(func); }
+    }
+    SECTION("All accepted") {
+        expected = left;
+        result = left | ops::filterSimd([](const Simd<T>& x) { return x >= 0; });
+    }
+    SECTION("None accepted") {
+        expected.clear();
+        result = std::move(left) | ops::filterSimd([](const Simd<T>& x) { return x < 0; });
+    }
+    CHECK(result == expected);
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::filter() - Placeholder expression", "", (std::vector, std::deque, std::list, std::set),
+                           (int, float, double)) {
+    using T = InnerType_T<TestType>;
+    TestType left;
+    TestType expected;
+    for (int i = 0; i < 100; ++i) {
+        left.insert(left.end(), static_cast<T>(i));
+        if ((i > 4 && i < 30) || -i == -50 || !(i < 95))
+            expected.insert(expected.end(), static_cast<T>(i));
+    }
+    auto predicate = (_1 > 4 && _1 < 30) || -_1 == -50 || !(_1 < 95);
+    TestType result;
+    SECTION("Lvalue") { result = left | ops::filter(predicate); }
+    SECTION("Rvalue") { result = std::move(left) | ops::filter(predicate); }
+    CHECK(result == expected);
+}
+
+TEST_CASE("ops::filter() - Placeholder expression arithmetic") {
+    std::vector<int> left = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+    CHECK((left | ops::filter(_1 > 4 && _1 % 3 == 0)) == std::vector<int>{6, 9, 12});
+    CHECK((left | ops::filter((_1 + 1) * 2 - 4 >= _1 * 2 / 1 && _1 != 2)) == std::vector<int>{});
+    CHECK((left | ops::filter(10 - _1 <= 0)) == std::vector<int>{10, 11, 12});
+}
+
+TEST_CASE("ops::filter() - Placeholder expression with guarded division") {
+    std::vector<long long> left = {0, 1, 0, 5, 10, 20, 0, 30, 40, 0, 2, 0, 25, 0, 0, 3, 33, 0};
+    CHECK((left | ops::filter(_1 != 0 && 100 / _1 > 3)) == std::vector<long long>{1, 5, 10, 20, 2, 25, 3});
+    CHECK((left | ops::filter(_1 != 0 && 100 % _1 == 0)) == std::vector<long long>{1, 5, 10, 20, 2, 25});
+    CHECK((left | ops::filter(_1 == 0 || 100 / _1 < 4)) == std::vector<long long>{0, 0, 0, 30, 40, 0, 0, 0, 0, 33, 0});
+    CHECK((left | ops::select(_1 != 0 && 100 / _1 > 3)).size() == 7);
+    std::vector<int> ints = {0, 3, 0, 4, 0, 6, 0, 8, 0, 9, 0, 12};
+    CHECK((ints | ops::filter(_1 > 0 && -(_1 % 3) == 0 && 12 % _1 == 0)) == std::vector<int>{3, 6, 12});
+}
+
+TEST_CASE("ops::filter() - Placeholder expression is a normal callable") {
+    auto predicate = _1 > 4 && _1 % 3 == 0;
+    CHECK(predicate(6));
+    CHECK(!predicate(3));
+    CHECK(!predicate(7));
+    CHECK((_1 * 2)(21) == 42);
+    // Scalars keep short circuit
+    CHECK(!(_1 != 0 && 10 / _1 > 2)(0));
+}
+
+TEST_CASE("ops::filter() - Placeholder expression with wider constants") {
+    std::vector<int> left = {3, 4, 5};
+    CHECK((left | ops::filter(_1 < 4.5)) == std::vector<int>{3, 4});
+    std::vector<float> floats = {0.1f, 0.5f, 0.7f};
+    CHECK((floats | ops::filter(_1 > 0.5)) == std::vector<float>{0.7f});
+    CHECK((floats | ops::filter(_1 >= 0.5f)) == std::vector<float>{0.5f, 0.7f});
+}
+
+TEST_CASE("ops::filter() - Placeholder expression over promoted types") {
+    std::vector<int8_t> left(64, 100);
+    left[10] = 10;
+    auto predicate = _1 + _1 > int8_t(100);
+    CHECK(predicate(left[0]));
+    std::vector<int8_t> expected(63, 100);
+    CHECK((left | ops::filter(predicate)) == expected);
+    CHECK((left | ops::select(predicate)).size() == 63);
+    std::vector<uint8_t> unsignedLeft(64, 5);
+    CHECK((unsignedLeft | ops::filter(-_1 < uint8_t(0))) == unsignedLeft);
+    CHECK((unsignedLeft | ops::filter(_1 > uint8_t(4))) == unsignedLeft);
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::select()", "",
+                           (std::vector, SmallVector4, Vector, std::deque, std::list), (int, float, double)) {
+    using T = InnerType_T<TestType>;
+    // Sizes around batch width and around buffer that indices go through
+    auto size = GENERATE(0, 1, 3, 16, 17, 100, 1024, 3000);
+    TestType left;
+    Selection expected;
+    for (int i = 0; i < size; ++i) {
+        left.push_back(static_cast<T>(i));
+        if (i < 5 || i > 11)
+            expected.push_back(i);
+    }
+    SECTION("Lambda") { CHECK((left | ops::select([](T x) { return x < 5 || x > 11; })) == expected); }
+    SECTION("Placeholder expression") { CHECK((left | ops::select(_1 < 5 || _1 > 11)) == expected); }
+    SECTION("All selected") {
+        Selection all(size);
+        std::iota(all.begin(), all.end(), 0);
+        CHECK((left | ops::select(_1 >= 0)) == all);
+    }
+    SECTION("None selected") { CHECK((left | ops::select([](T x) { return x < 0; })) == Selection{}); }
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::gather()", "", (std::vector, SmallVector4, Vector, std::deque, std::list), (int, std::string)) {
+    using InnerType = typename TestType::value_type;
+    TestType left;
+    for (int i = 0; i < 5; ++i)
+        left.push_back(createValue<InnerType>(i));
+    const Selection selection = {0, 2, 3};
+    TestType expected = {createValue<InnerType>(0), createValue<InnerType>(2), createValue<InnerType>(3)};
+    TestType result;
+    SECTION("Lvalue") { result = left | ops::gather(selection); }
+    SECTION("Rvalue") { result = std::move(left) | ops::gather(selection); }
+    SECTION("Temporary selection") { result = left | ops::gather(Selection{0, 2, 3}); }
+    SECTION("Empty selection") {
+        expected.clear();
+        result = left | ops::gather(Selection{});
+    }
+    CHECK(result == expected);
+}
+
+TEST_CASE("ops::gather() - Selection is applied to other columns") {
+    std::vector<int> ids = {10, 20, 30, 40, 50};
+    std::deque<std::string> names = {"a", "b", "c", "d", "e"};
+    std::list<double> prices = {1.5, 2.5, 3.5, 4.5, 5.5};
+    Selection selection = ids | ops::select(_1 % 20 == 10);
+    CHECK(selection == Selection{0, 2, 4});
+    CHECK((ids | ops::gather(selection)) == std::vector<int>{10, 30, 50});
+    CHECK((names | ops::gather(selection)) == std::deque<std::string>{"a", "c", "e"});
+    CHECK((prices | ops::gather(selection)) == std::list<double>{1.5, 3.5, 5.5});
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::gather() - Only selected elements are copied", "",
+                           (std::vector, SmallVector4, Vector, std::deque, std::list), (CountedValue)) {
+    auto left = TestType{CountedValue(1), CountedValue(2), CountedValue(3), CountedValue(4)};
+    Selection selection = left | ops::select([](const CountedValue& x) { return x.value % 2 == 0; });
+    TestType result;
+    SECTION("Lvalue") {
+        Counter::reset();
+        result = left | ops::gather(selection);
+        CHECK(Counter::copied() == 2);
+    }
+    SECTION("Rvalue") {
+        Counter::reset();
+        result = std::move(left) | ops::gather(selection);
+        CHECK(Counter::copied() == 0);
+    }
+    CHECK(result == TestType{CountedValue(2), CountedValue(4)});
+}
+
+TEST_CASE("ops::filter() - SmallVector goes back to inline storage") {
+    const SmallVector<int, 4> left = {1, 2, 3, 4, 5, 6, 7, 8};
+    auto result = left | ops::filter([](int x) { return x > 5; });
+    CHECK(result.isInline());
+    CHECK(result == SmallVector<int, 4>{6, 7, 8});
+}
+
+TEST_CASE("ops::filter() - Allocator instance is carried over") {
+    std::vector<int, TaggedAllocator<int>> left(TaggedAllocator<int>(7));
+    for (int i = 0; i < 10000; ++i)
+        left.push_back(i);
+    auto func = [](int x) { return x % 2; };
+    auto check = [](const std::vector<int, TaggedAllocator<int>>& result) {
+        CHECK(result.get_allocator().id == 7);
+        CHECK(result.size() == 5000);
+    };
+    SECTION("Lvalue") { check(left | ops::filter(func)); }
+    SECTION("Rvalue") { check(std::move(left) | ops::filter(func)); }
+    SECTION("Parallel") { check(left | ops::filter(func, cefal::par)); }
+}
+
+TEST_CASE("ops::gather() - Allocator instance is carried over") {
+    const Selection selection = {1, 5, 42};
+    auto check = [&selection]<typename Container>(Container left) {
+        for (int i = 0; i < 100; ++i)
+            left.push_back(i);
+        auto result = left | ops::gather(selection);
+        CHECK(result.get_allocator().id == 7);
+        CHECK(result == Container({1, 5, 42}, TaggedAllocator<int>(7)));
+        auto moved = std::move(left) | ops::gather(selection);
+        CHECK(moved.get_allocator().id == 7);
+        CHECK(moved == result);
+    };
+    SECTION("Vector") { check(std::vector<int, TaggedAllocator<int>>(TaggedAllocator<int>(7))); }
+    SECTION("Deque") { check(std::deque<int, TaggedAllocator<int>>(TaggedAllocator<int>(7))); }
+}
+
+TEST_CASE("ops::filter() - Comparator instance is carried over") {
+    std::set<int, FlaggedLess, TaggedAllocator<int>> left(FlaggedLess{true}, TaggedAllocator<int>(7));
+    for (int i = 0; i < 100; ++i)
+        left.insert(i);
+    auto func = [](int x) { return x % 2; };
+    auto check = [](const std::set<int, FlaggedLess, TaggedAllocator<int>>& result) {
+        CHECK(result.key_comp().reversed);
+        CHECK(result.get_allocator().id == 7);
+        CHECK(*result.begin() == 99);
+    };
+    SECTION("Lvalue") { check(left | ops::filter(func)); }
+    SECTION("Rvalue") { check(std::move(left) | ops::filter(func)); }
+}
+
+TEST_CASE("ops::filter() - Hasher instance is carried over") {
+    using Set = std::unordered_set<int, SeededHash, std::equal_to<int>, TaggedAllocator<int>>;
+    Set left(0, SeededHash{42}, std::equal_to<int>(), TaggedAllocator<int>(7));
+    for (int i = 0; i < 100; ++i)
+        left.insert(i);
+    auto func = [](int x) { return x % 2; };
+    auto check = [](const Set& result) {
+        CHECK(result.hash_function().seed == 42);
+        CHECK(result.get_allocator().id == 7);
+        CHECK(result.size() == 50);
+    };
+    SECTION("Lvalue") { check(left | ops::filter(func)); }
+    SECTION("Rvalue") { check(std::move(left) | ops::filter(func)); }
+    SECTION("Partition") {
+        auto result = left | ops::partition(func);
+        check(result.first);
+        check(result.second);
+    }
+}
@@ -0,0 +1,111 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "counter.h"
+#include "test_helpers.h"
+
+#include "cefal/everything.h"
+
+#include "catch2/catch.hpp"
+
+#include <list>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace cefal;
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::filter()", "", (std::vector, std::list, std::set), (int)) {
+    auto func = [](int x) { return x % 2; };
+    Shared<TestType> result;
+    SECTION("Lvalue") {
+        const auto left = Shared<TestType>{1, 2, 3, 4, 5};
+        result = left | ops::filter(func);
+        CHECK(left.get() == TestType{1, 2, 3, 4, 5});
+    }
+    SECTION("Rvalue") {
+        auto left = Shared<TestType>{1, 2, 3, 4, 5};
+        SECTION("Unique") { result = std::move(left) | ops::filter(func); }
+        SECTION("Shared") {
+            auto snapshot = left;
+            result = std::move(left) | ops::filter(func);
+            CHECK(snapshot.get() == TestType{1, 2, 3, 4, 5});
+        }
+    }
+    CHECK(result.get() == TestType{1, 3, 5});
+}
+
+TEST_CASE("ops::filter() - Unique handle is filtered in place") {
+    auto left = Shared<std::vector<CountedValue>>{1, 2, 3, 4, 5};
+    const CountedValue* data = left->data();
+    Counter::reset();
+    auto result = std::move(left) | ops::filter([](const CountedValue& x) { return x.value % 2; });
+    CHECK(Counter::copied() == 0);
+    CHECK(result->data() == data);
+    CHECK(result.get() == std::vector<CountedValue>{1, 3, 5});
+}
+
+TEST_CASE("ops::filter() - Placeholder") {
+    auto left = Shared<std::vector<int>>{1, 5, 2, 6, 3, 7};
+    auto snapshot = left;
+    auto result = left | ops::filter(_1 > 4);
+    CHECK(result.get() == std::vector<int>{5, 6, 7});
+    CHECK(snapshot.get() == std::vector<int>{1, 5, 2, 6, 3, 7});
+}
+
+TEST_CASE("ops::mapMaybe() - Shared<std::vector>") {
+    auto func = [](std::string&& s) -> std::optional<int> {
+        if (s.empty())
+            return std::nullopt;
+        return std::stoi(std::move(s));
+    };
+    auto left = Shared<std::vector<std::string>>{"1", "", "3"};
+    Shared<std::vector<int>> result;
+    SECTION("Unique") { result = std::move(left) | ops::mapMaybe(func); }
+    SECTION("Shared") {
+        auto snapshot = left;
+        result = std::move(left) | ops::mapMaybe(func);
+        CHECK(snapshot.get() == std::vector<std::string>{"1", "", "3"});
+    }
+    CHECK(result.get() == std::vector<int>{1, 3});
+}
+
+TEST_CASE("ops::partition() - Shared<std::vector>") {
+    auto func = [](int x) { return x % 2; };
+    auto left = Shared<std::vector<int>>{1, 2, 3, 4, 5};
+    const int* data = left->data();
+    std::pair<Shared<std::vector<int>>, Shared<std::vector<int>>> result;
+    SECTION("Lvalue") {
+        result = left | ops::partition(func);
+        CHECK(left.get() == std::vector<int>{1, 2, 3, 4, 5});
+    }
+    SECTION("Unique") {
+        result = std::move(left) | ops::partition(func);
+        CHECK(result.first->data() == data);
+    }
+    CHECK(result.first.get() == std::vector<int>{1, 3, 5});
+    CHECK(result.second.get() == std::vector<int>{2, 4});
+}
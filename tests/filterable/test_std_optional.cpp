@@ -89,3 +89,24 @@ TEST_CASE("ops::filter() - nullopt") {
     CHECK(!result);
     CHECK(!called);
 }
+
+TEST_CASE("ops::mapMaybe()") {
+    auto func = [](const std::string& x) -> std::optional<int> {
+        if (x.empty())
+            return std::nullopt;
+        return int(x.size());
+    };
+    CHECK((std::optional<std::string>("42") | ops::mapMaybe(func)) == std::optional<int>(2));
+    CHECK(!(std::optional<std::string>("") | ops::mapMaybe(func)));
+    CHECK(!(std::optional<std::string>() | ops::mapMaybe(func)));
+}
+
+TEST_CASE("ops::partition()") {
+    auto func = [](const std::string& x) { return !x.empty(); };
+    auto accepted = std::optional<std::string>("42") | ops::partition(func);
+    CHECK(accepted.first == std::optional<std::string>("42"));
+    CHECK(!accepted.second);
+    auto rejected = std::optional<std::string>("") | ops::partition(func);
+    CHECK(!rejected.first);
+    CHECK(rejected.second == std::optional<std::string>(""));
+}
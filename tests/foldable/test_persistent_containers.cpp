@@ -0,0 +1,187 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "counter.h"
+#include "test_helpers.h"
+
+#include "cefal/everything.h"
+
+#include "catch2/catch.hpp"
+
+#include <string>
+
+using namespace cefal;
+
+namespace {
+template <typename T>
+PersistentVector<T> createPersistent(int size) {
+    PersistentVector<T> result;
+    for (int i = 0; i < size; ++i)
+        result.push_back(T(i));
+    return result;
+}
+} // namespace
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::foldLeft()", "", (PersistentVector), (int)) {
+    std::string result;
+    std::string expected = "result=";
+    auto folder = [](std::string&& s, int x) {
+        s += std::to_string(x);
+        return std::move(s);
+    };
+    for (int x = 0; x < 100; ++x)
+        expected += std::to_string(x);
+    SECTION("Lvalue") {
+        const auto left = createPersistent<int>(100);
+        SECTION("Pipe") { result = left | ops::foldLeft(std::string("result="), folder); }
+        SECTION("Curried") { result = ops::foldLeft(std::string("result="), folder)(left); }
+    }
+    SECTION("Rvalue") {
+        auto left = createPersistent<int>(100);
+        SECTION("Pipe") { result = std::move(left) | ops::foldLeft(std::string("result="), folder); }
+        SECTION("Curried") { result = ops::foldLeft(std::string("result="), folder)(std::move(left)); }
+    }
+    CHECK(result == expected);
+}
+
+TEST_CASE("ops::foldLeft() - Concatenated vector") {
+    auto size = GENERATE(0, 1, 32, 33, 5000);
+    auto left = createPersistent<int>(size);
+    auto right = createPersistent<int>(size) | ops::map([size](int x) { return x + size; });
+    auto concatenated = left | ops::append(right);
+    auto result = concatenated | ops::foldLeft(0, [](int acc, int x) {
+                      CHECK(acc == x);
+                      return acc + 1;
+                  });
+    CHECK(result == 2 * size);
+}
+
+TEST_CASE("ops::foldLeft() - Elements of unique leaves are moved") {
+    auto left = createPersistent<CountedValue>(1000);
+    auto folder = [](int acc, CountedValue&& x) {
+        CountedValue taken = std::move(x);
+        return acc + taken.value;
+    };
+    SECTION("Unique") {
+        Counter::reset();
+        CHECK((std::move(left) | ops::foldLeft(0, folder)) == 499500);
+        CHECK(Counter::copied() == 0);
+    }
+    SECTION("Shared") {
+        const auto snapshot = left;
+        Counter::reset();
+        CHECK((std::move(left) | ops::foldLeft(0, folder)) == 499500);
+        CHECK(Counter::copied() == 1000);
+        CHECK(snapshot.size() == 1000);
+        CHECK(snapshot[999].value == 999);
+    }
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::foldLeft() - Reduced", "", (PersistentVector), (int)) {
+    const auto left = createPersistent<int>(1000);
+    int calls = 0;
+    auto result = left | ops::foldLeft(0, [&calls](int acc, int x) {
+                      ++calls;
+                      return x < 100 ? Reduced<int>(acc + x) : reduced(acc);
+                  });
+    CHECK(result == 4950);
+    CHECK(calls == 101);
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::foldMap() - Arithmetic monoids", "", (PersistentVector), (int, double)) {
+    using T = InnerType_T<TestType>;
+    auto size = GENERATE(1, 31, 33, 5000);
+    const auto left = createPersistent<T>(size);
+    CHECK(static_cast<T>(left | ops::foldMap<Sum<T>>([](T x) { return x; })) == static_cast<T>(size * (size - 1) / 2));
+    CHECK(static_cast<T>(left | ops::foldMap<Max<T>>([](T x) { return x; })) == static_cast<T>(size - 1));
+    CHECK(static_cast<T>(left | ops::foldMap<Min<T>>([](T x) { return x + 1; })) == static_cast<T>(1));
+}
+
+TEMPLATE_TEST_CASE("ops::foldLeft() - Hash containers", "", PersistentSet<int>, (PersistentMap<int, int>)) {
+    auto size = GENERATE(0, 1, 33, 5000);
+    TestType left;
+    for (int i = 0; i < size; ++i) {
+        if constexpr (std::is_same_v<TestType, PersistentSet<int>>)
+            left.insert(i);
+        else
+            left.insert(std::make_pair(i, i));
+    }
+    auto folder = [](long long acc, const auto& x) {
+        if constexpr (std::is_same_v<TestType, PersistentSet<int>>)
+            return acc + x;
+        else
+            return acc + x.first + x.second;
+    };
+    const long long expected = std::is_same_v<TestType, PersistentSet<int>> ? size * (size - 1ll) / 2 : size * (size - 1ll);
+    SECTION("Lvalue") { CHECK((left | ops::foldLeft(0ll, folder)) == expected); }
+    SECTION("Rvalue") { CHECK((std::move(left) | ops::foldLeft(0ll, folder)) == expected); }
+}
+
+TEST_CASE("ops::foldLeft() - Entries of unique trie nodes are moved") {
+    PersistentMap<int, CountedValue> left;
+    for (int i = 0; i < 1000; ++i)
+        left.insert(std::make_pair(i, CountedValue(i)));
+    auto folder = [](int acc, std::pair<int, CountedValue>&& x) {
+        CountedValue taken = std::move(x.second);
+        return acc + taken.value;
+    };
+    SECTION("Unique") {
+        Counter::reset();
+        CHECK((std::move(left) | ops::foldLeft(0, folder)) == 499500);
+        CHECK(Counter::copied() == 0);
+    }
+    SECTION("Shared") {
+        const auto snapshot = left;
+        Counter::reset();
+        CHECK((std::move(left) | ops::foldLeft(0, folder)) == 499500);
+        CHECK(Counter::copied() == 1000);
+        CHECK(snapshot.size() == 1000);
+        CHECK(snapshot.at(999).value == 999);
+    }
+}
+
+TEST_CASE("ops::foldLeft() - Hash containers - Reduced") {
+    PersistentSet<int> left;
+    for (int i = 0; i < 1000; ++i)
+        left.insert(i);
+    int calls = 0;
+    auto result = left | ops::foldLeft(0, [&calls](int acc, int) {
+                      ++calls;
+                      return acc < 100 ? Reduced<int>(acc + 1) : reduced(acc);
+                  });
+    CHECK(result == 100);
+    CHECK(calls == 101);
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::foldMap() - Hash containers - Arithmetic monoids", "", (PersistentSet), (int, double)) {
+    using T = InnerType_T<TestType>;
+    auto size = GENERATE(1, 31, 33, 5000);
+    TestType left;
+    for (int i = 0; i < size; ++i)
+        left.insert(T(i));
+    CHECK(static_cast<T>(left | ops::foldMap<Sum<T>>([](T x) { return x; })) == static_cast<T>(size * (size - 1) / 2));
+    CHECK(static_cast<T>(left | ops::foldMap<Max<T>>([](T x) { return x; })) == static_cast<T>(size - 1));
+    CHECK(static_cast<T>(left | ops::foldMap<Min<T>>([](T x) { return x + 1; })) == static_cast<T>(1));
+}
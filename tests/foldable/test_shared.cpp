@@ -0,0 +1,83 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "counter.h"
+#include "test_helpers.h"
+
+#include "cefal/everything.h"
+
+#include "catch2/catch.hpp"
+
+#include <list>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace cefal;
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::foldLeft()", "", (std::vector, std::list, std::set), (int)) {
+    std::string result;
+    auto folder = [](std::string&& s, int x) {
+        s += std::to_string(x);
+        return std::move(s);
+    };
+    SECTION("Lvalue") {
+        const auto left = Shared<TestType>{1, 2, 3};
+        result = left | ops::foldLeft(std::string("result="), folder);
+    }
+    SECTION("Rvalue") {
+        auto left = Shared<TestType>{1, 2, 3};
+        result = std::move(left) | ops::foldLeft(std::string("result="), folder);
+    }
+    SECTION("Empty") {
+        result = Shared<TestType>() | ops::foldLeft(std::string("result="), folder) | ops::append(std::string("123"));
+    }
+    CHECK(result == "result=123");
+}
+
+TEST_CASE("ops::foldLeft() - Elements are moved only from unique handle") {
+    auto folder = [](int acc, CountedValue&& x) { return acc + x.value; };
+    auto left = Shared<std::vector<CountedValue>>{1, 2, 3};
+    int result = 0;
+    SECTION("Unique") {
+        Counter::reset();
+        result = std::move(left) | ops::foldLeft(0, folder);
+        CHECK(Counter::copied() == 0);
+    }
+    SECTION("Shared") {
+        auto snapshot = left;
+        Counter::reset();
+        result = std::move(left) | ops::foldLeft(0, folder);
+        CHECK(Counter::copied() == 3);
+        CHECK(snapshot.get() == std::vector<CountedValue>{1, 2, 3});
+    }
+    CHECK(result == 6);
+}
+
+TEST_CASE("ops::foldMap() - Shared<std::vector>") {
+    auto left = Shared<std::vector<int>>{1, 2, 3, 4};
+    CHECK((left | ops::foldMap<Sum<int>>([](int x) { return x * 2; })) == 20);
+    CHECK((left | ops::foldMap<Sum<int>>([](int x) { return x * 2; }, cefal::par)) == 20);
+}
@@ -29,7 +29,10 @@
 
 #include "catch2/catch.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <deque>
+#include <limits>
 #include <list>
 #include <set>
 #include <string>
@@ -39,7 +42,7 @@
 using namespace cefal;
 
 TEMPLATE_PRODUCT_TEST_CASE("ops::foldLeft()", "",
-                           (std::vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
+                           (std::vector, SmallVector4, Vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
                             std::unordered_multiset),
                            (int)) {
     std::string result;
@@ -65,7 +68,7 @@ TEMPLATE_PRODUCT_TEST_CASE("ops::foldLeft()", "",
 }
 
 TEMPLATE_PRODUCT_TEST_CASE("ops::foldLeft()", "",
-                           (std::vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
+                           (std::vector, SmallVector4, Vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
                             std::unordered_multiset),
                            (std::string)) {
     std::string result;
@@ -113,3 +116,184 @@ TEMPLATE_PRODUCT_TEST_CASE("ops::foldLeft()", "", (std::map, std::unordered_map,
 
     CHECK(result == expected);
 }
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::foldMap()", "",
+                           (std::vector, SmallVector4, Vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
+                            std::unordered_multiset),
+                           (int)) {
+    Sum<int> result;
+    auto mapper = [](int x) { return x * 2; };
+    SECTION("Lvalue") {
+        const auto left = TestType{1, 2, 3};
+        SECTION("Pipe") { result = left | ops::foldMap<Sum<int>>(mapper); }
+        SECTION("Curried") { result = ops::foldMap<Sum<int>>(mapper)(left); }
+        SECTION("Parallel") { result = left | ops::foldMap<Sum<int>>(mapper, cefal::par); }
+    }
+    SECTION("Rvalue") {
+        auto left = TestType{1, 2, 3};
+        SECTION("Pipe") { result = std::move(left) | ops::foldMap<Sum<int>>(mapper); }
+        SECTION("Curried") { result = ops::foldMap<Sum<int>>(mapper)(std::move(left)); }
+        SECTION("Parallel") { result = std::move(left) | ops::foldMap<Sum<int>>(mapper, cefal::par); }
+    }
+
+    CHECK(result.value == 12);
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::foldMap() - Parallel", "", (std::vector, std::deque), (int)) {
+    TestType left;
+    for (int i = 0; i < 100000; ++i)
+        left.push_back(i);
+
+    SECTION("Sum") {
+        auto result = left | ops::foldMap<Sum<long long>>([](int x) { return static_cast<long long>(x); }, cefal::par);
+        CHECK(result.value == 4999950000ll);
+    }
+    SECTION("Non-commutative monoid") {
+        std::string expected;
+        for (int i = 0; i < 100000; ++i)
+            expected += static_cast<char>('a' + i % 26);
+        auto mapper = [](int x) { return std::string(1, static_cast<char>('a' + x % 26)); };
+        std::string result;
+        SECTION("Lvalue") { result = left | ops::foldMap<std::string>(mapper, cefal::par); }
+        SECTION("Rvalue") { result = std::move(left) | ops::foldMap<std::string>(mapper, cefal::par); }
+        CHECK(result == expected);
+    }
+    SECTION("Container monoid") {
+        auto result = left | ops::foldMap<std::vector<int>>([](int x) { return std::vector<int>{x}; }, cefal::par);
+        CHECK(result == std::vector<int>(left.begin(), left.end()));
+    }
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::foldLeft() - Reduced", "",
+                           (std::vector, SmallVector4, Vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
+                            std::unordered_multiset),
+                           (int)) {
+    int steps = 0;
+    auto folder = [&steps](int found, int x) {
+        ++steps;
+        if (x == 3)
+            return reduced(x);
+        return Reduced<int>(found);
+    };
+    int result = 0;
+    SECTION("Lvalue") {
+        const auto left = TestType{1, 2, 3, 4, 5};
+        result = left | ops::foldLeft(0, folder);
+    }
+    SECTION("Rvalue") {
+        auto left = TestType{1, 2, 3, 4, 5};
+        result = std::move(left) | ops::foldLeft(0, folder);
+    }
+    CHECK(result == 3);
+    CHECK(steps <= 3);
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::foldLeft() - Reduced", "",
+                           (std::map, std::unordered_map, std::multimap, std::unordered_multimap),
+                           ((int, std::string))) {
+    int steps = 0;
+    auto folder = [&steps](std::string found, const std::pair<int, std::string>& x) {
+        ++steps;
+        if (x.first == 2)
+            return reduced(x.second);
+        return Reduced<std::string>(std::move(found));
+    };
+    std::string result;
+    SECTION("Lvalue") {
+        const auto left = TestType{{1, "a"}, {2, "b"}, {3, "c"}};
+        result = left | ops::foldLeft(std::string(), folder);
+    }
+    SECTION("Rvalue") {
+        auto left = TestType{{1, "a"}, {2, "b"}, {3, "c"}};
+        result = std::move(left) | ops::foldLeft(std::string(), folder);
+    }
+    CHECK(result == "b");
+    CHECK(steps <= 2);
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::foldWhile()", "",
+                           (std::vector, SmallVector4, Vector, std::list, std::deque, std::set, std::multiset),
+                           (int)) {
+    int steps = 0;
+    auto sum = [&steps](int acc, int x) {
+        ++steps;
+        return acc + x;
+    };
+    auto belowTen = [](int acc) { return acc < 10; };
+    const auto left = TestType{1, 2, 3, 4, 5, 6};
+    SECTION("Stops when condition fails") {
+        CHECK((left | ops::foldWhile(0, belowTen, sum)) == 10);
+        CHECK(steps == 4);
+    }
+    SECTION("Whole source") {
+        CHECK((left | ops::foldWhile(0, [](int) { return true; }, sum)) == 21);
+        CHECK(steps == 6);
+    }
+    SECTION("Initial value fails condition") {
+        CHECK((TestType{1, 2, 3} | ops::foldWhile(10, belowTen, sum)) == 10);
+        CHECK(steps == 0);
+    }
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::foldMap() - Arithmetic monoids", "", (std::vector, std::deque, std::list), (int, double)) {
+    using T = InnerType_T<TestType>;
+    // Sizes around lanes and block boundaries, including ones that leave a tail
+    auto size = GENERATE(0, 1, 7, 64, 100, 1024, 1500, 4099);
+    TestType left;
+    for (int i = 0; i < size; ++i)
+        left.push_back(static_cast<T>((i * 37) % 101 - 50));
+    T sum = 0;
+    T min = std::numeric_limits<T>::max();
+    T max = std::numeric_limits<T>::lowest();
+    for (auto x : left) {
+        sum += x;
+        min = std::min(min, x);
+        max = std::max(max, x);
+    }
+    auto identity = [](T x) { return x; };
+    SECTION("Sequential") {
+        CHECK((left | ops::foldMap<Sum<T>>(identity)).value == Approx(sum));
+        CHECK((left | ops::foldMap<Sum<T>>([](T x) { return x * 2; })).value == Approx(sum * 2));
+        if (size) {
+            CHECK((left | ops::foldMap<Min<T>>(identity)).value == min);
+            CHECK((left | ops::foldMap<Max<T>>(identity)).value == max);
+        }
+        CHECK((std::move(left) | ops::foldMap<Sum<T>>(identity)).value == Approx(sum));
+    }
+    SECTION("Parallel") {
+        CHECK((left | ops::foldMap<Sum<T>>(identity, cefal::par)).value == Approx(sum));
+        if (size)
+            CHECK((left | ops::foldMap<Max<T>>(identity, cefal::par)).value == max);
+    }
+}
+
+TEST_CASE("ops::foldMap() - Arithmetic monoids") {
+    SECTION("Product") {
+        std::vector<double> left(2000, 1.0);
+        left[1234] = 3.0;
+        left[7] = 0.5;
+        CHECK((left | ops::foldMap<Product<double>>([](double x) { return x; })).value == Approx(1.5));
+    }
+    SECTION("Floating point sum is accurate") {
+        std::vector<double> left(1'000'000, 0.1);
+        double naive = 0;
+        for (double x : left)
+            naive += x;
+        double result = (left | ops::foldMap<Sum<double>>([](double x) { return x; })).value;
+        CHECK(std::abs(result - 100'000.0) < 1e-8);
+        CHECK(std::abs(result - 100'000.0) < std::abs(naive - 100'000.0));
+    }
+    SECTION("Elements are mapped") {
+        std::vector<std::string> left = {"a", "bcd", "", "ef"};
+        CHECK((left | ops::foldMap<Max<size_t>>([](const std::string& x) { return x.size(); })).value == 3);
+        CHECK((left | ops::foldMap<Sum<size_t>>([](const std::string& x) { return x.size(); })).value == 6);
+    }
+    SECTION("Default constructed accumulator") {
+        std::vector<int> positive = {5, 3, 8};
+        std::vector<int> negative = {-5, -3, -8};
+        auto min = [](Min<int> acc, int x) { return acc | ops::append(Min(x)); };
+        auto max = [](Max<int> acc, int x) { return acc | ops::append(Max(x)); };
+        CHECK((positive | ops::foldLeft(Min<int>(), min)).value == 3);
+        CHECK((negative | ops::foldLeft(Max<int>(), max)).value == -3);
+    }
+}
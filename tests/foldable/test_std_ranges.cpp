@@ -29,6 +29,7 @@
 
 #include "catch2/catch.hpp"
 
+#include <functional>
 #include <ranges>
 #include <set>
 #include <string>
@@ -78,3 +79,11 @@ TEMPLATE_PRODUCT_TEST_CASE("ops::foldLeft()", "", (FromVector, FromSet, FromSing
 
     CHECK(result == "result=" + tester.result);
 }
+
+TEST_CASE("ops::foldLeft() - Reduced over infinite range") {
+    auto firstSquareAbove = [](int limit) {
+        return [limit](int found, int x) { return x * x > limit ? reduced(x) : Reduced<int>(found); };
+    };
+    CHECK((std::views::iota(1) | ops::foldLeft(0, firstSquareAbove(50))) == 8);
+    CHECK((std::views::iota(1) | ops::foldWhile(0, [](int acc) { return acc < 100; }, std::plus<int>())) == 105);
+}
@@ -29,7 +29,9 @@
 
 #include "catch2/catch.hpp"
 
+#include <functional>
 #include <string>
+#include <vector>
 
 using namespace cefal;
 
@@ -138,3 +140,42 @@ TEMPLATE_TEST_CASE("ops::foldLeft() - LValue", "", WithFunctions, with_functions
     CHECK(Counter::customCount() == 1);
     CHECK(Counter::custom("lvalue_foldLeft") == 1);
 }
+
+TEMPLATE_TEST_CASE("ops::foldLeft() - Reduced", "", WithFunctions, with_functions, TemplatedWithFunctions<int>) {
+    auto stopAtOdd = [](int acc, int x) { return x % 2 ? reduced(acc + x) : Reduced<int>(acc + x); };
+    CHECK((TestType(3) | ops::foldLeft(1, stopAtOdd)) == 4);
+    CHECK((ops::foldWhile(1, [](int acc) { return acc < 5; }, std::plus<int>())(TestType(4))) == 5);
+    CHECK((ops::foldWhile(5, [](int acc) { return acc < 5; }, std::plus<int>())(TestType(4))) == 5);
+}
+
+struct Numbers {
+    std::vector<int> values;
+    template <typename Result, typename Func>
+    Result foldLeft(Result&& init, Func&& f) const& {
+        Result result = std::forward<Result>(init);
+        for (int x : values)
+            result = f(std::move(result), x);
+        return result;
+    }
+};
+
+namespace cefal {
+template <>
+struct InnerType<Numbers> {
+    using type = int;
+};
+template <typename T>
+struct WithInnerType<Numbers, T> {
+    using type = Numbers;
+};
+} // namespace cefal
+
+TEST_CASE("ops::foldLeft() - Reduced step is not called after stop") {
+    int steps = 0;
+    auto findTwo = [&steps](bool, int x) {
+        ++steps;
+        return Reduced<bool>(x == 2, x == 2);
+    };
+    CHECK((Numbers{{1, 2, 3, 4}} | ops::foldLeft(false, findTwo)));
+    CHECK(steps == 2);
+}
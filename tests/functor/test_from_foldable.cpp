@@ -24,15 +24,21 @@
  */
 
 #include "counter.h"
+#include "test_helpers.h"
 
 #include "cefal/everything.h"
 
 #include "catch2/catch.hpp"
 
+#include <algorithm>
 #include <deque>
 #include <list>
+#include <map>
+#include <memory_resource>
 #include <set>
+#include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -71,15 +77,16 @@ struct TemplatedWithFunctions : public Counter {
 };
 
 TEMPLATE_PRODUCT_TEST_CASE("ops::unit()", "",
-                           (std::vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
-                            std::unordered_multiset),
+                           (std::vector, SmallVector4, Vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
+                            std::unordered_multiset, PersistentVector, PersistentSet),
                            (int)) {
     TestType result = ops::unit<TestType>(42);
     REQUIRE(result.size() == 1);
     CHECK(*result.begin() == 42);
 }
 
-TEMPLATE_PRODUCT_TEST_CASE("ops::unit()", "", (std::map, std::unordered_map, std::multimap, std::unordered_multimap),
+TEMPLATE_PRODUCT_TEST_CASE("ops::unit()", "",
+                           (std::map, std::unordered_map, std::multimap, std::unordered_multimap, PersistentMap),
                            ((std::string, int))) {
     TestType result;
     SECTION("pair") { result = ops::unit<TestType>(std::make_pair(std::string("abc"), 42)); }
@@ -95,8 +102,8 @@ TEST_CASE("ops::unit() - TemplatedWithFunctions<int>") {
 }
 
 TEMPLATE_PRODUCT_TEST_CASE("ops::map()", "",
-                           (std::vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
-                            std::unordered_multiset),
+                           (std::vector, SmallVector4, Vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
+                            std::unordered_multiset, PersistentVector, PersistentSet),
                            (std::string)) {
     WithInnerType_T<TestType, int> result;
     SECTION("Lvalue") {
@@ -115,7 +122,8 @@ TEMPLATE_PRODUCT_TEST_CASE("ops::map()", "",
     CHECK(result == WithInnerType_T<TestType, int>{1, 2, 3});
 }
 
-TEMPLATE_PRODUCT_TEST_CASE("ops::map()", "", (std::map, std::unordered_map, std::multimap, std::unordered_multimap),
+TEMPLATE_PRODUCT_TEST_CASE("ops::map()", "",
+                           (std::map, std::unordered_map, std::multimap, std::unordered_multimap, PersistentMap),
                            ((std::string, int))) {
     WithInnerType_T<TestType, std::pair<int, std::string>> result;
     SECTION("Lvalue") {
@@ -151,3 +159,241 @@ TEST_CASE("ops::map() - TemplatedWithFunctions<std::string>") {
 
     CHECK(result.value == 3);
 }
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::map() - Parallel", "", (std::vector, std::deque, std::list), (int)) {
+    TestType left;
+    for (int i = 0; i < 100000; ++i)
+        left.push_back(i);
+
+    SECTION("Same type") {
+        TestType expected;
+        for (int i = 0; i < 100000; ++i)
+            expected.push_back(i * 2);
+        TestType result;
+        SECTION("Lvalue") { result = left | ops::map([](int x) { return x * 2; }, cefal::par); }
+        SECTION("Rvalue") { result = std::move(left) | ops::map([](int x) { return x * 2; }, cefal::par); }
+        CHECK(result == expected);
+    }
+    SECTION("Different type") {
+        WithInnerType_T<TestType, double> expected;
+        for (int i = 0; i < 100000; ++i)
+            expected.push_back(i / 2.0);
+        WithInnerType_T<TestType, double> result;
+        SECTION("Lvalue") { result = left | ops::map([](int x) { return x / 2.0; }, cefal::par); }
+        SECTION("Rvalue") { result = std::move(left) | ops::map([](int&& x) { return x / 2.0; }, cefal::par); }
+        CHECK(result == expected);
+    }
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::map() - Parallel", "", (std::set, std::unordered_set, std::multiset, std::unordered_multiset),
+                           (int)) {
+    TestType left;
+    for (int i = 0; i < 30000; ++i)
+        left.insert(i);
+    auto func = [](int x) { return std::to_string(x % 20000); };
+    auto expected = left | ops::map(func);
+    decltype(expected) result;
+    SECTION("Lvalue") { result = left | ops::map(func, cefal::par); }
+    SECTION("Rvalue") { result = std::move(left) | ops::map(func, cefal::par); }
+    CHECK(result == expected);
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::map() - Parallel", "", (std::map, std::unordered_map, std::multimap, std::unordered_multimap),
+                           ((std::string, int))) {
+    TestType left;
+    for (int i = 0; i < 30000; ++i)
+        left.insert({std::to_string(i), i});
+    auto lvalueFunc = [](const std::pair<std::string, int>& x) { return std::make_pair(x.second % 20000, x.first); };
+    auto rvalueFunc = [](std::pair<std::string, int>&& x) { return std::make_pair(x.second % 20000, std::move(x.first)); };
+    auto expected = left | ops::map(lvalueFunc);
+    decltype(expected) result;
+    SECTION("Lvalue") { result = left | ops::map(lvalueFunc, cefal::par); }
+    SECTION("Rvalue") { result = std::move(left) | ops::map(rvalueFunc, cefal::par); }
+    CHECK(result == expected);
+}
+
+TEST_CASE("ops::map() - Parallel - small container") {
+    auto result = std::vector{1, 2, 3} | ops::map([](int x) { return std::to_string(x); }, cefal::par);
+    CHECK(result == std::vector<std::string>{"1", "2", "3"});
+}
+
+TEST_CASE("ops::map() - Parallel - exception") {
+    std::vector<int> left(100000, 1);
+    left[50000] = 0;
+    auto mapper = ops::map(
+        [](int x) {
+            if (!x)
+                throw std::runtime_error("zero");
+            return x;
+        },
+        cefal::par);
+    CHECK_THROWS_AS(left | mapper, std::runtime_error);
+}
+
+TEST_CASE("ops::map() - Hashed destination is reserved") {
+    std::unordered_set<int> left;
+    for (int i = 0; i < 1000; ++i)
+        left.insert(i);
+    std::unordered_set<int> reserved;
+    reserved.reserve(1000);
+    auto result = left | ops::map([](int x) { return x * 2; });
+    CHECK(result.size() == 1000);
+    CHECK(result.bucket_count() == reserved.bucket_count());
+}
+
+TEST_CASE("ops::map() - Allocator instance is carried over") {
+    std::vector<int, TaggedAllocator<int>> left(TaggedAllocator<int>(7));
+    for (int i = 0; i < 10000; ++i)
+        left.push_back(i);
+    SECTION("Lvalue") {
+        auto result = left | ops::map([](int x) { return std::to_string(x); });
+        CHECK((std::is_same_v<decltype(result), std::vector<std::string, TaggedAllocator<std::string>>>));
+        CHECK(result.get_allocator().id == 7);
+        CHECK(result[42] == "42");
+    }
+    SECTION("Rvalue") {
+        auto result = std::move(left) | ops::map([](int x) { return static_cast<long>(x); });
+        CHECK(result.get_allocator().id == 7);
+        CHECK(result[42] == 42);
+    }
+    SECTION("Parallel") {
+        auto result = left | ops::map([](int x) { return static_cast<long>(x) * 2; }, cefal::par);
+        CHECK(result.get_allocator().id == 7);
+        CHECK(result[42] == 84);
+    }
+}
+
+TEST_CASE("ops::map() - Comparator instance is carried over") {
+    std::set<int, FlaggedLess, TaggedAllocator<int>> left(FlaggedLess{true}, TaggedAllocator<int>(7));
+    for (int i = 0; i < 10000; ++i)
+        left.insert(i);
+    auto func = [](int x) { return static_cast<long>(x) * 10; };
+    auto check = [](const std::set<long, FlaggedLess, TaggedAllocator<long>>& result) {
+        CHECK(result.key_comp().reversed);
+        CHECK(result.get_allocator().id == 7);
+        CHECK(*result.begin() == 99990);
+    };
+    SECTION("Lvalue") { check(left | ops::map(func)); }
+    SECTION("Rvalue") { check(std::move(left) | ops::map(func)); }
+    SECTION("Parallel") { check(left | ops::map(func, cefal::par)); }
+}
+
+TEST_CASE("ops::map() - Hasher instance is carried over") {
+    using Set = std::unordered_set<int, SeededHash, std::equal_to<int>, TaggedAllocator<int>>;
+    Set left(0, SeededHash{42}, std::equal_to<int>(), TaggedAllocator<int>(7));
+    for (int i = 0; i < 10000; ++i)
+        left.insert(i);
+    auto check = [](const auto& result) {
+        CHECK(result.hash_function().seed == 42);
+        CHECK(result.get_allocator().id == 7);
+        CHECK(result.size() == 10000);
+    };
+    SECTION("Same inner type") { check(left | ops::map([](int x) { return x * 2; })); }
+    SECTION("Other inner type") { check(left | ops::map([](int x) { return std::to_string(x); })); }
+    SECTION("Rvalue") { check(std::move(left) | ops::map([](int x) { return static_cast<long>(x); })); }
+    SECTION("Parallel") { check(left | ops::map([](int x) { return x * 2; }, cefal::par)); }
+}
+
+TEST_CASE("ops::map() - Map parameters are carried over") {
+    using Allocator = TaggedAllocator<std::pair<const int, std::string>>;
+    std::unordered_map<int, std::string, SeededHash, std::equal_to<int>, Allocator> left(0, SeededHash{42}, std::equal_to<int>(),
+                                                                                          Allocator(7));
+    left.emplace(1, "a");
+    left.emplace(2, "bb");
+    SECTION("Unordered") {
+        auto func = [](const std::pair<int, std::string>& x) { return std::make_pair(x.first, x.second.size()); };
+        auto result = left | ops::map(func);
+        CHECK(result.hash_function().seed == 42);
+        CHECK(result.get_allocator().id == 7);
+        CHECK(result.at(2) == 2);
+    }
+    SECTION("Ordered") {
+        std::map<int, std::string, FlaggedLess> ordered(left.begin(), left.end(), FlaggedLess{true});
+        auto result = ordered | ops::map([](const std::pair<int, std::string>& x) { return std::make_pair(x.second, x.first); });
+        CHECK(result.key_comp().reversed);
+        CHECK(result.begin()->first == "bb");
+    }
+}
+
+TEST_CASE("ops::map() - ArenaScope") {
+    std::pmr::vector<int> left = {1, 2, 3};
+    ArenaScope arena;
+    auto result = left | ops::map([](int x) { return std::to_string(x); });
+    CHECK((std::is_same_v<decltype(result), std::pmr::vector<std::string>>));
+    CHECK(result == std::pmr::vector<std::string>{"1", "2", "3"});
+    CHECK(result.get_allocator().resource() == arena.resource());
+}
+
+TEST_CASE("ops::map() - ArenaScope - Nodes of rvalue source are not relinked into arena") {
+    std::pmr::set<int> result;
+    std::pmr::map<int, std::string> mapResult;
+    {
+        std::pmr::set<int> left = {1, 2, 3};
+        std::pmr::map<int, std::string> leftMap = {{1, "a"}, {2, "b"}};
+        ArenaScope arena;
+        result = std::move(left) | ops::map([](int x) { return x * 2; });
+        mapResult = std::move(leftMap) | ops::map([](std::pair<int, std::string>&& x) {
+                        return std::make_pair(x.first * 2, std::move(x.second));
+                    });
+    }
+    // Read after arena is released, so nodes relinked into it would be dangling
+    CHECK(result == std::pmr::set<int>{2, 4, 6});
+    CHECK(result.get_allocator().resource() == std::pmr::get_default_resource());
+    CHECK(mapResult == std::pmr::map<int, std::string>{{2, "a"}, {4, "b"}});
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::mapSimd()", "",
+                           (std::vector, SmallVector4, Vector, std::deque, std::list), (int, float, double)) {
+    using T = InnerType_T<TestType>;
+    // Sizes around batch width, including ones that leave a tail
+    auto size = GENERATE(0, 1, 3, 16, 17, 100);
+    TestType left;
+    WithInnerType_T<TestType, T> expected;
+    for (int i = 0; i < size; ++i) {
+        left.push_back(static_cast<T>(i));
+        expected.push_back(static_cast<T>(i * 3 + 1));
+    }
+    auto func = [](const Simd<T>& x) { return x * 3 + 1; };
+    WithInnerType_T<TestType, T> result;
+    SECTION("Lvalue") { result = left | ops::mapSimd(func); }
+    SECTION("Rvalue") { result = std::move(left) | ops::mapSimd(func); }
+    CHECK(result == expected);
+}
+
+#if __has_include(<experimental/simd>)
+TEST_CASE("ops::mapSimd() - Different result type") {
+    std::vector<int> left = {1, 2, 3, 4, 5};
+    auto func = [](const Simd<int>& x) { return std::experimental::static_simd_cast<float>(x) / 2.0f; };
+    std::vector<float> result = left | ops::mapSimd(func);
+    CHECK(result == std::vector<float>{0.5f, 1.0f, 1.5f, 2.0f, 2.5f});
+}
+#endif
+
+TEST_CASE("ops::mapSimd() - Tail is padded with real elements") {
+    std::vector<int> left = {10, 20, 30};
+    auto func = [](const Simd<int>& x) { return 60 / x; };
+    CHECK((left | ops::mapSimd(func)) == std::vector<int>{6, 3, 2});
+}
+
+TEST_CASE("ops::unit() - SmallVector") {
+    auto result = ops::unit<SmallVector<std::string, 2>>(std::string("abc"));
+    CHECK(result.isInline());
+    CHECK(result == SmallVector<std::string, 2>{"abc"});
+}
+
+TEST_CASE("ops::map() - SmallVector keeps inline capacity") {
+    SmallVector<std::string, 3> left = {"1", "2", "3"};
+    auto result = left | ops::map([](const std::string& s) { return std::stoi(s); });
+    static_assert(std::is_same_v<decltype(result), SmallVector<int, 3>>);
+    CHECK(result.isInline());
+    CHECK(result == SmallVector<int, 3>{1, 2, 3});
+}
+
+TEST_CASE("ops::map() - Mapped Vector is changed in place") {
+    Vector<int> left(cefal::detail::vectorMappingThreshold / sizeof(int), 1);
+    REQUIRE(left.isMapped());
+    const int* data = left.data();
+    auto result = std::move(left) | ops::map([](int x) { return x + 1; });
+    CHECK(result.data() == data);
+    CHECK(std::all_of(result.begin(), result.end(), [](int x) { return x == 2; }));
+}
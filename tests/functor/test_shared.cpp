@@ -0,0 +1,131 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "counter.h"
+#include "test_helpers.h"
+
+#include "cefal/everything.h"
+
+#include "catch2/catch.hpp"
+
+#include <list>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace cefal;
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::unit()", "", (std::vector, std::list, std::set), (int)) {
+    Shared<TestType> result = ops::unit<Shared<TestType>>(42);
+    REQUIRE(result.size() == 1);
+    CHECK(*result.begin() == 42);
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::map()", "", (std::vector, std::list, std::set), (std::string)) {
+    Shared<WithInnerType_T<TestType, int>> result;
+    SECTION("Lvalue") {
+        auto func = [](const std::string& s) { return std::stoi(s); };
+        const auto left = Shared<TestType>{"1", "2", "3"};
+        SECTION("Pipe") { result = left | ops::map(func); }
+        SECTION("Curried") { result = ops::map(func)(left); }
+        CHECK(left.get() == TestType{"1", "2", "3"});
+    }
+    SECTION("Rvalue") {
+        auto func = [](std::string&& s) { return std::stoi(std::move(s)); };
+        auto left = Shared<TestType>{"1", "2", "3"};
+        SECTION("Unique") { result = std::move(left) | ops::map(func); }
+        SECTION("Shared") {
+            auto snapshot = left;
+            result = std::move(left) | ops::map(func);
+            CHECK(snapshot.get() == TestType{"1", "2", "3"});
+        }
+    }
+    CHECK(result.get() == WithInnerType_T<TestType, int>{1, 2, 3});
+}
+
+TEST_CASE("ops::map() - Unique handle is mapped in place") {
+    auto left = Shared<std::vector<CountedValue>>{1, 2, 3};
+    const CountedValue* data = left->data();
+    Counter::reset();
+    auto result = std::move(left) | ops::map([](CountedValue&& x) {
+                      x.value *= 2;
+                      return std::move(x);
+                  });
+    CHECK(Counter::copied() == 0);
+    CHECK(Counter::created() == 0);
+    CHECK(result->data() == data);
+    CHECK(result.get() == std::vector<CountedValue>{2, 4, 6});
+}
+
+TEST_CASE("ops::map() - Shared handle is left untouched") {
+    auto left = Shared<std::vector<CountedValue>>{1, 2, 3};
+    auto snapshot = left;
+    const CountedValue* data = left->data();
+    Counter::reset();
+    auto result = std::move(left) | ops::map([](const CountedValue& x) { return CountedValue(x.value * 2); });
+    CHECK(Counter::copied() == 0);
+    CHECK(result->data() != data);
+    CHECK(snapshot->data() == data);
+    CHECK(snapshot.get() == std::vector<CountedValue>{1, 2, 3});
+    CHECK(result.get() == std::vector<CountedValue>{2, 4, 6});
+}
+
+TEST_CASE("ops::map() - Handle released by other thread") {
+    auto left = Shared<std::vector<int>>{1, 2, 3};
+    const int* data = left->data();
+    int sum = 0;
+    std::thread reader([copy = left, &sum]() mutable {
+        for (int x : copy)
+            sum += x;
+        copy = Shared<std::vector<int>>();
+    });
+    while (!left.unique())
+        std::this_thread::yield();
+    auto result = std::move(left) | ops::map([](int x) { return x * 2; });
+    reader.join();
+    CHECK(sum == 6);
+    CHECK(result->data() == data);
+    CHECK(result.get() == std::vector<int>{2, 4, 6});
+}
+
+TEST_CASE("ops::map() - Parallel") {
+    std::vector<int> source(10000);
+    for (int i = 0; i < 10000; ++i)
+        source[i] = i;
+    auto left = Shared<std::vector<int>>(source);
+    auto snapshot = left;
+    auto result = left | ops::map([](int x) { return x * 2; }, cefal::par);
+    REQUIRE(result.size() == 10000);
+    for (int i = 0; i < 10000; ++i)
+        CHECK(result.get()[i] == i * 2);
+    CHECK(snapshot.get() == source);
+}
+
+TEST_CASE("ops::flatMap() - Shared<std::vector>") {
+    const auto left = Shared<std::vector<int>>{1, 2};
+    auto result = left | ops::flatMap([](int x) { return Shared<std::vector<int>>{x, x * 10}; });
+    CHECK(result.get() == std::vector<int>{1, 10, 2, 20});
+}
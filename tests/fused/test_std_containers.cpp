@@ -0,0 +1,393 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "cefal/everything.h"
+
+#include "catch2/catch.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <list>
+#include <optional>
+#include <ranges>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+using namespace cefal;
+
+struct WithFunctions {
+    std::string value;
+    static WithFunctions unit(std::string x) { return WithFunctions{std::move(x)}; }
+    template <typename Func>
+    WithFunctions map(Func&& f) const {
+        return WithFunctions{f(value)};
+    }
+};
+
+namespace cefal {
+template <>
+struct InnerType<WithFunctions> {
+    using type = std::string;
+};
+template <>
+struct WithInnerType<WithFunctions, std::string> {
+    using type = WithFunctions;
+};
+} // namespace cefal
+
+TEMPLATE_PRODUCT_TEST_CASE("Fused map | filter | map", "",
+                           (std::vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
+                            std::unordered_multiset),
+                           (std::string)) {
+    WithInnerType_T<TestType, int> result;
+    SECTION("Lvalue") {
+        auto fused = ops::map([](const std::string& s) { return std::stoi(s); }) | ops::filter([](int x) { return x % 2; })
+                     | ops::map([](int x) { return x * 10; });
+        const auto left = TestType{"1", "2", "3", "4", "5"};
+        SECTION("Pipe") { result = left | fused; }
+        SECTION("Curried") { result = fused(left); }
+    }
+    SECTION("Rvalue") {
+        auto fused = ops::map([](std::string&& s) { return std::stoi(std::move(s)); }) | ops::filter([](int x) { return x % 2; })
+                     | ops::map([](int x) { return x * 10; });
+        auto left = TestType{"1", "2", "3", "4", "5"};
+        SECTION("Pipe") { result = std::move(left) | fused; }
+        SECTION("Curried") { result = fused(std::move(left)); }
+    }
+
+    CHECK(result == WithInnerType_T<TestType, int>{10, 30, 50});
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("Fused map | filter | map", "", (std::map, std::unordered_map, std::multimap, std::unordered_multimap),
+                           ((std::string, int))) {
+    using DestType = WithInnerType_T<TestType, std::pair<int, std::string>>;
+    DestType result;
+    auto fused = ops::filter([](const std::pair<const std::string, int>& x) { return x.second != 2; })
+                 | ops::map([](const std::pair<std::string, int>& x) { return std::make_pair(x.second, x.first); })
+                 | ops::map([](const std::pair<int, std::string>& x) { return std::make_pair(x.first * 10, x.second + "!"); });
+    SECTION("Lvalue") {
+        const auto left = TestType{{"abc", 1}, {"de", 2}, {"f", 3}};
+        result = left | fused;
+    }
+    SECTION("Rvalue") {
+        auto left = TestType{{"abc", 1}, {"de", 2}, {"f", 3}};
+        result = std::move(left) | fused;
+    }
+
+    CHECK(result == DestType{{10, "abc!"}, {30, "f!"}});
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("Fused map | flatMap | filter", "",
+                           (std::vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
+                            std::unordered_multiset),
+                           (int)) {
+    TestType result;
+    auto fused = ops::map([](int x) { return x * 10; }) | ops::flatMap([](int x) { return TestType{x + 1, x + 2}; })
+                 | ops::filter([](int x) { return x % 2; });
+    SECTION("Lvalue") {
+        const auto left = TestType{1, 2, 3};
+        result = left | fused;
+    }
+    SECTION("Rvalue") {
+        auto left = TestType{1, 2, 3};
+        result = std::move(left) | fused;
+    }
+
+    CHECK(result == TestType{11, 21, 31});
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("Fused map | filter | foldLeft", "",
+                           (std::vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
+                            std::unordered_multiset),
+                           (int)) {
+    int result = 0;
+    auto fused = ops::map([](int x) { return x * 10; }) | ops::filter([](int x) { return x > 10; })
+                 | ops::foldLeft(1, [](int acc, int x) { return acc + x; });
+    SECTION("Lvalue") {
+        const auto left = TestType{1, 2, 3};
+        result = left | fused;
+    }
+    SECTION("Rvalue") {
+        auto left = TestType{1, 2, 3};
+        result = std::move(left) | fused;
+    }
+
+    CHECK(result == 51);
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("Fused map | filter | foldMap", "",
+                           (std::vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
+                            std::unordered_multiset),
+                           (int)) {
+    Product<int> result;
+    auto fused = ops::map([](int x) { return x * 10; }) | ops::filter([](int x) { return x > 10; })
+                 | ops::foldMap<Product<int>>([](int x) { return x + 1; });
+    SECTION("Lvalue") {
+        const auto left = TestType{1, 2, 3};
+        result = left | fused;
+    }
+    SECTION("Rvalue") {
+        auto left = TestType{1, 2, 3};
+        result = std::move(left) | fused;
+    }
+
+    CHECK(result.value == 651);
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("Fused map | filter | as", "",
+                           (std::vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
+                            std::unordered_multiset),
+                           (int)) {
+    SECTION("Templated") {
+        auto fused = ops::map([](int x) { return x * 10; }) | ops::filter([](int x) { return x > 10; }) | ops::as<std::set>();
+        const auto left = TestType{1, 2, 3};
+        std::set<int> result = left | fused;
+        CHECK(result == std::set<int>{20, 30});
+    }
+    SECTION("Full") {
+        auto fused = ops::map([](int x) { return x * 10; }) | ops::filter([](int x) { return x > 10; }) | ops::as<std::list<int>>();
+        auto left = TestType{1, 2, 3};
+        std::list<int> result = std::move(left) | fused;
+        result.sort();
+        CHECK(result == std::list<int>{20, 30});
+    }
+}
+
+TEST_CASE("Fused ops are applied in single pass") {
+    std::vector<std::string> log;
+    auto fused = ops::map([&log](int x) {
+                     log.push_back("map " + std::to_string(x));
+                     return x + 1;
+                 })
+                 | ops::filter([&log](int x) {
+                       log.push_back("filter " + std::to_string(x));
+                       return x % 2;
+                   })
+                 | ops::map([&log](int x) {
+                       log.push_back("map2 " + std::to_string(x));
+                       return x * 2;
+                   });
+    std::vector<int> result;
+    SECTION("Lvalue") {
+        const auto left = std::vector{1, 2, 3};
+        result = left | fused;
+    }
+    SECTION("Rvalue") { result = std::vector{1, 2, 3} | fused; }
+
+    CHECK(result == std::vector{6});
+    CHECK(log == std::vector<std::string>{"map 1", "filter 2", "map 2", "filter 3", "map2 3", "map 3", "filter 4"});
+}
+
+TEST_CASE("Fused ops composition") {
+    auto first = ops::map([](int x) { return x + 1; }) | ops::filter([](int x) { return x % 2; });
+    auto second = ops::map([](int x) { return x * 2; }) | ops::map([](int x) { return x + 1; });
+    auto fused = first | second;
+    CHECK((std::vector{1, 2, 3, 4} | fused) == std::vector{7, 11});
+    CHECK((std::vector{1, 2, 3, 4} | (fused | ops::foldLeft(0, [](int acc, int x) { return acc + x; }))) == 18);
+}
+
+TEST_CASE("Fused ops fallback") {
+    auto fused = ops::map([](int x) { return x + 1; }) | ops::filter([](int x) { return x % 2; });
+    SECTION("std::optional") {
+        CHECK((std::optional<int>(2) | fused) == std::optional<int>(3));
+        CHECK((std::optional<int>(3) | fused) == std::nullopt);
+        CHECK((std::optional<int>() | fused) == std::nullopt);
+    }
+    SECTION("std::ranges") {
+        auto src = std::vector{1, 2, 3, 4};
+        auto result = std::views::all(src) | fused | ops::foldLeft(std::vector<int>(), [](std::vector<int> acc, int x) {
+                          acc.push_back(x);
+                          return acc;
+                      });
+        CHECK(result == std::vector{3, 5});
+    }
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("Staged map | filter | map", "", (std::vector, std::list, std::deque, std::set), (int)) {
+    TestType left;
+    for (int i = 0; i < 10000; ++i)
+        left.insert(left.end(), i);
+    auto first = ops::map([](int x) { return x * 3; });
+    auto second = ops::filter([](int x) { return x % 2; });
+    auto third = ops::map([](int x) { return std::to_string(x); });
+    auto expected = left | (first | second | third);
+    decltype(expected) result;
+    SECTION("Lvalue") { result = left | (first | ops::stage() | second | third); }
+    SECTION("Rvalue") { result = std::move(left) | (first | ops::stage() | second | third); }
+    SECTION("Stage per op") { result = left | (first | ops::stage() | second | ops::stage() | third); }
+    SECTION("Leading stage") { result = left | (ops::stage() | first | second | third); }
+    SECTION("Trailing stage") { result = left | (first | second | third | ops::stage()); }
+    CHECK(result == expected);
+}
+
+TEST_CASE("Staged fallback") {
+    auto suffix = ops::map([](std::string x) { return x + " and a long enough suffix to live on heap"; });
+    SECTION("std::optional") {
+        std::optional<std::string> expected = "value and a long enough suffix to live on heap";
+        CHECK((std::optional<std::string>("value") | (suffix | ops::stage())) == expected);
+        CHECK((std::optional<std::string>("value") | (ops::stage() | suffix)) == expected);
+        std::optional<std::string> left = "value";
+        CHECK((left | (suffix | ops::stage() | suffix)) == (expected | suffix));
+        CHECK((left | ops::stage()) == left);
+    }
+    SECTION("With functions") {
+        auto result = WithFunctions{"value"} | (suffix | ops::stage());
+        CHECK(result.value == "value and a long enough suffix to live on heap");
+    }
+}
+
+TEST_CASE("Staged segments run on separate threads in order") {
+    std::vector<int> left;
+    for (int i = 0; i < 10000; ++i)
+        left.push_back(i);
+    // Each segment is run by single thread, so it can keep unsynchronized state
+    std::set<std::thread::id> firstThreads;
+    std::set<std::thread::id> secondThreads;
+    std::vector<int> seen;
+    auto fused = ops::map([&firstThreads](int x) {
+                     firstThreads.insert(std::this_thread::get_id());
+                     return x + 1;
+                 })
+                 | ops::stage() | ops::map([&secondThreads, &seen](int x) {
+                       secondThreads.insert(std::this_thread::get_id());
+                       seen.push_back(x);
+                       return x;
+                   })
+                 | ops::foldLeft(0ll, [](long long acc, int x) { return acc + x; });
+    CHECK((left | fused) == 50005000ll);
+    CHECK(firstThreads.size() == 1);
+    CHECK(secondThreads.size() == 1);
+    CHECK(*firstThreads.begin() != *secondThreads.begin());
+    CHECK(seen.size() == 10000);
+    CHECK(std::ranges::is_sorted(seen));
+}
+
+TEST_CASE("Staged inside busy thread pool") {
+    std::vector<int> left;
+    for (int i = 0; i < 10000; ++i)
+        left.push_back(i);
+    auto fused = ops::map([](int x) { return x + 1; }) | ops::stage() | ops::filter([](int x) { return x % 2; }) | ops::stage()
+                 | ops::foldLeft(0ll, [](long long acc, int x) { return acc + x; });
+    // Every worker is busy with its own pipeline, so segments can't all wait for idle workers
+    auto& pool = cefal::detail::ThreadPool::instance();
+    std::vector<long long> results(pool.concurrency() * 2);
+    pool.run(results.size(), [&left, &fused, &results](size_t i) { results[i] = left | fused; });
+    CHECK(std::ranges::all_of(results, [](long long x) { return x == 25000000ll; }));
+}
+
+TEST_CASE("Staged with terminals") {
+    auto fused = ops::flatMap([](int x) { return std::vector{x, x + 1}; }) | ops::stage() | ops::filter([](int x) { return x > 1; });
+    CHECK((std::vector{1, 2, 3} | (fused | ops::as<std::set>())) == std::set{2, 3, 4});
+    CHECK((std::vector{1, 2, 3} | (fused | ops::foldMap<Sum<int>>([](int x) { return x; }))).value == 14);
+    CHECK((std::vector<int>() | fused).empty());
+}
+
+TEST_CASE("Staged exceptions") {
+    std::vector<int> left(10000, 1);
+    left[5000] = 0;
+    auto thrower = [](int x) {
+        if (!x)
+            throw std::runtime_error("zero");
+        return x;
+    };
+    auto identity = [](int x) { return x; };
+    SECTION("First segment") { CHECK_THROWS_AS(left | (ops::map(thrower) | ops::stage() | ops::map(identity)), std::runtime_error); }
+    SECTION("Middle segment") {
+        CHECK_THROWS_AS(left | (ops::map(identity) | ops::stage() | ops::map(thrower) | ops::stage() | ops::map(identity)),
+                        std::runtime_error);
+    }
+    SECTION("Last segment") { CHECK_THROWS_AS(left | (ops::map(identity) | ops::stage() | ops::map(thrower)), std::runtime_error); }
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("Fused map | filter | into", "", (std::vector, std::list, std::deque, std::set, std::unordered_set), (int)) {
+    TestType dest = {100, 200};
+    auto chain = ops::map([](int x) { return x * 2; }) | ops::filter([](int x) { return x % 3; }) | ops::into(dest);
+    std::vector<int> left = {1, 2, 3, 4, 5};
+    SECTION("Lvalue") {
+        TestType& result = left | chain;
+        CHECK(&result == &dest);
+    }
+    SECTION("Rvalue") { std::move(left) | chain; }
+    CHECK(dest == TestType{2, 4, 8, 10});
+}
+
+TEST_CASE("Fused into doesn't reallocate") {
+    std::vector<std::string> dest;
+    for (int i = 0; i < 5; ++i) {
+        std::vector<int> left = {1, 2, 3, 4, i};
+        left | (ops::map([](int x) { return std::to_string(x * 1000000); }) | ops::into(dest));
+        CHECK(dest.size() == 5);
+    }
+    const std::string* data = dest.data();
+    std::vector<int> left = {4, 3, 2, 1, 0};
+    left | (ops::map([](int x) { return std::to_string(x * 1000000); }) | ops::into(dest));
+    CHECK(dest.data() == data);
+    CHECK(dest[0] == "4000000");
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("Fused mapMaybe | map", "", (std::vector, std::list, std::deque, std::set), (int)) {
+    auto chain = ops::mapMaybe([](int x) { return x % 2 ? std::optional<std::string>(std::to_string(x)) : std::nullopt; })
+                 | ops::map([](std::string&& x) { return x + "!"; });
+    const TestType left = {1, 2, 3};
+    WithInnerType_T<TestType, std::string> result = left | chain;
+    CHECK(result == WithInnerType_T<TestType, std::string>{"1!", "3!"});
+}
+
+TEST_CASE("Fused chain stops on Reduced") {
+    std::vector<int> left = {1, 2, 3, 4, 5, 6};
+    int mapped = 0;
+    auto tenfold = ops::map([&mapped](int x) {
+        ++mapped;
+        return x * 10;
+    });
+    SECTION("foldLeft") {
+        auto firstAbove = [](int, int x) { return x > 25 ? reduced(x) : Reduced<int>(0); };
+        CHECK((left | (tenfold | ops::foldLeft(0, firstAbove))) == 30);
+        CHECK(mapped == 3);
+    }
+    SECTION("foldWhile") {
+        auto sum = ops::foldWhile(0, [](int acc) { return acc < 50; }, [](int acc, int x) { return acc + x; });
+        CHECK((left | (tenfold | sum)) == 60);
+        CHECK(mapped == 3);
+    }
+    SECTION("foldWhile with initial value failing condition") {
+        auto sum = ops::foldWhile(100, [](int acc) { return acc < 50; }, [](int acc, int x) { return acc + x; });
+        CHECK((left | (tenfold | sum)) == 100);
+        CHECK(mapped == 0);
+    }
+    SECTION("Staged") {
+        auto sum = ops::foldWhile(0, [](int acc) { return acc < 50; }, [](int acc, int x) { return acc + x; });
+        CHECK((left | (tenfold | ops::stage() | sum)) == 60);
+    }
+}
+
+TEST_CASE("Fused filter with placeholder expression") {
+    auto fused = ops::map([](int x) { return x * 2; }) | ops::filter(_1 > 4 && _1 % 3 == 0);
+    CHECK((std::vector{1, 2, 3, 4, 5, 6} | fused) == std::vector{6, 12});
+}
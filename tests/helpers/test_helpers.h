@@ -25,7 +25,13 @@
 
 #pragma once
 
+#include "cefal/containers/small_vector.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
 #include <string>
+#include <unordered_set>
 
 template <typename T>
 T createValue(int seed = 0);
@@ -39,3 +45,101 @@ template <>
 std::string createValue<std::string>(int seed) {
     return "abc_" + std::to_string(seed);
 }
+
+// Counts every allocation, so reallocations of growing vector-like containers can be checked
+struct Allocations {
+    inline static size_t count = 0;
+};
+
+template <typename T>
+struct CountingAllocator {
+    using value_type = T;
+
+    CountingAllocator() = default;
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        ++Allocations::count;
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T* p, size_t n) noexcept { std::allocator<T>().deallocate(p, n); }
+
+    template <typename U>
+    bool operator==(const CountingAllocator<U>&) const noexcept {
+        return true;
+    }
+};
+
+// Hashed containers allocate nodes one by one, so allocations of several elements at once are bucket arrays.
+// Their count is how many times container was rehashed
+struct ArrayAllocations {
+    inline static size_t count = 0;
+};
+
+template <typename T>
+struct ArrayCountingAllocator {
+    using value_type = T;
+
+    ArrayCountingAllocator() = default;
+    template <typename U>
+    ArrayCountingAllocator(const ArrayCountingAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        if (n > 1)
+            ++ArrayAllocations::count;
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T* p, size_t n) noexcept { std::allocator<T>().deallocate(p, n); }
+
+    template <typename U>
+    bool operator==(const ArrayCountingAllocator<U>&) const noexcept {
+        return true;
+    }
+};
+
+template <typename T>
+using CountedUnorderedSet = std::unordered_set<T, std::hash<T>, std::equal_to<T>, ArrayCountingAllocator<T>>;
+
+// Allocator with state, tagged with id of the pool it would allocate from.
+// Default constructed one has id 0, so allocator replaced with default one on the way is detected
+template <typename T>
+struct TaggedAllocator {
+    using value_type = T;
+
+    TaggedAllocator() noexcept = default;
+    explicit TaggedAllocator(int id) noexcept : id(id) {}
+    template <typename U>
+    TaggedAllocator(const TaggedAllocator<U>& other) noexcept : id(other.id) {}
+
+    T* allocate(size_t n) { return std::allocator<T>().allocate(n); }
+    void deallocate(T* p, size_t n) noexcept { std::allocator<T>().deallocate(p, n); }
+
+    template <typename U>
+    bool operator==(const TaggedAllocator<U>& other) const noexcept {
+        return id == other.id;
+    }
+
+    int id = 0;
+};
+
+// Functors with state, so they can be told apart from default constructed ones
+struct SeededHash {
+    size_t seed = 0;
+    template <typename T>
+    size_t operator()(const T& x) const noexcept {
+        return std::hash<T>()(x) ^ seed;
+    }
+};
+
+struct FlaggedLess {
+    bool reversed = false;
+    template <typename T>
+    bool operator()(const T& left, const T& right) const {
+        return reversed ? right < left : left < right;
+    }
+};
+
+// Single parameter alias, so SmallVector can be used in TEMPLATE_PRODUCT_TEST_CASE lists along with std containers
+template <typename T>
+using SmallVector4 = cefal::SmallVector<T, 4>;
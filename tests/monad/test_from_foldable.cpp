@@ -24,13 +24,16 @@
  */
 
 #include "counter.h"
+#include "test_helpers.h"
 
 #include "cefal/everything.h"
 
 #include "catch2/catch.hpp"
 
+#include <bit>
 #include <deque>
 #include <list>
+#include <memory_resource>
 #include <set>
 #include <string>
 #include <unordered_set>
@@ -71,8 +74,8 @@ struct TemplatedWithFunctions : public Counter {
 };
 
 TEMPLATE_PRODUCT_TEST_CASE("ops::flatMap()", "",
-                           (std::vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
-                            std::unordered_multiset),
+                           (std::vector, SmallVector4, Vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
+                            std::unordered_multiset, PersistentVector, PersistentSet),
                            (std::string)) {
     WithInnerType_T<TestType, int> result;
     SECTION("Lvalue") {
@@ -91,7 +94,8 @@ TEMPLATE_PRODUCT_TEST_CASE("ops::flatMap()", "",
     CHECK(result == WithInnerType_T<TestType, int>{1, 2, 3});
 }
 
-TEMPLATE_PRODUCT_TEST_CASE("ops::flatMap()", "", (std::map, std::unordered_map, std::multimap, std::unordered_multimap),
+TEMPLATE_PRODUCT_TEST_CASE("ops::flatMap()", "",
+                           (std::map, std::unordered_map, std::multimap, std::unordered_multimap, PersistentMap),
                            ((std::string, int))) {
     using DestType = WithInnerType_T<TestType, std::pair<int, std::string>>;
     DestType result;
@@ -128,3 +132,120 @@ TEST_CASE("ops::flatMap() - TemplatedWithFunctions<std::string>") {
 
     CHECK(result.value == 3);
 }
+
+TEST_CASE("ops::flatMap() - Vector results are amortized linear") {
+    constexpr size_t count = 2000;
+    std::vector<int, CountingAllocator<int>> left(count, 1);
+    using Container = std::vector<CountedValue, CountingAllocator<CountedValue>>;
+    auto func = [](int x) {
+        Container result;
+        result.reserve(3);
+        for (int i = 0; i < 3; ++i)
+            result.emplace_back(x);
+        return result;
+    };
+    Counter::reset();
+    Allocations::count = 0;
+    Container result;
+    SECTION("Lvalue") { result = left | ops::flatMap(func); }
+    SECTION("Rvalue") { result = std::move(left) | ops::flatMap(func); }
+    CHECK(result.size() == 3 * count);
+    CHECK(Counter::created() == 3 * count);
+    CHECK(Counter::copied() == 0);
+    // One move into result and less than two moves due to reallocations per element on average
+    CHECK(Counter::moved() < 3 * 3 * count);
+    // One allocation per inner container, result itself is reallocated only logarithmic number of times
+    CHECK(Allocations::count <= count + std::bit_width(3 * count) + 1);
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::flatMap() - Parallel", "", (std::vector, std::deque, std::list), (int, std::string)) {
+    using InnerType = typename TestType::value_type;
+    auto toInt = [](const InnerType& x) {
+        if constexpr (std::is_same_v<InnerType, std::string>)
+            return std::stoi(x);
+        else
+            return x;
+    };
+    auto fromInt = [](int x) {
+        if constexpr (std::is_same_v<InnerType, std::string>)
+            return std::to_string(x);
+        else
+            return x;
+    };
+    auto func = [toInt, fromInt](const InnerType& x) {
+        TestType result;
+        for (int i = 0, value = toInt(x); i < value % 5; ++i)
+            result.push_back(fromInt(value * 10 + i));
+        return result;
+    };
+
+    TestType left;
+    TestType expected;
+    for (int i = 0; i < 20000; ++i) {
+        left.push_back(fromInt(i));
+        for (auto&& x : func(fromInt(i)))
+            expected.push_back(x);
+    }
+
+    TestType result;
+    SECTION("Lvalue") { result = left | ops::flatMap(func, cefal::par); }
+    SECTION("Rvalue") { result = std::move(left) | ops::flatMap(func, cefal::par); }
+    CHECK(result == expected);
+}
+
+TEST_CASE("ops::flatMap() - Parallel - empty results") {
+    std::vector<int> left(10000, 1);
+    auto result = left | ops::flatMap([](int) { return std::vector<int>(); }, cefal::par);
+    CHECK(result.empty());
+}
+
+TEST_CASE("ops::flatMap() - Parallel - not default constructible") {
+    struct Value {
+        explicit Value(int x) : x(x) {}
+        int x;
+        bool operator==(const Value&) const = default;
+    };
+    std::vector<int> left(10000);
+    std::vector<Value> expected;
+    for (int i = 0; i < 10000; ++i) {
+        left[i] = i;
+        expected.emplace_back(i);
+        expected.emplace_back(-i);
+    }
+    auto func = [](int x) { return std::vector<Value>{Value(x), Value(-x)}; };
+    static_assert(requires { instances::Monad<std::vector<int>>::flatMap(left, func, cefal::par); },
+                  "Parallel overload should be selected");
+    auto result = left | ops::flatMap(func, cefal::par);
+    CHECK(result == expected);
+}
+
+TEST_CASE("ops::flatMap() - Parallel - ArenaScope is not used") {
+    struct Value {
+        explicit Value(int x) : x(x) {}
+        int x;
+    };
+    std::pmr::vector<int> left(10000, 1);
+    SECTION("Random access") {
+        cefal::ArenaScope arena;
+        auto result = left | ops::flatMap([](int x) { return std::pmr::vector<int>{x, -x}; }, cefal::par);
+        CHECK(result.size() == 20000);
+        CHECK(result.get_allocator().resource() == std::pmr::get_default_resource());
+    }
+    SECTION("Not default constructible") {
+        cefal::ArenaScope arena;
+        auto result = left | ops::flatMap([](int x) { return std::pmr::vector<Value>{Value(x), Value(-x)}; }, cefal::par);
+        CHECK(result.size() == 20000);
+        CHECK(result.get_allocator().resource() == std::pmr::get_default_resource());
+    }
+}
+
+TEST_CASE("ops::flatMap() - SmallVector results stay inline") {
+    const SmallVector<int, 4> left = {1, 2, 3};
+    auto result = left | ops::flatMap([](int x) {
+                      SmallVector<int, 4> part = {x, x * 10};
+                      CHECK(part.isInline());
+                      return part;
+                  });
+    CHECK(!result.isInline());
+    CHECK(result == SmallVector<int, 4>{1, 10, 2, 20, 3, 30});
+}
@@ -27,6 +27,7 @@
 
 #include "catch2/catch.hpp"
 
+#include <limits>
 #include <string>
 
 using namespace cefal;
@@ -44,6 +45,16 @@ TEMPLATE_TEST_CASE("ops::empty() - Product", "", uint16_t, int16_t, uint32_t, in
     CHECK(ops::empty<cefal::Product<TestType>>() == Approx(TestType(1)));
 }
 
+TEMPLATE_TEST_CASE("ops::empty() - Min", "", uint16_t, int16_t, uint32_t, int32_t, uint64_t, int64_t, float, double, char) {
+    CHECK(ops::empty<cefal::Min<TestType>>().value >= std::numeric_limits<TestType>::max());
+    CHECK(cefal::Min<TestType>().value == ops::empty<cefal::Min<TestType>>().value);
+}
+
+TEMPLATE_TEST_CASE("ops::empty() - Max", "", uint16_t, int16_t, uint32_t, int32_t, uint64_t, int64_t, float, double, char) {
+    CHECK(ops::empty<cefal::Max<TestType>>().value <= std::numeric_limits<TestType>::lowest());
+    CHECK(cefal::Max<TestType>().value == ops::empty<cefal::Max<TestType>>().value);
+}
+
 TEST_CASE("ops::append() - std::string") {
     SECTION("Lvalue - LValue") {
         const auto left = std::string("abc");
@@ -79,3 +90,15 @@ TEMPLATE_TEST_CASE("ops::append() - Product", "", uint16_t, int16_t, uint32_t, i
                    char) {
     CHECK((Product(TestType(5)) | ops::append(Product(TestType(3)))) == Approx(TestType(15)));
 }
+
+TEMPLATE_TEST_CASE("ops::append() - Min", "", uint16_t, int16_t, uint32_t, int32_t, uint64_t, int64_t, float, double, char) {
+    CHECK((Min(TestType(5)) | ops::append(Min(TestType(3)))) == Approx(TestType(3)));
+    CHECK((Min(TestType(3)) | ops::append(Min(TestType(5)))) == Approx(TestType(3)));
+    CHECK((ops::empty<Min<TestType>>() | ops::append(Min(TestType(5)))) == Approx(TestType(5)));
+}
+
+TEMPLATE_TEST_CASE("ops::append() - Max", "", uint16_t, int16_t, uint32_t, int32_t, uint64_t, int64_t, float, double, char) {
+    CHECK((Max(TestType(5)) | ops::append(Max(TestType(3)))) == Approx(TestType(5)));
+    CHECK((Max(TestType(3)) | ops::append(Max(TestType(5)))) == Approx(TestType(5)));
+    CHECK((ops::empty<Max<TestType>>() | ops::append(Max(TestType(3)))) == Approx(TestType(3)));
+}
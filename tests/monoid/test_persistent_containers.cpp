@@ -0,0 +1,320 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "counter.h"
+#include "test_helpers.h"
+
+#include "cefal/everything.h"
+
+#include "catch2/catch.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace cefal;
+
+namespace {
+template <typename T>
+PersistentVector<T> createPersistent(int begin, int end) {
+    PersistentVector<T> result;
+    for (int i = begin; i < end; ++i) {
+        if constexpr (std::is_same_v<T, CountedValue>)
+            result.push_back(CountedValue(i));
+        else
+            result.push_back(createValue<T>(i));
+    }
+    return result;
+}
+
+template <typename T>
+std::vector<T> createStd(int begin, int end) {
+    std::vector<T> result;
+    for (int i = begin; i < end; ++i)
+        result.push_back(createValue<T>(i));
+    return result;
+}
+} // namespace
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::empty()", "", (PersistentVector, PersistentSet), (int, std::string)) {
+    TestType result = ops::empty<TestType>();
+    CHECK(result.empty());
+    CHECK(result.size() == 0);
+    CHECK(result.begin() == result.end());
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::append() - Both", "", (PersistentVector, PersistentSet), (int, std::string)) {
+    using InnerType = typename TestType::value_type;
+    TestType result;
+    SECTION("Lvalue - LValue") {
+        const auto left = TestType{createValue<InnerType>(1)};
+        const auto right = TestType{createValue<InnerType>(2)};
+        result = left | ops::append(right);
+    }
+    SECTION("Lvalue - RValue") {
+        const auto left = TestType{createValue<InnerType>(1)};
+        auto right = TestType{createValue<InnerType>(2)};
+        result = left | ops::append(std::move(right));
+    }
+    SECTION("Rvalue - LValue") {
+        auto left = TestType{createValue<InnerType>(1)};
+        const auto right = TestType{createValue<InnerType>(2)};
+        result = std::move(left) | ops::append(right);
+    }
+    SECTION("Rvalue - RValue") {
+        auto left = TestType{createValue<InnerType>(1)};
+        auto right = TestType{createValue<InnerType>(2)};
+        result = std::move(left) | ops::append(std::move(right));
+    }
+    CHECK(result == TestType{createValue<InnerType>(1), createValue<InnerType>(2)});
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::append() - Empty side", "", (PersistentVector, PersistentSet), (int, std::string)) {
+    using InnerType = typename TestType::value_type;
+    CHECK((TestType{createValue<InnerType>(1)} | ops::append(TestType())) == TestType{createValue<InnerType>(1)});
+    CHECK((TestType() | ops::append(TestType{createValue<InnerType>(1)})) == TestType{createValue<InnerType>(1)});
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::append() - Singleton", "", (PersistentVector, PersistentSet), (int, std::string)) {
+    using InnerType = typename TestType::value_type;
+    const auto left = TestType{createValue<InnerType>(1)};
+    TestType result = left | ops::append(helpers::SingletonFrom<TestType>{createValue<InnerType>(2)});
+    CHECK(result == TestType{createValue<InnerType>(1), createValue<InnerType>(2)});
+    CHECK(left == TestType{createValue<InnerType>(1)});
+}
+
+TEMPLATE_TEST_CASE("ops::append() - Large vectors", "", int, std::string) {
+    // Sizes around leaf and node capacities, so seams are at different levels and nodes need rebalancing
+    auto leftSize = GENERATE(1, 31, 32, 33, 1000, 1025, 40000);
+    auto rightSize = GENERATE(1, 17, 32, 65, 1024, 33000);
+    const auto left = createPersistent<TestType>(0, leftSize);
+    const auto right = createPersistent<TestType>(leftSize, leftSize + rightSize);
+    auto result = left | ops::append(right);
+    auto expected = createStd<TestType>(0, leftSize + rightSize);
+    REQUIRE(result.size() == expected.size());
+    CHECK(std::equal(result.begin(), result.end(), expected.begin()));
+    for (size_t i = 0; i < expected.size(); i += 97)
+        CHECK(result[i] == expected[i]);
+    CHECK(left.size() == static_cast<size_t>(leftSize));
+    CHECK(right.size() == static_cast<size_t>(rightSize));
+}
+
+TEST_CASE("ops::append() - Repeated concatenation of small pieces") {
+    auto pieceSize = GENERATE(1, 5, 31, 33, 63, 100);
+    PersistentVector<int> result;
+    std::vector<int> expected;
+    for (int i = 0; i < 2000; ++i) {
+        const auto piece = createPersistent<int>(i * pieceSize, (i + 1) * pieceSize);
+        if (i % 2) {
+            result = result | ops::append(piece);
+        } else {
+            const auto left = result;
+            result = left | ops::append(piece);
+        }
+    }
+    expected = createStd<int>(0, 2000 * pieceSize);
+    REQUIRE(result.size() == expected.size());
+    CHECK(std::equal(result.begin(), result.end(), expected.begin()));
+    for (size_t i = 0; i < expected.size(); i += 13)
+        CHECK(result[i] == expected[i]);
+}
+
+TEST_CASE("ops::append() - Nodes are shared") {
+    const auto left = createPersistent<CountedValue>(0, 20000);
+    const auto right = createPersistent<CountedValue>(20000, 40000);
+    Counter::reset();
+    auto result = left | ops::append(right);
+    // Only nodes along the seam can be rebuilt
+    CHECK(Counter::copied() < 200);
+    CHECK(result.size() == 40000);
+    CHECK(result[19999].value == 19999);
+    CHECK(result[20000].value == 20000);
+}
+
+TEST_CASE("PersistentVector - Snapshots") {
+    auto current = createPersistent<std::string>(0, 1000);
+    std::vector<PersistentVector<std::string>> history;
+    for (int i = 0; i < 100; ++i) {
+        history.push_back(current);
+        current = current.set(i * 10, "changed");
+        current.push_back(createValue<std::string>(1000 + i));
+    }
+    for (int i = 0; i < 100; ++i) {
+        REQUIRE(history[i].size() == static_cast<size_t>(1000 + i));
+        CHECK(history[i][i * 10] == createValue<std::string>(i * 10));
+        if (i)
+            CHECK(history[i][(i - 1) * 10] == "changed");
+        CHECK(history[i].back() == createValue<std::string>(i ? 999 + i : 999));
+    }
+    CHECK(current.size() == 1100);
+    CHECK(current[990] == "changed");
+}
+
+TEST_CASE("PersistentVector - Unique nodes are changed in place") {
+    auto vector = createPersistent<CountedValue>(0, 1000);
+    Counter::reset();
+    vector.push_back(CountedValue(1000));
+    vector = std::move(vector).set(10, CountedValue(-1));
+    CHECK(Counter::copied() == 0);
+    const auto snapshot = vector;
+    vector.push_back(CountedValue(1001));
+    // Only last leaf is copied
+    CHECK(Counter::copied() <= detail::persistentVectorBranching);
+    CHECK(snapshot.size() == 1001);
+    CHECK(vector.size() == 1002);
+    CHECK(vector[10].value == -1);
+}
+
+TEMPLATE_TEST_CASE("ops::empty() - PersistentMap", "", int, std::string) {
+    auto result = ops::empty<PersistentMap<TestType, int>>();
+    CHECK(result.empty());
+    CHECK(result.begin() == result.end());
+}
+
+TEMPLATE_TEST_CASE("ops::append() - PersistentMap", "", int, std::string) {
+    using Map = PersistentMap<TestType, int>;
+    Map result;
+    SECTION("Lvalue - LValue") {
+        const auto left = Map{{createValue<TestType>(1), 1}, {createValue<TestType>(2), 2}};
+        const auto right = Map{{createValue<TestType>(2), 20}, {createValue<TestType>(3), 30}};
+        result = left | ops::append(right);
+        CHECK(left.size() == 2);
+        CHECK(right.size() == 2);
+    }
+    SECTION("Rvalue - RValue") {
+        auto left = Map{{createValue<TestType>(1), 1}, {createValue<TestType>(2), 2}};
+        auto right = Map{{createValue<TestType>(2), 20}, {createValue<TestType>(3), 30}};
+        result = std::move(left) | ops::append(std::move(right));
+    }
+    SECTION("Smaller left side") {
+        const auto left = Map{{createValue<TestType>(2), 2}};
+        const auto right = Map{{createValue<TestType>(1), 1}, {createValue<TestType>(2), 20}, {createValue<TestType>(3), 30}};
+        result = left | ops::append(right);
+        result = result.set(createValue<TestType>(1), 1);
+    }
+    // Left side wins, as for std maps
+    CHECK(result == Map{{createValue<TestType>(1), 1}, {createValue<TestType>(2), 2}, {createValue<TestType>(3), 30}});
+}
+
+TEMPLATE_TEST_CASE("ops::append() - PersistentMap - Singleton", "", int, std::string) {
+    using Map = PersistentMap<TestType, int>;
+    const auto left = Map{{createValue<TestType>(1), 1}};
+    Map result = left | ops::append(helpers::SingletonFrom<Map>{std::make_pair(createValue<TestType>(2), 2)});
+    CHECK(result == Map{{createValue<TestType>(1), 1}, {createValue<TestType>(2), 2}});
+    result = result | ops::append(helpers::SingletonFrom<Map>{std::make_pair(createValue<TestType>(2), 20)});
+    CHECK(result.at(createValue<TestType>(2)) == 2);
+    CHECK(left == Map{{createValue<TestType>(1), 1}});
+}
+
+TEMPLATE_TEST_CASE("ops::append() - Large hash containers", "", int, std::string) {
+    auto leftSize = GENERATE(1, 32, 1000, 40000);
+    auto rightSize = GENERATE(1, 33, 1024, 33000);
+    PersistentMap<TestType, int> left;
+    PersistentMap<TestType, int> right;
+    for (int i = 0; i < leftSize; ++i)
+        left.insert(std::make_pair(createValue<TestType>(i), i));
+    // Half of right keys overlap with left ones
+    for (int i = leftSize / 2; i < leftSize / 2 + rightSize; ++i)
+        right.insert(std::make_pair(createValue<TestType>(i), -i));
+    auto result = left | ops::append(right);
+    REQUIRE(result.size() == static_cast<size_t>(std::max(leftSize, leftSize / 2 + rightSize)));
+    for (int i = 0; i < leftSize / 2 + rightSize; i += 7)
+        CHECK(result.at(createValue<TestType>(i)) == (i < leftSize ? i : -i));
+    CHECK(std::distance(result.begin(), result.end()) == static_cast<ptrdiff_t>(result.size()));
+    CHECK(left.size() == static_cast<size_t>(leftSize));
+    CHECK(right.size() == static_cast<size_t>(rightSize));
+}
+
+TEST_CASE("ops::append() - Trie nodes are shared") {
+    PersistentMap<int, CountedValue> left;
+    for (int i = 0; i < 20000; ++i)
+        left.insert(std::make_pair(i, CountedValue(i)));
+    Counter::reset();
+    using Singleton = helpers::SingletonFrom<PersistentMap<int, CountedValue>>;
+    auto result = left | ops::append(Singleton{std::make_pair(20000, CountedValue(1))});
+    // Only nodes on the path to new entry are copied
+    CHECK(Counter::copied() < 4 * detail::persistentHashTrieBranching);
+    CHECK(result.size() == 20001);
+    CHECK(left.size() == 20000);
+    CHECK(!left.contains(20000));
+}
+
+TEST_CASE("PersistentMap - Snapshots") {
+    PersistentMap<std::string, int> current;
+    for (int i = 0; i < 1000; ++i)
+        current.insert(std::make_pair(createValue<std::string>(i), i));
+    std::vector<PersistentMap<std::string, int>> history;
+    for (int i = 0; i < 100; ++i) {
+        history.push_back(current);
+        current = current.set(createValue<std::string>(i), -1);
+        current.erase(createValue<std::string>(500 + i));
+    }
+    for (int i = 0; i < 100; ++i) {
+        REQUIRE(history[i].size() == static_cast<size_t>(1000 - i));
+        CHECK(history[i].at(createValue<std::string>(i)) == i);
+        CHECK(history[i].contains(createValue<std::string>(500 + i)));
+        if (i) {
+            CHECK(history[i].at(createValue<std::string>(i - 1)) == -1);
+            CHECK(!history[i].contains(createValue<std::string>(499 + i)));
+        }
+    }
+    CHECK(current.size() == 900);
+    CHECK(current.find(createValue<std::string>(500)) == current.end());
+    CHECK(current.find(createValue<std::string>(99))->second == -1);
+}
+
+TEST_CASE("PersistentMap - Unique nodes are changed in place") {
+    PersistentMap<int, CountedValue> map;
+    for (int i = 0; i < 1000; ++i)
+        map.insert(std::make_pair(i, CountedValue(i)));
+    Counter::reset();
+    map = std::move(map).set(10, CountedValue(-1));
+    map.erase(20);
+    CHECK(Counter::copied() == 0);
+    const auto snapshot = map;
+    map = std::move(map).set(30, CountedValue(-1));
+    CHECK(Counter::copied() < 4 * detail::persistentHashTrieBranching);
+    CHECK(snapshot.at(30).value == 30);
+    CHECK(map.at(30).value == -1);
+    CHECK(map.at(10).value == -1);
+}
+
+TEST_CASE("PersistentSet - Hash collisions") {
+    struct CollidingHash {
+        size_t operator()(int x) const { return static_cast<size_t>(x % 3); }
+    };
+    PersistentSet<int, CollidingHash> set;
+    for (int i = 0; i < 300; ++i)
+        set.insert(i);
+    const auto snapshot = set;
+    for (int i = 0; i < 300; i += 2)
+        set.erase(i);
+    CHECK(set.size() == 150);
+    CHECK(snapshot.size() == 300);
+    for (int i = 0; i < 300; ++i) {
+        CHECK(set.contains(i) == (i % 2 == 1));
+        CHECK(snapshot.contains(i));
+    }
+    CHECK((set | ops::append(snapshot)) == snapshot);
+}
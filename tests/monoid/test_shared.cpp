@@ -0,0 +1,92 @@
+/* Copyright 2020, Dennis Kormalev
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of the copyright holders nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "counter.h"
+#include "test_helpers.h"
+
+#include "cefal/everything.h"
+
+#include "catch2/catch.hpp"
+
+#include <list>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace cefal;
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::empty()", "", (std::vector, std::list, std::set), (int)) {
+    auto result = ops::empty<Shared<TestType>>();
+    CHECK(result.empty());
+    CHECK(result.get() == TestType());
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::append()", "", (std::vector, std::list, std::set), (int)) {
+    auto left = Shared<TestType>{1, 2, 3};
+    auto right = Shared<TestType>{4, 5};
+    Shared<TestType> result;
+    SECTION("Lvalue") {
+        result = left | ops::append(right);
+        CHECK(left.get() == TestType{1, 2, 3});
+        CHECK(right.get() == TestType{4, 5});
+    }
+    SECTION("Rvalue") { result = std::move(left) | ops::append(std::move(right)); }
+    SECTION("Shared") {
+        auto snapshot = left;
+        result = std::move(left) | ops::append(right);
+        CHECK(snapshot.get() == TestType{1, 2, 3});
+        CHECK(right.get() == TestType{4, 5});
+    }
+    CHECK(result.get() == TestType{1, 2, 3, 4, 5});
+}
+
+TEST_CASE("ops::append() - Unique left side is appended in place") {
+    auto left = Shared<std::vector<CountedValue>>{1, 2, 3};
+    left.mutate().reserve(10);
+    const CountedValue* data = left->data();
+    auto right = Shared<std::vector<CountedValue>>{4, 5};
+    Counter::reset();
+    auto result = std::move(left) | ops::append(std::move(right));
+    CHECK(Counter::copied() == 0);
+    CHECK(result->data() == data);
+    CHECK(result.get() == std::vector<CountedValue>{1, 2, 3, 4, 5});
+}
+
+TEST_CASE("ops::append() - Empty side is dropped") {
+    auto value = Shared<std::vector<CountedValue>>{1, 2, 3};
+    const CountedValue* data = value->data();
+    Counter::reset();
+    auto result = ops::empty<Shared<std::vector<CountedValue>>>() | ops::append(value)
+                  | ops::append(Shared<std::vector<CountedValue>>());
+    CHECK(Counter::copied() == 0);
+    CHECK(result->data() == data);
+    CHECK(value == result);
+}
+
+TEST_CASE("ops::append() - Same handle on both sides") {
+    auto value = Shared<std::vector<int>>{1, 2};
+    auto result = instances::Monoid<Shared<std::vector<int>>>::append(std::move(value), std::move(value));
+    CHECK(result.get() == std::vector<int>{1, 2, 1, 2});
+}
@@ -23,14 +23,19 @@
  *
  */
 
+#include "counter.h"
 #include "test_helpers.h"
 
 #include "cefal/everything.h"
 
 #include "catch2/catch.hpp"
 
+#include <algorithm>
+#include <bit>
 #include <deque>
 #include <list>
+#include <map>
+#include <memory_resource>
 #include <set>
 #include <string>
 #include <unordered_set>
@@ -38,8 +43,19 @@
 
 using namespace cefal;
 
+namespace {
+struct RelocatableValue : public Counter {
+    RelocatableValue(int value) : Counter(), value(value) {}
+    int value = 0;
+    bool operator==(const RelocatableValue& other) const { return value == other.value; }
+};
+} // namespace
+
+template <>
+struct cefal::IsTriviallyRelocatable<RelocatableValue> : std::true_type {};
+
 TEMPLATE_PRODUCT_TEST_CASE("ops::empty()", "",
-                           (std::vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
+                           (std::vector, SmallVector4, Vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
                             std::unordered_multiset),
                            (int, std::string)) {
     TestType result = ops::empty<TestType>();
@@ -53,7 +69,7 @@ TEMPLATE_PRODUCT_TEST_CASE("ops::empty()", "", (std::map, std::unordered_map, st
 }
 
 TEMPLATE_PRODUCT_TEST_CASE("ops::append() - Both", "",
-                           (std::vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
+                           (std::vector, SmallVector4, Vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
                             std::unordered_multiset),
                            (int, std::string)) {
     using InnerType = typename TestType::value_type;
@@ -109,7 +125,7 @@ TEMPLATE_PRODUCT_TEST_CASE("ops::append() - Both", "", (std::map, std::unordered
 }
 
 TEMPLATE_PRODUCT_TEST_CASE("ops::append() - Left", "",
-                           (std::vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
+                           (std::vector, SmallVector4, Vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
                             std::unordered_multiset),
                            (int, std::string)) {
     using InnerType = typename TestType::value_type;
@@ -125,7 +141,7 @@ TEMPLATE_PRODUCT_TEST_CASE("ops::append() - Left", "", (std::map, std::unordered
 }
 
 TEMPLATE_PRODUCT_TEST_CASE("ops::append() - Right", "",
-                           (std::vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
+                           (std::vector, SmallVector4, Vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
                             std::unordered_multiset),
                            (int, std::string)) {
     using InnerType = typename TestType::value_type;
@@ -141,7 +157,7 @@ TEMPLATE_PRODUCT_TEST_CASE("ops::append() - Right", "", (std::map, std::unordere
 }
 
 TEMPLATE_PRODUCT_TEST_CASE("ops::append() - None", "",
-                           (std::vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
+                           (std::vector, SmallVector4, Vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
                             std::unordered_multiset),
                            (int, std::string)) {
     using InnerType = typename TestType::value_type;
@@ -155,3 +171,187 @@ TEMPLATE_PRODUCT_TEST_CASE("ops::append() - None", "", (std::map, std::unordered
     TestType result = TestType() | ops::append(TestType());
     REQUIRE(result.empty());
 }
+
+TEST_CASE("ops::append() - Repeated appends are amortized linear") {
+    constexpr size_t count = 2000;
+    using Container = std::vector<CountedValue, CountingAllocator<CountedValue>>;
+    Container result;
+    Counter::reset();
+    Allocations::count = 0;
+    for (size_t i = 0; i < count; ++i) {
+        Container right;
+        right.emplace_back(int(i));
+        result = std::move(result) | ops::append(std::move(right));
+    }
+    CHECK(result.size() == count);
+    CHECK(Counter::created() == count);
+    // Each element is transferred into result once, reallocations relocate less than two elements per append on average
+    CHECK(Counter::copied() + Counter::moved() < 4 * count);
+    // One allocation per right operand, result itself is reallocated only logarithmic number of times
+    CHECK(Allocations::count <= count + std::bit_width(count) + 1);
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::append() - Rvalue operands are moved", "",
+                           (std::vector, SmallVector4, Vector, std::list, std::deque, std::set, std::unordered_set, std::multiset,
+                            std::unordered_multiset),
+                           (CountedValue)) {
+    TestType result;
+    SECTION("Longer left") {
+        auto left = TestType{CountedValue(1), CountedValue(2), CountedValue(3)};
+        auto right = TestType{CountedValue(4), CountedValue(5)};
+        Counter::reset();
+        result = std::move(left) | ops::append(std::move(right));
+    }
+    SECTION("Longer right") {
+        auto left = TestType{CountedValue(1), CountedValue(2)};
+        auto right = TestType{CountedValue(3), CountedValue(4), CountedValue(5)};
+        Counter::reset();
+        result = std::move(left) | ops::append(std::move(right));
+    }
+    CHECK(Counter::copied() == 0);
+    CHECK(result == TestType{CountedValue(1), CountedValue(2), CountedValue(3), CountedValue(4), CountedValue(5)});
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::append() - Rvalue operands are moved", "",
+                           (std::map, std::unordered_map, std::multimap, std::unordered_multimap), ((int, CountedValue))) {
+    auto left = TestType{{1, CountedValue(1)}, {2, CountedValue(2)}};
+    auto right = TestType{{3, CountedValue(3)}, {4, CountedValue(4)}};
+    Counter::reset();
+    TestType result = std::move(left) | ops::append(std::move(right));
+    CHECK(Counter::copied() == 0);
+    CHECK(result == TestType{{1, CountedValue(1)}, {2, CountedValue(2)}, {3, CountedValue(3)}, {4, CountedValue(4)}});
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::append() - Lvalue operands are intact", "",
+                           (std::set, std::unordered_set, std::multiset, std::unordered_multiset), (int)) {
+    auto left = TestType{1, 2};
+    auto right = TestType{3, 4};
+    TestType result = instances::Monoid<TestType>::append(std::move(left), right);
+    CHECK(result == TestType{1, 2, 3, 4});
+    CHECK(right == TestType{3, 4});
+}
+
+TEST_CASE("ops::append() - Hashed container is reserved before merge") {
+    CountedUnorderedSet<int> left;
+    CountedUnorderedSet<int> right;
+    for (int i = 0; i < 1000; ++i)
+        left.insert(i);
+    for (int i = 0; i < 30000; ++i)
+        right.insert(i + 1000);
+    CountedUnorderedSet<int> result;
+    SECTION("Lvalue") {
+        auto op = ops::append(right);
+        ArrayAllocations::count = 0;
+        result = left | op;
+        // Buckets of the copy and the reserved ones
+        CHECK(ArrayAllocations::count == 2);
+    }
+    SECTION("Rvalue") {
+        ArrayAllocations::count = 0;
+        result = std::move(left) | ops::append(std::move(right));
+        CHECK(ArrayAllocations::count == 1);
+    }
+    CHECK(result.size() == 31000);
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::empty() - ArenaScope", "",
+                           (std::pmr::vector, std::pmr::deque, std::pmr::list, std::pmr::set, std::pmr::unordered_set), (int)) {
+    ArenaScope arena;
+    auto result = ops::empty<TestType>();
+    CHECK(result.get_allocator().resource() == arena.resource());
+}
+
+TEST_CASE("ops::append() - ArenaScope") {
+    std::pmr::vector<int> left = {1, 2};
+    std::pmr::vector<int> right = {3};
+    {
+        ArenaScope arena;
+        auto result = left | ops::append(right);
+        CHECK(result == std::pmr::vector<int>{1, 2, 3});
+        CHECK(result.get_allocator().resource() == arena.resource());
+        {
+            ArenaScope inner;
+            CHECK(ops::empty<std::pmr::vector<int>>().get_allocator().resource() == inner.resource());
+        }
+        CHECK(ops::empty<std::pmr::vector<int>>().get_allocator().resource() == arena.resource());
+    }
+    CHECK(ops::empty<std::pmr::vector<int>>().get_allocator().resource() == std::pmr::get_default_resource());
+}
+
+TEMPLATE_PRODUCT_TEST_CASE("ops::append() - Nodes of arena operand are not relinked", "",
+                           (std::pmr::set, std::pmr::unordered_set, std::pmr::multiset), (int)) {
+    TestType result;
+    {
+        TestType left = {1, 2, 3};
+        ArenaScope arena;
+        auto right = ops::empty<TestType>();
+        right.insert({3, 4, 5});
+        result = std::move(left) | ops::append(std::move(right));
+    }
+    // Read after arena is released, so nodes relinked from it would be dangling
+    CHECK(result.get_allocator().resource() == std::pmr::get_default_resource());
+    CHECK(result.size() == (std::is_same_v<TestType, std::pmr::multiset<int>> ? 6 : 5));
+    CHECK(result.count(5) == 1);
+}
+
+TEST_CASE("ops::append() - Nodes of arena operand are not relinked (map)") {
+    std::pmr::map<int, std::string> result;
+    {
+        std::pmr::map<int, std::string> left = {{1, "a"}, {2, "b"}};
+        ArenaScope arena;
+        auto right = ops::empty<std::pmr::map<int, std::string>>();
+        right.emplace(2, "c");
+        right.emplace(3, "long enough string to be allocated");
+        result = std::move(left) | ops::append(std::move(right));
+    }
+    CHECK(result == std::pmr::map<int, std::string>{{1, "a"}, {2, "b"}, {3, "long enough string to be allocated"}});
+}
+
+TEST_CASE("ops::append() - SmallVector goes to heap only when it outgrows inline storage") {
+    SmallVector<CountedValue, 4> left = {1, 2};
+    SmallVector<CountedValue, 4> right = {3, 4};
+    Counter::reset();
+    auto result = std::move(left) | ops::append(std::move(right));
+    CHECK(result.isInline());
+    CHECK(Counter::copied() == 0);
+
+    auto grown = std::move(result) | ops::append(SmallVector<CountedValue, 4>{5});
+    CHECK(!grown.isInline());
+    const CountedValue* data = grown.data();
+    auto moved = std::move(grown);
+    CHECK(moved.data() == data);
+    CHECK(moved == SmallVector<CountedValue, 4>{1, 2, 3, 4, 5});
+}
+
+TEST_CASE("ops::append() - Vector relocates trivially relocatable elements bytewise") {
+    Vector<RelocatableValue> left;
+    Vector<RelocatableValue> right;
+    for (int i = 0; i < 100; ++i) {
+        left.emplace_back(i);
+        right.emplace_back(i + 100);
+    }
+    Counter::reset();
+    auto result = std::move(left) | ops::append(std::move(right));
+    CHECK(Counter::copied() == 0);
+    CHECK(Counter::moved() == 100);
+    REQUIRE(result.size() == 200);
+    for (int i = 0; i < 200; ++i)
+        CHECK(result[i].value == i);
+}
+
+TEST_CASE("ops::append() - Vector grows mapped storage") {
+    const std::ptrdiff_t size = cefal::detail::vectorMappingThreshold / sizeof(int);
+    Vector<int> left(size, 1);
+    Vector<int> right(size, 2);
+    REQUIRE(left.isMapped());
+    auto result = std::move(left) | ops::append(right);
+    CHECK(result.isMapped());
+    REQUIRE(result.size() == 2 * size_t(size));
+    CHECK(std::count(result.begin(), result.begin() + size, 1) == size);
+    CHECK(std::count(result.begin() + size, result.end(), 2) == size);
+
+    result.resize(3);
+    result.shrink_to_fit();
+    CHECK(!result.isMapped());
+    CHECK(result == Vector<int>{1, 1, 1});
+}